@@ -0,0 +1,660 @@
+// -----------------------------------------------------------------------------
+// benchmark.cpp — mede os mecanismos de IPC com as mesmas cargas, para escolher
+// o mecanismo de cada caso de uso e pegar regressões.
+//
+// Mecanismos (processos separados via fork, como em produção):
+//   pipe   par de pipes anônimos (um por sentido), buffer de 1 MiB (canal_pipe.h)
+//   unix   socketpair AF_UNIX stream
+//   tcp    TCP sobre [::1] (porta efêmera, TCP_NODELAY)
+//   shm    memória compartilhada: anéis SPSC (anel_spsc.h) e, na difusão,
+//          o anel de difusão (anel_difusao.h)
+//
+// Cargas:
+//   pingpong  o pai envia N bytes, o filho devolve N bytes; latência = ida e volta
+//   stream    o pai envia sem esperar resposta; latência = de ponta a ponta
+//             (o "carimbo" monotônico vai nos primeiros 8 bytes da mensagem)
+//   fanout    o pai envia cada mensagem a `--leitores` filhos
+//
+// Tamanhos de 8 B a 16 MiB (--min, --max, --fator). Cada caso vira uma linha
+// JSON em stdout, com percentis e histograma da latência (ns), mensagens/s,
+// GB/s e tempo de CPU (pai + filhos) por mensagem entregue:
+//
+//   {"mecanismo":"shm","carga":"pingpong","tamanho":64,"mensagens":20000,
+//    "segundos":0.041,"msgs_s":487804,"gbps":0.062,"cpu_ns_msg":4100,
+//    "lat_ns":{"min":...,"p50":...,"p99":...,"p999":...,"max":...},
+//    "hist":[[1024,12],[2048,19950],...]}
+//
+// "hist" traz pares [limite superior em ns, contagem] em faixas de potência
+// de 2 (só as não vazias).
+// -----------------------------------------------------------------------------
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/relogio.h"
+#include "../pipes/canal_pipe.h"
+#include "../shared_memory/segmento.h"
+#include "../shared_memory/anel_spsc.h"
+#include "../shared_memory/anel_difusao.h"
+
+enum class Mecanismo { Pipe, Unix, Tcp, Shm };
+enum class Carga { PingPong, Stream, Fanout };
+
+const char* nomeMecanismo(Mecanismo m) {
+    switch (m) {
+    case Mecanismo::Pipe: return "pipe";
+    case Mecanismo::Unix: return "unix";
+    case Mecanismo::Tcp:  return "tcp";
+    case Mecanismo::Shm:  return "shm";
+    }
+    return "?";
+}
+
+const char* nomeCarga(Carga c) {
+    switch (c) {
+    case Carga::PingPong: return "pingpong";
+    case Carga::Stream:   return "stream";
+    case Carga::Fanout:   return "fanout";
+    }
+    return "?";
+}
+
+// Anéis de memória compartilhada do benchmark
+constexpr size_t CAPACIDADE_ANEL_BENCH = 4 << 20;   // por sentido
+constexpr size_t PEDACO_ANEL_BENCH = 1 << 20;       // maior registro por mensagem
+constexpr size_t SLOTS_DIFUSAO_BENCH = 256;
+constexpr size_t TAM_SLOT_DIFUSAO_BENCH = 64 << 10;
+
+// -----------------------------------------------------------------------------
+// Utilitários de descritor: leitura/escrita completas (pipes e sockets
+// bloqueantes podem aceitar ou entregar só parte dos bytes).
+// -----------------------------------------------------------------------------
+bool escreverTudo(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t r = write(fd, p, n);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+bool lerTudo(int fd, char* p, size_t n) {
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (r == 0) return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Ponta de um canal. Cada mensagem de `n` bytes é entregue inteira: quem
+// recebe já sabe o tamanho (todos os envios de um caso têm o mesmo tamanho).
+// As pontas são criadas antes do fork; cada processo fica com as suas e
+// destrói as do outro.
+// -----------------------------------------------------------------------------
+class Ponta {
+public:
+    virtual ~Ponta() = default;
+    virtual bool enviar(const char* dados, size_t n) = 0;
+    virtual bool receber(char* destino, size_t n) = 0;
+    // Chamados no início de um caso: pelo filho (receptor) logo depois do
+    // fork e pelo pai (emissor) antes da primeira mensagem.
+    virtual bool iniciarReceptor() { return true; }
+    virtual void aguardarReceptores() {}
+};
+
+// pipe, unix e tcp: um descritor para cada sentido (podem ser o mesmo)
+class PontaDescritor : public Ponta {
+public:
+    PontaDescritor(int rx, int tx) : rx_(rx), tx_(tx) {}
+    ~PontaDescritor() override {
+        if (rx_ >= 0) close(rx_);
+        if (tx_ >= 0 && tx_ != rx_) close(tx_);
+    }
+    bool enviar(const char* dados, size_t n) override { return escreverTudo(tx_, dados, n); }
+    bool receber(char* destino, size_t n) override { return lerTudo(rx_, destino, n); }
+
+private:
+    int rx_, tx_;
+};
+
+// Difusão por descritores: o emissor escreve a mensagem em cada canal, em série
+class EmissorDescritores : public Ponta {
+public:
+    explicit EmissorDescritores(std::vector<int> fds) : fds_(std::move(fds)) {}
+    ~EmissorDescritores() override { for (int fd : fds_) close(fd); }
+    bool enviar(const char* dados, size_t n) override {
+        for (int fd : fds_) {
+            if (!escreverTudo(fd, dados, n)) return false;
+        }
+        return true;
+    }
+    bool receber(char*, size_t) override { return false; }
+
+private:
+    std::vector<int> fds_;
+};
+
+// shm: dois anéis SPSC no mesmo segmento, um por sentido. Mensagens maiores
+// que PEDACO_ANEL_BENCH vão em vários registros.
+class PontaAnel : public Ponta {
+public:
+    PontaAnel(std::shared_ptr<SegmentoCompartilhado> seg, void* memTx, void* memRx)
+        : seg_(std::move(seg)) {
+        tx_.anexar(memTx);
+        rx_.anexar(memRx);
+    }
+    bool enviar(const char* dados, size_t n) override {
+        size_t enviados = 0;
+        while (enviados < n) {
+            const size_t parte = std::min(n - enviados, PEDACO_ANEL_BENCH);
+            // Anel cheio: espera o consumidor liberar espaço (como o writer)
+            while (!tx_.tentarEscrever(dados + enviados, parte)) std::this_thread::yield();
+            enviados += parte;
+        }
+        return true;
+    }
+    bool receber(char* destino, size_t n) override {
+        size_t recebidos = 0;
+        while (recebidos < n) {
+            size_t tam;
+            const uint8_t* p = rx_.espiar(tam);
+            if (!p) {
+                rx_.aguardarDados(politica_);
+                continue;
+            }
+            std::memcpy(destino + recebidos, p, tam);
+            rx_.consumir();
+            recebidos += tam;
+        }
+        return true;
+    }
+
+private:
+    std::shared_ptr<SegmentoCompartilhado> seg_;
+    AnelSPSC tx_, rx_;
+    PoliticaEspera politica_;
+};
+
+// shm na difusão: o anel de difusão em modo Bloquear (ninguém perde mensagens)
+class PontaDifusao : public Ponta {
+public:
+    PontaDifusao(std::shared_ptr<SegmentoCompartilhado> seg, unsigned leitores)
+        : seg_(std::move(seg)), leitores_(leitores) {
+        anel_.anexar(seg_->base());
+    }
+    bool enviar(const char* dados, size_t n) override {
+        size_t enviados = 0;
+        while (enviados < n) {
+            const size_t parte = std::min(n - enviados, anel_.maiorMensagem());
+            if (!anel_.publicar(dados + enviados, parte, politica_)) return false;
+            enviados += parte;
+        }
+        return true;
+    }
+    bool receber(char* destino, size_t n) override {
+        size_t recebidos = 0;
+        uint64_t perdidas = 0;
+        while (recebidos < n) {
+            if (!anel_.tentarLer(pedaco_, perdidas)) {
+                anel_.aguardarDados(politica_);
+                continue;
+            }
+            if (perdidas > 0) return false;
+            std::memcpy(destino + recebidos, pedaco_.data(), pedaco_.size());
+            recebidos += pedaco_.size();
+        }
+        return true;
+    }
+    bool iniciarReceptor() override { return anel_.inscrever(); }
+    // Só publica depois que todos se inscreveram: quem chega depois perde o início
+    void aguardarReceptores() override {
+        while (anel_.leitoresAtivos() < leitores_) std::this_thread::yield();
+    }
+
+private:
+    std::shared_ptr<SegmentoCompartilhado> seg_;
+    unsigned leitores_;
+    AnelDifusao anel_;
+    PoliticaEspera politica_;
+    std::string pedaco_;
+};
+
+// -----------------------------------------------------------------------------
+// Criação dos canais
+// -----------------------------------------------------------------------------
+
+// Par TCP conectado em [::1] numa porta efêmera
+bool parTcp(int fds[2]) {
+    int escuta = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (escuta < 0) return false;
+    sockaddr_in6 addr{};
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_loopback;
+    socklen_t len = sizeof(addr);
+    int a = -1, b = -1;
+    if (bind(escuta, (sockaddr*)&addr, sizeof(addr)) == 0 && listen(escuta, 1) == 0 &&
+        getsockname(escuta, (sockaddr*)&addr, &len) == 0) {
+        a = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (a >= 0 && connect(a, (sockaddr*)&addr, sizeof(addr)) == 0) {
+            b = accept4(escuta, nullptr, nullptr, SOCK_CLOEXEC);
+        }
+    }
+    close(escuta);
+    if (a < 0 || b < 0) {
+        if (a >= 0) close(a);
+        return false;
+    }
+    int um = 1;
+    setsockopt(a, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    setsockopt(b, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    fds[0] = a;
+    fds[1] = b;
+    return true;
+}
+
+// Socket conectado entre dois processos (unix ou tcp): fds[0] fica com um
+// lado, fds[1] com o outro; cada um lê e escreve no próprio descritor.
+bool parDescritores(Mecanismo m, int fds[2]) {
+    if (m == Mecanismo::Unix) return socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0;
+    if (m == Mecanismo::Tcp) return parTcp(fds);
+    return false;
+}
+
+std::string nomeSegmentoBench() {
+    static unsigned contador = 0;
+    return "/ipc_bench_" + std::to_string(getpid()) + "_" + std::to_string(contador++);
+}
+
+// Canal bidirecional: `a` fica no pai, `b` no filho.
+bool criarPar(Mecanismo m, std::unique_ptr<Ponta>& a, std::unique_ptr<Ponta>& b) {
+    if (m == Mecanismo::Pipe) {
+        int ida[2], volta[2];
+        if (!criarPipe(ida)) return false;
+        if (!criarPipe(volta)) {
+            close(ida[0]);
+            close(ida[1]);
+            return false;
+        }
+        a = std::make_unique<PontaDescritor>(volta[0], ida[1]);
+        b = std::make_unique<PontaDescritor>(ida[0], volta[1]);
+        return true;
+    }
+    if (m == Mecanismo::Shm) {
+        auto seg = std::make_shared<SegmentoCompartilhado>();
+        const size_t tamAnel = AnelSPSC::tamanhoNecessario(CAPACIDADE_ANEL_BENCH);
+        if (!seg->criar(nomeSegmentoBench(), 2 * tamAnel)) return false;
+        seg->remover(); // o mapeamento herdado pelo fork basta
+        char* base = (char*)seg->base();
+        AnelSPSC ida, volta;
+        if (!ida.inicializar(base, CAPACIDADE_ANEL_BENCH) ||
+            !volta.inicializar(base + tamAnel, CAPACIDADE_ANEL_BENCH)) {
+            return false;
+        }
+        a = std::make_unique<PontaAnel>(seg, base, base + tamAnel);
+        b = std::make_unique<PontaAnel>(seg, base + tamAnel, base);
+        return true;
+    }
+    int fds[2];
+    if (!parDescritores(m, fds)) return false;
+    a = std::make_unique<PontaDescritor>(fds[0], fds[0]);
+    b = std::make_unique<PontaDescritor>(fds[1], fds[1]);
+    return true;
+}
+
+// Um emissor (pai) para `n` receptores (filhos).
+bool criarDifusao(Mecanismo m, unsigned n, std::unique_ptr<Ponta>& emissor,
+                  std::vector<std::unique_ptr<Ponta>>& receptores) {
+    if (m == Mecanismo::Shm) {
+        if (n > MAX_LEITORES) return false;
+        auto seg = std::make_shared<SegmentoCompartilhado>();
+        if (!seg->criar(nomeSegmentoBench(),
+                        AnelDifusao::tamanhoNecessario(SLOTS_DIFUSAO_BENCH, TAM_SLOT_DIFUSAO_BENCH))) {
+            return false;
+        }
+        seg->remover();
+        AnelDifusao anel;
+        if (!anel.inicializar(seg->base(), SLOTS_DIFUSAO_BENCH, TAM_SLOT_DIFUSAO_BENCH,
+                              AnelDifusao::Modo::Bloquear)) {
+            return false;
+        }
+        emissor = std::make_unique<PontaDifusao>(seg, n);
+        for (unsigned i = 0; i < n; ++i) receptores.push_back(std::make_unique<PontaDifusao>(seg, n));
+        return true;
+    }
+    std::vector<int> saidas;
+    for (unsigned i = 0; i < n; ++i) {
+        int fds[2];
+        bool ok = m == Mecanismo::Pipe ? criarPipe(fds) : parDescritores(m, fds);
+        if (!ok) {
+            for (int fd : saidas) close(fd);
+            receptores.clear();
+            return false;
+        }
+        // pipe2: [0] leitura, [1] escrita; nos sockets os dois lados servem
+        saidas.push_back(fds[1]);
+        receptores.push_back(std::make_unique<PontaDescritor>(fds[0], -1));
+    }
+    emissor = std::make_unique<EmissorDescritores>(std::move(saidas));
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Resultado de um caso
+// -----------------------------------------------------------------------------
+struct Resultado {
+    uint64_t mensagens = 0;   // entregues (na difusão: mensagens × leitores)
+    uint64_t bytes = 0;       // entregues
+    double segundos = 0;
+    int64_t cpuNs = 0;        // pai + filhos
+    std::vector<int64_t> latencias;
+};
+
+int64_t cpuNs(int quem) {
+    rusage u{};
+    getrusage(quem, &u);
+    return ((int64_t)u.ru_utime.tv_sec + u.ru_stime.tv_sec) * 1000000000 +
+           ((int64_t)u.ru_utime.tv_usec + u.ru_stime.tv_usec) * 1000;
+}
+
+void imprimirResultado(Mecanismo m, Carga c, size_t tamanho, Resultado& r) {
+    std::vector<int64_t>& v = r.latencias;
+    std::sort(v.begin(), v.end());
+    auto percentil = [&](double q) -> int64_t {
+        if (v.empty()) return 0;
+        return v[std::min(v.size() - 1, (size_t)(q * v.size()))];
+    };
+
+    std::string hist;
+    size_t i = 0;
+    for (int64_t limite = 1; i < v.size(); limite *= 2) {
+        size_t n = 0;
+        while (i < v.size() && v[i] < limite) ++i, ++n;
+        if (n == 0) continue;
+        if (!hist.empty()) hist += ',';
+        hist += "[" + std::to_string(limite) + "," + std::to_string(n) + "]";
+    }
+
+    const double s = r.segundos > 0 ? r.segundos : 1e-9;
+    std::printf("{\"mecanismo\":\"%s\",\"carga\":\"%s\",\"tamanho\":%zu,\"mensagens\":%llu,"
+                "\"segundos\":%.6f,\"msgs_s\":%.0f,\"gbps\":%.3f,\"cpu_ns_msg\":%lld,"
+                "\"lat_ns\":{\"min\":%lld,\"p50\":%lld,\"p99\":%lld,\"p999\":%lld,\"max\":%lld},"
+                "\"hist\":[%s]}\n",
+                nomeMecanismo(m), nomeCarga(c), tamanho, (unsigned long long)r.mensagens,
+                r.segundos, r.mensagens / s, r.bytes / s / 1e9,
+                (long long)(r.mensagens ? r.cpuNs / (int64_t)r.mensagens : 0),
+                (long long)(v.empty() ? 0 : v.front()), (long long)percentil(0.50),
+                (long long)percentil(0.99), (long long)percentil(0.999),
+                (long long)(v.empty() ? 0 : v.back()), hist.c_str());
+    std::fflush(stdout);
+}
+
+// -----------------------------------------------------------------------------
+// Cargas. O pai sempre mede o tempo total; nas cargas de mão única cada filho
+// mede a latência de ponta a ponta e devolve as amostras por um pipe.
+// -----------------------------------------------------------------------------
+
+void carimbar(std::vector<char>& msg) {
+    const int64_t agora = monotonicoNs();
+    std::memcpy(msg.data(), &agora, sizeof(agora));
+}
+
+int64_t lerCarimbo(const std::vector<char>& msg) {
+    int64_t t;
+    std::memcpy(&t, msg.data(), sizeof(t));
+    return t;
+}
+
+bool esperarFilhos(const std::vector<pid_t>& filhos) {
+    bool ok = true;
+    for (pid_t pid : filhos) {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return ok;
+}
+
+bool pingPong(Mecanismo m, size_t tamanho, uint64_t iteracoes, Resultado& r) {
+    std::unique_ptr<Ponta> pai, filho;
+    if (!criarPar(m, pai, filho)) return false;
+    std::vector<char> msg(tamanho, 'x'); // já tocada: sem page faults na medição
+
+    const int64_t cpuFilhos = cpuNs(RUSAGE_CHILDREN);
+    const int64_t cpuPai = cpuNs(RUSAGE_SELF);
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        pai.reset();
+        bool ok = filho->iniciarReceptor();
+        for (uint64_t i = 0; ok && i < iteracoes; ++i) {
+            ok = filho->receber(msg.data(), tamanho) && filho->enviar(msg.data(), tamanho);
+        }
+        _exit(ok ? 0 : 1);
+    }
+    filho.reset();
+
+    r.latencias.reserve(iteracoes);
+    bool ok = true;
+    const int64_t inicio = monotonicoNs();
+    for (uint64_t i = 0; ok && i < iteracoes; ++i) {
+        const int64_t t0 = monotonicoNs();
+        ok = pai->enviar(msg.data(), tamanho) && pai->receber(msg.data(), tamanho);
+        r.latencias.push_back(monotonicoNs() - t0);
+    }
+    r.segundos = segundosEntre(inicio, monotonicoNs());
+    pai.reset();
+    ok = esperarFilhos({pid}) && ok;
+    r.cpuNs = (cpuNs(RUSAGE_SELF) - cpuPai) + (cpuNs(RUSAGE_CHILDREN) - cpuFilhos);
+    r.mensagens = iteracoes;
+    r.bytes = 2 * iteracoes * tamanho;
+    return ok;
+}
+
+// stream (1 leitor) e fanout (n leitores)
+bool maoUnica(Mecanismo m, unsigned leitores, size_t tamanho, uint64_t iteracoes, Resultado& r) {
+    std::unique_ptr<Ponta> emissor;
+    std::vector<std::unique_ptr<Ponta>> receptores;
+    if (leitores == 1) {
+        receptores.resize(1);
+        if (!criarPar(m, emissor, receptores[0])) return false;
+    } else if (!criarDifusao(m, leitores, emissor, receptores)) {
+        return false;
+    }
+    std::vector<char> msg(tamanho, 'x');
+
+    const int64_t cpuFilhos = cpuNs(RUSAGE_CHILDREN);
+    const int64_t cpuPai = cpuNs(RUSAGE_SELF);
+    std::vector<pid_t> filhos;
+    std::vector<int> resultados; // pipe de amostras de cada filho
+    for (unsigned k = 0; k < leitores; ++k) {
+        int rp[2];
+        if (pipe2(rp, O_CLOEXEC) != 0) break;
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(rp[0]);
+            close(rp[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(rp[0]);
+            emissor.reset();
+            for (unsigned j = 0; j < leitores; ++j) if (j != k) receptores[j].reset();
+            Ponta& p = *receptores[k];
+            std::vector<int64_t> amostras;
+            amostras.reserve(iteracoes);
+            bool ok = p.iniciarReceptor();
+            for (uint64_t i = 0; ok && i < iteracoes; ++i) {
+                ok = p.receber(msg.data(), tamanho);
+                amostras.push_back(monotonicoNs() - lerCarimbo(msg));
+            }
+            const uint64_t n = ok ? amostras.size() : 0;
+            ok = escreverTudo(rp[1], (const char*)&n, sizeof(n)) &&
+                 escreverTudo(rp[1], (const char*)amostras.data(), n * sizeof(int64_t)) && ok;
+            _exit(ok ? 0 : 1);
+        }
+        close(rp[1]);
+        filhos.push_back(pid);
+        resultados.push_back(rp[0]);
+    }
+    receptores.clear();
+
+    bool ok = filhos.size() == leitores;
+    if (ok) emissor->aguardarReceptores();
+    const int64_t inicio = monotonicoNs();
+    for (uint64_t i = 0; ok && i < iteracoes; ++i) {
+        carimbar(msg);
+        ok = emissor->enviar(msg.data(), tamanho);
+    }
+    // Cada filho só responde depois de receber tudo: o tempo para quando o
+    // último confirma
+    std::vector<uint64_t> contagens(resultados.size(), 0);
+    for (size_t k = 0; k < resultados.size(); ++k) {
+        ok = lerTudo(resultados[k], (char*)&contagens[k], sizeof(uint64_t)) && ok;
+    }
+    r.segundos = segundosEntre(inicio, monotonicoNs());
+    for (size_t k = 0; k < resultados.size(); ++k) {
+        const size_t antes = r.latencias.size();
+        r.latencias.resize(antes + contagens[k]);
+        ok = lerTudo(resultados[k], (char*)(r.latencias.data() + antes),
+                     contagens[k] * sizeof(int64_t)) && ok;
+        close(resultados[k]);
+    }
+    emissor.reset();
+    ok = esperarFilhos(filhos) && ok;
+    r.cpuNs = (cpuNs(RUSAGE_SELF) - cpuPai) + (cpuNs(RUSAGE_CHILDREN) - cpuFilhos);
+    r.mensagens = iteracoes * leitores;
+    r.bytes = r.mensagens * tamanho;
+    return ok;
+}
+
+// -----------------------------------------------------------------------------
+// Linha de comando
+// -----------------------------------------------------------------------------
+
+// "64", "4K", "16M", "1G"
+uint64_t lerTamanho(const std::string& s) {
+    char* fim = nullptr;
+    uint64_t v = std::strtoull(s.c_str(), &fim, 10);
+    switch (fim ? *fim : '\0') {
+    case 'K': case 'k': return v << 10;
+    case 'M': case 'm': return v << 20;
+    case 'G': case 'g': return v << 30;
+    default: return v;
+    }
+}
+
+template <typename T, typename F>
+std::vector<T> lerLista(const std::string& s, F converter) {
+    std::vector<T> itens;
+    size_t i = 0;
+    while (i <= s.size()) {
+        size_t j = s.find(',', i);
+        if (j == std::string::npos) j = s.size();
+        T v;
+        if (converter(s.substr(i, j - i), v)) itens.push_back(v);
+        else std::cerr << "[ERRO] item desconhecido: " << s.substr(i, j - i) << "\n";
+        i = j + 1;
+    }
+    return itens;
+}
+
+int main(int argc, char* argv[]) {
+    /* Opções:
+    --mecanismos=pipe,unix,tcp,shm   (padrão: todos)
+    --cargas=pingpong,stream,fanout  (padrão: todas)
+    --min=8 --max=16M --fator=8      tamanhos: min, min*fator, ... até max
+    --iteracoes=20000                mensagens por caso (no máximo)
+    --volume=256M                    limita mensagens × tamanho por caso
+    --leitores=4                     filhos na carga fanout */
+    std::vector<Mecanismo> mecanismos = {Mecanismo::Pipe, Mecanismo::Unix, Mecanismo::Tcp, Mecanismo::Shm};
+    std::vector<Carga> cargas = {Carga::PingPong, Carga::Stream, Carga::Fanout};
+    uint64_t menor = 8, maior = 16 << 20, fator = 8;
+    uint64_t iteracoes = 20000, volume = 256 << 20;
+    unsigned leitores = 4;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto valor = [&](const char* nome) -> const char* {
+            size_t n = std::strlen(nome);
+            return arg.compare(0, n, nome) == 0 ? arg.c_str() + n : nullptr;
+        };
+        if (const char* v = valor("--mecanismos=")) {
+            mecanismos = lerLista<Mecanismo>(v, [](const std::string& s, Mecanismo& m) {
+                for (Mecanismo x : {Mecanismo::Pipe, Mecanismo::Unix, Mecanismo::Tcp, Mecanismo::Shm}) {
+                    if (s == nomeMecanismo(x)) { m = x; return true; }
+                }
+                return false;
+            });
+        } else if (const char* v = valor("--cargas=")) {
+            cargas = lerLista<Carga>(v, [](const std::string& s, Carga& c) {
+                for (Carga x : {Carga::PingPong, Carga::Stream, Carga::Fanout}) {
+                    if (s == nomeCarga(x)) { c = x; return true; }
+                }
+                return false;
+            });
+        } else if (const char* v = valor("--min=")) {
+            menor = std::max<uint64_t>(lerTamanho(v), sizeof(int64_t)); // cabe o carimbo
+        } else if (const char* v = valor("--max=")) {
+            maior = lerTamanho(v);
+        } else if (const char* v = valor("--fator=")) {
+            fator = std::max<uint64_t>(lerTamanho(v), 2);
+        } else if (const char* v = valor("--iteracoes=")) {
+            iteracoes = std::max<uint64_t>(lerTamanho(v), 1);
+        } else if (const char* v = valor("--volume=")) {
+            volume = lerTamanho(v);
+        } else if (const char* v = valor("--leitores=")) {
+            leitores = (unsigned)std::max<uint64_t>(lerTamanho(v), 2);
+        } else {
+            std::cerr << "[ERRO] opção desconhecida: " << arg << "\n";
+            return 1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN); // filho morto vira erro de escrita, não sinal
+
+    int falhas = 0;
+    for (Carga c : cargas) {
+        for (Mecanismo m : mecanismos) {
+            for (uint64_t tamanho = menor; tamanho <= maior; tamanho *= fator) {
+                // Mensagens grandes: menos iterações, mas o bastante para p99
+                const uint64_t n = std::max<uint64_t>(std::min(iteracoes, volume / tamanho), 16);
+                Resultado r;
+                bool ok = c == Carga::PingPong ? pingPong(m, tamanho, n, r)
+                        : maoUnica(m, c == Carga::Fanout ? leitores : 1, tamanho, n, r);
+                if (!ok) {
+                    std::cerr << "[ERRO] " << nomeMecanismo(m) << "/" << nomeCarga(c) << "/"
+                              << tamanho << ": " << strerror(errno) << "\n";
+                    ++falhas;
+                    continue;
+                }
+                imprimirResultado(m, c, tamanho, r);
+            }
+        }
+    }
+    return falhas ? 1 : 0;
+}
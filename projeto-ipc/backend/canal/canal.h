@@ -0,0 +1,549 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// canal.h — uma interface para os três mecanismos, escolhidos por URI, para
+// usar IPC de dentro de um programa em vez de iniciar os executáveis e ler o
+// stdout deles.
+//
+//   auto ouvinte = ouvirCanal("shm://ipc");      // lado que espera o par
+//   auto canal = ouvinte->aceitar();
+//   ...
+//   auto canal = conectarCanal("shm://ipc");     // lado que conecta
+//   canal->enviar("oi");
+//   std::string_view resposta;
+//   if (canal->receber(resposta)) ...
+//
+// URIs:
+//   tcp://[::1]:8080, unix:///tmp/ipc.sock, unix://@ipc, seqpacket://...
+//                    sockets, como em sockets/transporte.h
+//   pipe:///tmp/ipc  par de FIFOs (/tmp/ipc.ida e /tmp/ipc.volta), buffer
+//                    ampliado como em pipes/canal_pipe.h; um par por ouvinte
+//   fd://3,4         descritores herdados (leitura, escrita), ex.: pipes
+//                    criados antes de um fork ou os do pool de pipes
+//   shm://ipc        dois anéis SPSC (shared_memory/anel_spsc.h) no segmento
+//                    /ipc, um por sentido; um par por ouvinte.
+//                    shm://ipc?capacidade=N muda os bytes de cada anel
+//
+// Mensagens são entregues inteiras e na ordem. Em descritores cada uma vai num
+// quadro de sockets/protocolo.h; no anel, num registro. receber() devolve uma
+// view sobre o buffer do próprio canal (ou sobre o anel compartilhado, sem
+// cópia), válida até a próxima recepção.
+//
+// Modos de envio (definirModo):
+//   - Bloqueante:    enviar() volta quando o transporte aceitou tudo;
+//   - NaoBloqueante: o que não coube fica numa fila local (pendentes()) e sai
+//                    nas próximas chamadas ou em descarregar(); nunca espera.
+// receber() sempre espera; tentarReceber() nunca espera (false com errno =
+// EAGAIN se não há mensagem). Fim do par: false com fim() verdadeiro. Erros
+// seguem o padrão do resto do backend: false/nullptr com errno preenchido.
+// -----------------------------------------------------------------------------
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../sockets/protocolo.h"
+#include "../sockets/transporte.h"
+#include "../pipes/canal_pipe.h"
+#include "../shared_memory/segmento.h"
+#include "../shared_memory/anel_spsc.h"
+
+constexpr size_t CAPACIDADE_CANAL_SHM = 4 << 20; // bytes de cada anel em shm://
+
+class Canal {
+public:
+    enum class Modo { Bloqueante, NaoBloqueante };
+
+    virtual ~Canal() = default;
+
+    bool enviar(std::string_view mensagem) { return enviarLote(&mensagem, 1); }
+    // Várias mensagens numa operação (um write/send; no anel, uma notificação)
+    virtual bool enviarLote(const std::string_view* mensagens, size_t n) = 0;
+    // Tenta escoar a fila local; no modo bloqueante, espera até esvaziá-la
+    virtual bool descarregar() = 0;
+    virtual size_t pendentes() const = 0;
+
+    virtual bool tentarReceber(std::string_view& mensagem) = 0;
+    virtual bool receber(std::string_view& mensagem) = 0;
+
+    // Descritor para poll/epoll (legível quando há dados); -1 em shm://
+    virtual int descritor() const { return -1; }
+
+    void definirModo(Modo modo) { modo_ = modo; }
+    Modo modo() const { return modo_; }
+    bool fim() const { return fim_; }
+    const std::string& descricao() const { return descricao_; }
+
+protected:
+    Modo modo_ = Modo::Bloqueante;
+    bool fim_ = false;
+    std::string descricao_;
+};
+
+// Lado que espera o par (servidor)
+class Ouvinte {
+public:
+    virtual ~Ouvinte() = default;
+    // Espera o próximo par; nullptr em erro (EISCONN nos transportes de um
+    // par só, depois do primeiro)
+    virtual std::unique_ptr<Canal> aceitar() = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Pipes e sockets: quadros de protocolo.h sobre um descritor por sentido (os
+// dois iguais em sockets). Os descritores ficam não bloqueantes; a espera do
+// modo bloqueante é feita com poll.
+// -----------------------------------------------------------------------------
+class CanalDescritor : public Canal {
+public:
+    CanalDescritor(int rx, int tx, std::string descricao, size_t maiorEnvio = SIZE_MAX)
+        : rx_(rx), tx_(tx), maiorEnvio_(maiorEnvio), buffer_(MAIOR_REGISTRO) {
+        descricao_ = std::move(descricao);
+        fcntl(rx_, F_SETFL, fcntl(rx_, F_GETFL) | O_NONBLOCK);
+        if (tx_ != rx_) fcntl(tx_, F_SETFL, fcntl(tx_, F_GETFL) | O_NONBLOCK);
+        int tipo;
+        socklen_t len = sizeof(tipo);
+        socket_ = getsockopt(tx_, SOL_SOCKET, SO_TYPE, &tipo, &len) == 0;
+    }
+
+    ~CanalDescritor() override {
+        close(rx_);
+        if (tx_ != rx_) close(tx_);
+    }
+
+    bool enviarLote(const std::string_view* mensagens, size_t n) override {
+        for (size_t i = 0; i < n; ++i) {
+            if (mensagens[i].size() > MAIOR_PAYLOAD) {
+                errno = EMSGSIZE;
+                return false;
+            }
+            codificarQuadro(saida_, TipoQuadro::Comando, seq_++, mensagens[i]);
+        }
+        return descarregar();
+    }
+
+    bool descarregar() override {
+        while (enviados_ < saida_.size()) {
+            const size_t parte = std::min(saida_.size() - enviados_, maiorEnvio_);
+            const ssize_t r = socket_ ? send(tx_, saida_.data() + enviados_, parte, MSG_NOSIGNAL)
+                                      : write(tx_, saida_.data() + enviados_, parte);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+                if (modo_ == Modo::NaoBloqueante) return true;
+                if (!esperar(tx_, POLLOUT)) return false;
+                continue;
+            }
+            enviados_ += (size_t)r;
+        }
+        saida_.clear();
+        enviados_ = 0;
+        return true;
+    }
+
+    size_t pendentes() const override { return saida_.size() - enviados_; }
+
+    bool tentarReceber(std::string_view& mensagem) override { return ler(mensagem, false); }
+    bool receber(std::string_view& mensagem) override { return ler(mensagem, true); }
+    int descritor() const override { return rx_; }
+
+private:
+    static bool esperar(int fd, short evento) {
+        pollfd p{fd, evento, 0};
+        while (poll(&p, 1, -1) < 0) {
+            if (errno != EINTR) return false;
+        }
+        return true;
+    }
+
+    bool ler(std::string_view& mensagem, bool bloquear) {
+        while (true) {
+            Quadro q;
+            switch (entrada_.proximo(q)) {
+            case DecodificadorQuadros::Estado::Quadro:
+                mensagem = q.payload;
+                return true;
+            case DecodificadorQuadros::Estado::Incompleto:
+                break;
+            default: // blocos não fazem parte desta interface
+                errno = EPROTO;
+                return false;
+            }
+            const ssize_t r = read(rx_, buffer_.data(), buffer_.size());
+            if (r > 0) {
+                entrada_.alimentar(buffer_.data(), (size_t)r);
+                continue;
+            }
+            if (r == 0) {
+                fim_ = true;
+                errno = 0;
+                return false;
+            }
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            if (!bloquear || !esperar(rx_, POLLIN)) return false;
+        }
+    }
+
+    int rx_, tx_;
+    bool socket_ = false;
+    size_t maiorEnvio_;          // MAIOR_REGISTRO em seqpacket
+    std::string saida_;          // quadros ainda não aceitos pelo kernel
+    size_t enviados_ = 0;
+    uint32_t seq_ = 1;
+    DecodificadorQuadros entrada_;
+    std::vector<char> buffer_;   // comporta um registro inteiro de seqpacket
+};
+
+// -----------------------------------------------------------------------------
+// shm://: um anel por sentido. Com o anel cheio, o modo bloqueante espera o
+// par liberar espaço (como o writer) e o não bloqueante guarda a mensagem na
+// fila local, como [u32 tamanho][bytes].
+// -----------------------------------------------------------------------------
+class CanalShm : public Canal {
+public:
+    CanalShm(std::shared_ptr<SegmentoCompartilhado> segmento, void* tx, void* rx, std::string descricao)
+        : segmento_(std::move(segmento)) {
+        descricao_ = std::move(descricao);
+        tx_.anexar(tx);
+        rx_.anexar(rx);
+    }
+
+    ~CanalShm() override { tx_.sinalizarEncerramento(); }
+
+    bool enviarLote(const std::string_view* mensagens, size_t n) override {
+        for (size_t i = 0; i < n; ++i) {
+            const std::string_view m = mensagens[i];
+            if (m.size() > tx_.maiorMensagem()) {
+                errno = EMSGSIZE;
+                return false;
+            }
+            // Com fila, a ordem manda esperar a vez dela
+            if (filaInicio_ == fila_.size() && tx_.tentarEscrever(m.data(), m.size())) continue;
+            const uint32_t tam = (uint32_t)m.size();
+            fila_.append((const char*)&tam, sizeof(tam));
+            fila_.append(m.data(), m.size());
+        }
+        return descarregar();
+    }
+
+    bool descarregar() override {
+        while (filaInicio_ < fila_.size()) {
+            uint32_t tam;
+            std::memcpy(&tam, fila_.data() + filaInicio_, sizeof(tam));
+            if (!tx_.tentarEscrever(fila_.data() + filaInicio_ + sizeof(tam), tam)) {
+                if (modo_ == Modo::NaoBloqueante) return true;
+                tx_.aguardarEspaco(tam, politica_);
+                continue;
+            }
+            filaInicio_ += sizeof(tam) + tam;
+        }
+        fila_.clear();
+        filaInicio_ = 0;
+        return true;
+    }
+
+    size_t pendentes() const override { return fila_.size() - filaInicio_; }
+
+    bool tentarReceber(std::string_view& mensagem) override {
+        if (espiado_) {
+            rx_.consumir(); // a view anterior deixa de valer
+            espiado_ = false;
+        }
+        size_t n;
+        const uint8_t* p = rx_.espiar(n);
+        // A flag só é definida depois da última escrita: com ela ativa, um
+        // anel vazio na segunda olhada é o fim
+        if (!p && rx_.encerrado()) p = rx_.espiar(n);
+        if (p) {
+            mensagem = std::string_view((const char*)p, n);
+            espiado_ = true;
+            return true;
+        }
+        if (rx_.encerrado()) {
+            fim_ = true;
+            errno = 0;
+        } else {
+            errno = EAGAIN;
+        }
+        return false;
+    }
+
+    bool receber(std::string_view& mensagem) override {
+        while (!tentarReceber(mensagem)) {
+            if (fim_) return false;
+            rx_.aguardarDados(politica_);
+        }
+        return true;
+    }
+
+private:
+    std::shared_ptr<SegmentoCompartilhado> segmento_;
+    AnelSPSC tx_, rx_;
+    PoliticaEspera politica_;
+    bool espiado_ = false; // registro entregue ainda não consumido
+    std::string fila_;
+    size_t filaInicio_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Ouvintes
+// -----------------------------------------------------------------------------
+class OuvinteSocket : public Ouvinte {
+public:
+    ~OuvinteSocket() override {
+        if (fd_ >= 0) close(fd_);
+        if (!caminho_.empty()) unlink(caminho_.c_str());
+    }
+
+    bool iniciar(const Endereco& e) {
+        endereco_ = e;
+        fd_ = socket(e.familia, e.tipo | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) return false;
+        if (e.local()) {
+            caminho_ = e.caminho();
+            if (!caminho_.empty()) unlink(caminho_.c_str());
+        } else {
+            int um = 1;
+            setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+        }
+        return bind(fd_, (const sockaddr*)&e.addr, e.len) == 0 && listen(fd_, SOMAXCONN) == 0;
+    }
+
+    std::unique_ptr<Canal> aceitar() override {
+        int c;
+        while ((c = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC)) < 0) {
+            if (errno != EINTR) return nullptr;
+        }
+        if (!endereco_.local()) {
+            int um = 1;
+            setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+        }
+        return std::make_unique<CanalDescritor>(c, c, endereco_.descricao, endereco_.maiorEnvio());
+    }
+
+private:
+    Endereco endereco_;
+    int fd_ = -1;
+    std::string caminho_;
+};
+
+// pipe://: o ouvinte cria as duas FIFOs e já abre a de ida para leitura; o par
+// abre a de ida para escrita e depois a de volta para leitura, e só então o
+// ouvinte consegue abrir a de volta para escrita (antes disso: ENXIO). O par
+// abre a de volta em modo bloqueante: ler uma FIFO que ainda não teve escritor
+// daria fim de arquivo.
+class OuvinteFifo : public Ouvinte {
+public:
+    ~OuvinteFifo() override {
+        if (rx_ >= 0) close(rx_);
+        unlink((caminho_ + ".ida").c_str());
+        unlink((caminho_ + ".volta").c_str());
+    }
+
+    bool iniciar(const std::string& caminho) {
+        caminho_ = caminho;
+        for (const char* sufixo : {".ida", ".volta"}) {
+            const std::string fifo = caminho + sufixo;
+            unlink(fifo.c_str());
+            if (mkfifo(fifo.c_str(), 0600) != 0) return false;
+        }
+        rx_ = open((caminho + ".ida").c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (rx_ >= 0) ajustarTamanhoPipe(rx_, TAM_PIPE_PADRAO);
+        return rx_ >= 0;
+    }
+
+    std::unique_ptr<Canal> aceitar() override {
+        if (rx_ < 0) {
+            errno = EISCONN;
+            return nullptr;
+        }
+        int tx;
+        while ((tx = open((caminho_ + ".volta").c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC)) < 0) {
+            if (errno != ENXIO) return nullptr;
+            usleep(1000); // o par ainda não abriu a FIFO de volta
+        }
+        ajustarTamanhoPipe(tx, TAM_PIPE_PADRAO);
+        const int rx = rx_;
+        rx_ = -1;
+        return std::make_unique<CanalDescritor>(rx, tx, "pipe://" + caminho_);
+    }
+
+private:
+    std::string caminho_;
+    int rx_ = -1;
+};
+
+// shm://: o segmento é criado aqui; o canal do ouvinte escreve no primeiro anel
+class OuvinteShm : public Ouvinte {
+public:
+    ~OuvinteShm() override {
+        if (segmento_) segmento_->remover();
+    }
+
+    bool iniciar(const std::string& nome, size_t capacidade) {
+        const size_t tamanhoAnel = AnelSPSC::tamanhoNecessario(capacidade);
+        auto segmento = std::make_shared<SegmentoCompartilhado>();
+        if (!segmento->criar(nome, 2 * tamanhoAnel)) return false;
+        char* base = (char*)segmento->base();
+        AnelSPSC ida, volta;
+        if (!volta.inicializar(base, capacidade) || !ida.inicializar(base + tamanhoAnel, capacidade)) {
+            segmento->remover();
+            errno = EINVAL;
+            return false;
+        }
+        segmento_ = std::move(segmento);
+        nome_ = nome;
+        tamanhoAnel_ = tamanhoAnel;
+        return true;
+    }
+
+    std::unique_ptr<Canal> aceitar() override {
+        if (aceito_) {
+            errno = EISCONN;
+            return nullptr;
+        }
+        aceito_ = true;
+        char* base = (char*)segmento_->base();
+        return std::make_unique<CanalShm>(segmento_, base, base + tamanhoAnel_, "shm:/" + nome_);
+    }
+
+private:
+    std::shared_ptr<SegmentoCompartilhado> segmento_;
+    std::string nome_;
+    size_t tamanhoAnel_ = 0;
+    bool aceito_ = false;
+};
+
+// -----------------------------------------------------------------------------
+// Fábricas
+// -----------------------------------------------------------------------------
+
+// "shm://ipc?capacidade=N" → nome do segmento ("/ipc") e capacidade
+inline bool lerUriShm(std::string_view uri, std::string& nome, size_t& capacidade) {
+    std::string_view resto = uri.substr(6);
+    capacidade = CAPACIDADE_CANAL_SHM;
+    const size_t q = resto.find('?');
+    if (q != std::string_view::npos) {
+        const std::string_view parametro = resto.substr(q + 1);
+        if (parametro.substr(0, 11) != "capacidade=") return false;
+        capacidade = std::strtoull(std::string(parametro.substr(11)).c_str(), nullptr, 10);
+        resto = resto.substr(0, q);
+    }
+    if (resto.empty() || resto.find('/') != std::string_view::npos) return false;
+    nome = "/" + std::string(resto);
+    return true;
+}
+
+inline std::unique_ptr<Ouvinte> ouvirCanal(std::string_view uri) {
+    if (uri.substr(0, 6) == "shm://") {
+        std::string nome;
+        size_t capacidade;
+        auto o = std::make_unique<OuvinteShm>();
+        if (!lerUriShm(uri, nome, capacidade)) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        return o->iniciar(nome, capacidade) ? std::move(o) : nullptr;
+    }
+    if (uri.substr(0, 7) == "pipe://") {
+        auto o = std::make_unique<OuvinteFifo>();
+        return o->iniciar(std::string(uri.substr(7))) ? std::move(o) : nullptr;
+    }
+    Endereco e;
+    if (!resolverEndereco(uri, e)) return nullptr;
+    auto o = std::make_unique<OuvinteSocket>();
+    return o->iniciar(e) ? std::move(o) : nullptr;
+}
+
+inline std::unique_ptr<Canal> conectarCanal(std::string_view uri) {
+    if (uri.substr(0, 6) == "shm://") {
+        std::string nome;
+        size_t capacidade;
+        if (!lerUriShm(uri, nome, capacidade)) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        auto segmento = std::make_shared<SegmentoCompartilhado>();
+        if (!segmento->abrir(nome)) return nullptr;
+        char* base = (char*)segmento->base();
+        AnelSPSC volta;
+        if (!volta.anexar(base)) {
+            errno = EPROTO;
+            return nullptr;
+        }
+        char* ida = base + AnelSPSC::tamanhoNecessario(volta.capacidade());
+        return std::make_unique<CanalShm>(segmento, ida, base, std::string(uri));
+    }
+    if (uri.substr(0, 7) == "pipe://") {
+        const std::string caminho(uri.substr(7));
+        const int tx = open((caminho + ".ida").c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (tx < 0) {
+            if (errno == ENXIO) errno = ECONNREFUSED; // ninguém ouvindo
+            return nullptr;
+        }
+        const int rx = open((caminho + ".volta").c_str(), O_RDONLY | O_CLOEXEC); // espera o aceitar()
+        if (rx < 0) {
+            const int erro = errno;
+            close(tx);
+            errno = erro;
+            return nullptr;
+        }
+        return std::make_unique<CanalDescritor>(rx, tx, std::string(uri));
+    }
+    if (uri.substr(0, 5) == "fd://") {
+        char* fim = nullptr;
+        const std::string fds(uri.substr(5));
+        const long rx = std::strtol(fds.c_str(), &fim, 10);
+        if (*fim != ',') {
+            errno = EINVAL;
+            return nullptr;
+        }
+        const long tx = std::strtol(fim + 1, &fim, 10);
+        if (*fim != '\0' || rx < 0 || tx < 0) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        return std::make_unique<CanalDescritor>((int)rx, (int)tx, std::string(uri));
+    }
+    Endereco e;
+    if (!resolverEndereco(uri, e)) return nullptr;
+    const int fd = socket(e.familia, e.tipo | SOCK_CLOEXEC, 0);
+    if (fd < 0) return nullptr;
+    if (connect(fd, (const sockaddr*)&e.addr, e.len) != 0) {
+        const int erro = errno;
+        close(fd);
+        errno = erro;
+        return nullptr;
+    }
+    if (!e.local()) {
+        int um = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+    }
+    return std::make_unique<CanalDescritor>(fd, fd, e.descricao, e.maiorEnvio());
+}
+
+// Par de pipes anônimos para pai e filho: `a` fica num processo e `b` no
+// outro depois do fork (cada um destrói o que não é seu).
+inline bool criarParPipes(std::unique_ptr<Canal>& a, std::unique_ptr<Canal>& b,
+                          size_t tamanho = TAM_PIPE_PADRAO) {
+    int ida[2], volta[2];
+    if (!criarPipe(ida, tamanho)) return false;
+    if (!criarPipe(volta, tamanho)) {
+        close(ida[0]);
+        close(ida[1]);
+        return false;
+    }
+    a = std::make_unique<CanalDescritor>(volta[0], ida[1], "pipe");
+    b = std::make_unique<CanalDescritor>(ida[0], volta[1], "pipe");
+    return true;
+}
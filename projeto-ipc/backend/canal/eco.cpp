@@ -0,0 +1,156 @@
+// -----------------------------------------------------------------------------
+// eco.cpp — demonstração de canal.h: o mesmo programa sobre qualquer mecanismo.
+//
+//   eco --ouvir=shm://eco             devolve cada mensagem recebida
+//   eco --conectar=shm://eco          envia as linhas digitadas e mostra o eco
+//   eco --conectar=URI --total=N [--lote=L] [--bytes=B]
+//                                     vazão: N mensagens de B bytes, L por lote
+//
+// Qualquer URI de canal.h serve (tcp://, unix://, seqpacket://, pipe://, shm://).
+// -----------------------------------------------------------------------------
+#include <poll.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "canal.h"
+#include "../common/log.h"
+#include "../common/metricas.h"
+
+int ouvir(const std::string& uri) {
+    auto ouvinte = ouvirCanal(uri);
+    if (!ouvinte) {
+        logger(NivelLog::Error, "listen", std::string("Falha ao ouvir: ") + strerror(errno), 0, uri);
+        return 1;
+    }
+    logger(NivelLog::Info, "listen", "Esperando o par", 0, uri);
+    while (true) {
+        auto canal = ouvinte->aceitar();
+        if (!canal && errno == EISCONN) {
+            // pipe:// e shm:// atendem um par por ouvinte: recria para o próximo
+            ouvinte.reset();
+            ouvinte = ouvirCanal(uri);
+            if (ouvinte) continue;
+        }
+        if (!canal) {
+            logger(NivelLog::Error, "accept", strerror(errno), 0, uri);
+            return 1;
+        }
+        logger(NivelLog::Info, "accept", "Par conectado", 0, canal->descricao());
+        // Devolve cada lote recebido num único envio
+        std::vector<std::string> respostas;
+        std::vector<std::string_view> lote;
+        std::string_view m;
+        while (canal->receber(m)) {
+            size_t n = 0;
+            do {
+                contarMetrica(Contador::MensagensRecebidas);
+                contarMetrica(Contador::BytesRecebidos, m.size());
+                if (n == respostas.size()) respostas.emplace_back();
+                respostas[n].assign(m.data(), m.size());
+                ++n;
+            } while (n < 64 && canal->tentarReceber(m));
+            lote.assign(respostas.begin(), respostas.begin() + n);
+            if (!canal->enviarLote(lote.data(), n)) break;
+            contarMetrica(Contador::MensagensEnviadas, n);
+        }
+        logger(NivelLog::Info, "close", canal->fim() ? "Par encerrou" : strerror(errno), 0, canal->descricao());
+    }
+    return 0;
+}
+
+// Envio e eco empacados: dá uma chance ao par (resposta chegando ou espaço
+// para o envio). Sem descritor de escrita na interface, a espera tem prazo.
+static void esperarPar(const Canal& canal) {
+    pollfd p{canal.descritor(), POLLIN, 0};
+    if (p.fd < 0) std::this_thread::yield();
+    else poll(&p, 1, 1);
+}
+
+int conectar(const std::string& uri, size_t total, size_t lote, size_t bytes) {
+    auto canal = conectarCanal(uri);
+    if (!canal) {
+        logger(NivelLog::Error, "connect", std::string("Falha ao conectar: ") + strerror(errno), 0, uri);
+        return 1;
+    }
+    logger(NivelLog::Info, "connect", "Conectado", 0, canal->descricao());
+    std::string_view resposta;
+
+    if (total > 0) {
+        const std::string mensagem(bytes, 'x');
+        const std::vector<std::string_view> mensagens(lote, mensagem);
+        // Um lote maior que o buffer do transporte (pipe://, unix://) não
+        // sai inteiro antes de o par começar a ecoar; enviando bloqueado, os
+        // dois lados esperariam o outro ler. O lote entra na fila local e o
+        // envio se alterna com a recepção.
+        canal->definirModo(Canal::Modo::NaoBloqueante);
+        size_t respondidas = 0;
+        const int64_t inicio = monotonicoNs();
+        while (respondidas < total) {
+            const size_t n = std::min(lote, total - respondidas);
+            if (!canal->enviarLote(mensagens.data(), n)) break;
+            size_t i = 0;
+            while (i < n) {
+                if (canal->tentarReceber(resposta)) {
+                    ++i;
+                    continue;
+                }
+                if (canal->fim() || errno != EAGAIN) break;
+                const size_t antes = canal->pendentes();
+                if (antes == 0) {
+                    // Tudo enviado: as respostas que faltam só dependem do par
+                    if (!canal->receber(resposta)) break;
+                    ++i;
+                    continue;
+                }
+                if (!canal->descarregar()) break;
+                if (canal->pendentes() == antes) esperarPar(*canal);
+            }
+            respondidas += i;
+            if (i < n) break;
+        }
+        const double segundos = segundosEntre(inicio, monotonicoNs());
+        std::string resumo = std::to_string(respondidas) + " respostas em " + std::to_string(segundos) +
+                             " s (" + std::to_string((uint64_t)(respondidas / segundos)) + " msg/s, lote " +
+                             std::to_string(lote) + ", " + uri + ")";
+        logTexto(resumo);
+        logger(respondidas < total ? NivelLog::Error : NivelLog::Info, "vazao", resumo, (int64_t)respondidas);
+        return respondidas < total ? 1 : 0;
+    }
+
+    std::string linha;
+    while (true) {
+        logTexto("Digite a mensagem (sair para terminar): ", false);
+        descarregarLog();
+        if (!std::getline(std::cin, linha) || linha == "sair") break;
+        if (!canal->enviar(linha) || !canal->receber(resposta)) {
+            logger(NivelLog::Error, "recv", canal->fim() ? "Par encerrou" : strerror(errno), 0, uri);
+            return 1;
+        }
+        logTexto("Eco: ", resposta);
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    iniciarLog("canal", "eco");
+    iniciarMetricas("canal", "eco");
+    std::string ouvirEm, conectarEm;
+    size_t total = 0, lote = 1, bytes = 16;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--ouvir=", 0) == 0) ouvirEm = arg.substr(8);
+        else if (arg.rfind("--conectar=", 0) == 0) conectarEm = arg.substr(11);
+        else if (arg.rfind("--total=", 0) == 0) total = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--lote=", 0) == 0) lote = std::max<size_t>(1, std::strtoull(arg.c_str() + 7, nullptr, 10));
+        else if (arg.rfind("--bytes=", 0) == 0) bytes = std::strtoull(arg.c_str() + 8, nullptr, 10);
+    }
+    if (!ouvirEm.empty()) return ouvir(ouvirEm);
+    if (!conectarEm.empty()) return conectar(conectarEm, total, lote, bytes);
+    std::cerr << "uso: eco --ouvir=URI | --conectar=URI [--total=N --lote=L --bytes=B]\n";
+    return 1;
+}
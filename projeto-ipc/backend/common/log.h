@@ -0,0 +1,500 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// log.h — logging assíncrono compartilhado por todos os módulos.
+//
+// Cada thread grava seus registros num anel de bytes próprio, pré-alocado
+// (TAM_ANEL_LOG); gravar é só copiar os campos para o anel, sem alocação,
+// sem formatação e sem syscall. Um thread de fundo drena os anéis, monta as
+// linhas JSON (uma por registro, compactas) e as entrega em lote com um
+// único fwrite + fflush.
+//
+// Lote: o thread de fundo acorda a cada IPC_LOG_LOTE_MS (padrão 5 ms) e
+// escreve tudo o que juntou; uma thread só o acorda antes disso quando o
+// próprio anel passa de LIMIAR_LOTE_LOG. IPC_LOG_LOTE_MS=0 entrega cada
+// registro assim que possível.
+//
+//   iniciarLog("sockets", "server");          // campos "module" e "role"
+//   logger(NivelLog::Info, "accept", "Client connected", 0, peer);
+//   logTexto("Servidor aguardando conexões...");  // linha de texto livre
+//
+// Saída (uma linha por registro):
+//   {"module":"sockets","role":"server","pid":4242,"seq":17,"level":"INFO",
+//    "event":"accept","ts":"2025-09-04T12:34:56.123456Z","mono":81234567890123,
+//    "details":{"msg":"...","bytes":0,"peer":"..."}}
+// "seq" numera os registros do processo (`pid`) a partir de 1; registros
+// descartados com o anel cheio também consomem números, então um salto na
+// sequência mostra a quem lê quantos se perderam.
+// "mono" é o instante do registro em CLOCK_MONOTONIC (ns, ver relogio.h),
+// comparável entre processos: a latência de uma mensagem sai da diferença
+// entre o "mono" de quem enviou e o de quem recebeu.
+//
+// Filtro de nível:
+//  - compilação: -DLOG_NIVEL_MINIMO=N (0 debug, 1 info, 2 warn, 3 error) faz
+//    as chamadas abaixo de N sumirem do binário;
+//  - execução: variável de ambiente IPC_LOG_NIVEL=debug|info|warn|error|off
+//    (lida em iniciarLog) ou definirNivelLog().
+//
+// Formato (IPC_LOG_FORMATO, lida em iniciarLog):
+//  - texto (padrão): os textos de logTexto() saem como estão, entre as linhas
+//    JSON, para quem está no terminal;
+//  - ndjson: para um processo que controla o backend (ex.: o frontend). Todo
+//    registro é uma linha JSON, inclusive os textos ({..."seq":3,"text":"..."}),
+//    e cada write leva só linhas inteiras e no máximo PIPE_BUF bytes, que o
+//    kernel não intercala com a escrita de outro processo no mesmo pipe.
+//
+// Anel cheio: o registro é descartado (o caminho quente nunca espera) e o
+// thread de fundo avisa quantos foram perdidos. Textos de logTexto() e
+// registros de uma mesma thread saem na ordem em que foram gravados.
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "relogio.h"
+
+#ifndef LOG_NIVEL_MINIMO
+#define LOG_NIVEL_MINIMO 0
+#endif
+
+enum class NivelLog : uint8_t { Debug = 0, Info = 1, Warn = 2, Error = 3, Desligado = 4 };
+
+constexpr NivelLog NIVEL_LOG_COMPILACAO = (NivelLog)LOG_NIVEL_MINIMO;
+constexpr size_t TAM_ANEL_LOG = 256 * 1024;   // por thread; potência de 2
+constexpr size_t MAIOR_CAMPO_LOG = 16 * 1024; // campos maiores são truncados
+constexpr size_t LIMIAR_LOTE_LOG = TAM_ANEL_LOG / 4; // acorda o thread de fundo antes do prazo
+constexpr uint32_t LOTE_LOG_PADRAO_MS = 5;
+
+inline std::atomic<uint8_t> nivelLogExecucao{(uint8_t)NivelLog::Debug};
+
+inline void definirNivelLog(NivelLog nivel) {
+    nivelLogExecucao.store((uint8_t)nivel, std::memory_order_relaxed);
+}
+
+inline bool logAtivo(NivelLog nivel) {
+    return nivel >= NIVEL_LOG_COMPILACAO &&
+           (uint8_t)nivel >= nivelLogExecucao.load(std::memory_order_relaxed);
+}
+
+// -----------------------------------------------------------------------------
+// Anel de bytes de um produtor (a thread dona) e um consumidor (o thread de
+// fundo). Registros: [u32 tamanho][cabeçalho][campos], alinhados a 8; um
+// tamanho MARCA_PULO_LOG manda o leitor voltar ao início do anel.
+// -----------------------------------------------------------------------------
+constexpr uint32_t MARCA_PULO_LOG = 0xFFFFFFFFu;
+
+struct CabecalhoRegistroLog {
+    uint32_t tamanho;   // registro inteiro, antes do alinhamento
+    uint8_t nivel;
+    uint8_t texto;      // 1 = logTexto (sem JSON)
+    uint16_t tamEvento;
+    uint32_t tamMsg;
+    uint16_t tamPeer;
+    uint16_t reservado;
+    int64_t bytes;
+    int64_t mono;       // monotonicoNs() na gravação
+};
+
+class AnelLog {
+public:
+    AnelLog() : dados_(new char[TAM_ANEL_LOG]) {}
+
+    // Reserva `n` bytes contíguos; nullptr se não há espaço.
+    char* reservar(size_t n) {
+        const uint64_t escrita = escrita_.load(std::memory_order_relaxed);
+        size_t pos = escrita & (TAM_ANEL_LOG - 1);
+        size_t pulo = (TAM_ANEL_LOG - pos < n) ? TAM_ANEL_LOG - pos : 0;
+        if (escrita + pulo + n - leituraCache_ > TAM_ANEL_LOG) {
+            leituraCache_ = leitura_.load(std::memory_order_acquire);
+            if (escrita + pulo + n - leituraCache_ > TAM_ANEL_LOG) return nullptr;
+        }
+        if (pulo) {
+            // Sobra no fim do anel: marca e recomeça do início
+            std::memcpy(dados_.get() + pos, &MARCA_PULO_LOG, sizeof(uint32_t));
+            pos = 0;
+        }
+        pendente_ = pulo + n;
+        return dados_.get() + pos;
+    }
+
+    void publicar() { escrita_.fetch_add(pendente_, std::memory_order_release); }
+
+    // Produtor: bytes ainda não drenados (estimativa por cima: usa a última
+    // leitura vista)
+    size_t ocupados() const { return escrita_.load(std::memory_order_relaxed) - leituraCache_; }
+
+    // Consumidor: próximo registro ou nullptr.
+    const CabecalhoRegistroLog* espiar() {
+        while (true) {
+            const uint64_t leitura = leitura_.load(std::memory_order_relaxed);
+            if (leitura == escrita_.load(std::memory_order_acquire)) return nullptr;
+            const size_t pos = leitura & (TAM_ANEL_LOG - 1);
+            uint32_t tam;
+            std::memcpy(&tam, dados_.get() + pos, sizeof(tam));
+            if (tam == MARCA_PULO_LOG) {
+                leitura_.store(leitura + (TAM_ANEL_LOG - pos), std::memory_order_release);
+                continue;
+            }
+            return (const CabecalhoRegistroLog*)(dados_.get() + pos);
+        }
+    }
+
+    void consumir(const CabecalhoRegistroLog* r) {
+        leitura_.fetch_add(alinhar(r->tamanho), std::memory_order_release);
+    }
+
+    static size_t alinhar(size_t n) { return (n + 7) & ~size_t(7); }
+
+    std::atomic<uint64_t> perdidos{0};  // registros descartados por falta de espaço
+    std::atomic<bool> encerrado{false}; // a thread dona terminou
+
+private:
+    std::unique_ptr<char[]> dados_;
+    alignas(64) std::atomic<uint64_t> escrita_{0};
+    uint64_t leituraCache_ = 0;
+    size_t pendente_ = 0;
+    alignas(64) std::atomic<uint64_t> leitura_{0};
+};
+
+// -----------------------------------------------------------------------------
+// Estado global: anéis registrados + thread de fundo que os drena.
+// -----------------------------------------------------------------------------
+class SistemaLog {
+public:
+    static SistemaLog& instancia() {
+        static SistemaLog s;
+        return s;
+    }
+
+    void configurar(std::string_view modulo, std::string_view papel) {
+        std::lock_guard<std::mutex> trava(mutex_);
+        prefixo_ = "{\"module\":\"";
+        escapar(prefixo_, modulo);
+        prefixo_ += "\",\"role\":\"";
+        escapar(prefixo_, papel);
+        prefixo_ += "\",\"pid\":";
+        prefixo_ += std::to_string(getpid());
+        prefixo_ += ",\"seq\":";
+    }
+
+    void definirFormato(bool ndjson) {
+        std::lock_guard<std::mutex> trava(mutexDreno_);
+        ndjson_ = ndjson;
+    }
+
+    void definirLote(uint32_t ms) { loteMs_.store(ms, std::memory_order_relaxed); }
+    uint32_t loteMs() const { return loteMs_.load(std::memory_order_relaxed); }
+
+    AnelLog* registrarAnel() {
+        std::lock_guard<std::mutex> trava(mutex_);
+        aneis_.push_back(std::make_unique<AnelLog>());
+        return aneis_.back().get();
+    }
+
+    // Chamado pelos produtores depois de publicar: só acorda o thread de fundo
+    // se ele estiver dormindo (sob carga ele nunca dorme e ninguém notifica).
+    void avisar() {
+        if (dormindo_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> trava(mutexSono_);
+            acordar_ = true;
+            sono_.notify_one();
+        }
+    }
+
+    // Escreve agora tudo o que já foi gravado (ex.: antes de um fork ou exit).
+    void descarregar() {
+        std::lock_guard<std::mutex> trava(mutexDreno_);
+        drenar();
+    }
+
+    ~SistemaLog() {
+        {
+            std::lock_guard<std::mutex> trava(mutexSono_);
+            parar_ = true;
+            sono_.notify_one();
+        }
+        if (thread_.joinable()) thread_.join();
+        descarregar();
+    }
+
+private:
+    SistemaLog() { thread_ = std::thread([this] { executar(); }); }
+
+    void executar() {
+        while (true) {
+            size_t escritos;
+            {
+                std::lock_guard<std::mutex> trava(mutexDreno_);
+                escritos = drenar();
+            }
+            const uint32_t lote = loteMs();
+            if (escritos > 0 && lote == 0) continue;
+
+            std::unique_lock<std::mutex> trava(mutexSono_);
+            if (parar_) return;
+            dormindo_.store(true, std::memory_order_relaxed);
+            // Com lote, o prazo é o próprio intervalo. Sem lote, o tempo
+            // limite cobre a corrida entre um produtor ler dormindo_ e este
+            // thread começar a esperar
+            sono_.wait_for(trava, std::chrono::milliseconds(lote ? lote : 50),
+                           [this] { return acordar_ || parar_; });
+            dormindo_.store(false, std::memory_order_relaxed);
+            acordar_ = false;
+        }
+    }
+
+    // Formata tudo o que estiver nos anéis e escreve de uma vez.
+    size_t drenar() {
+        saida_.clear();
+        relogio_.recalibrar();
+        {
+            std::lock_guard<std::mutex> trava(mutex_);
+            for (size_t i = 0; i < aneis_.size();) {
+                AnelLog& anel = *aneis_[i];
+                const bool encerrado = anel.encerrado.load(std::memory_order_acquire);
+                while (const CabecalhoRegistroLog* r = anel.espiar()) {
+                    formatar(*r);
+                    anel.consumir(r);
+                }
+                if (uint64_t perdidos = anel.perdidos.exchange(0, std::memory_order_relaxed)) {
+                    seq_ += perdidos; // o salto na sequência conta os perdidos
+                    formatarPerda(perdidos);
+                }
+                if (encerrado) { // já drenado; a thread não grava mais nele
+                    aneis_.erase(aneis_.begin() + i);
+                    continue;
+                }
+                ++i;
+            }
+        }
+        if (!saida_.empty()) {
+            if (ndjson_) escreverLinhas();
+            else {
+                std::fwrite(saida_.data(), 1, saida_.size(), stdout);
+                std::fflush(stdout);
+            }
+        }
+        return saida_.size();
+    }
+
+    // ndjson: writes de linhas inteiras com até PIPE_BUF bytes (atômicos num
+    // pipe); uma linha maior que isso vai sozinha.
+    void escreverLinhas() {
+        std::fflush(stdout); // o que outra parte do programa tenha posto no stdio
+        size_t inicio = 0;
+        while (inicio < saida_.size()) {
+            size_t fim = inicio;
+            while (fim < saida_.size()) {
+                const size_t quebra = saida_.find('\n', fim);
+                const size_t proxima = quebra == std::string::npos ? saida_.size() : quebra + 1;
+                if (proxima - inicio > PIPE_BUF && fim > inicio) break;
+                fim = proxima;
+            }
+            while (inicio < fim) {
+                const ssize_t r = ::write(STDOUT_FILENO, saida_.data() + inicio, fim - inicio);
+                if (r < 0 && errno == EINTR) continue;
+                if (r <= 0) return; // sem stdout não há a quem avisar
+                inicio += (size_t)r;
+            }
+        }
+    }
+
+    // {"module":...,"pid":...,"seq":N
+    void abrirRegistro() {
+        saida_ += prefixo_;
+        saida_ += std::to_string(++seq_);
+    }
+
+    void formatar(const CabecalhoRegistroLog& r) {
+        const char* p = (const char*)(&r + 1);
+        std::string_view evento(p, r.tamEvento);
+        std::string_view msg(p + r.tamEvento, r.tamMsg);
+        std::string_view peer(p + r.tamEvento + r.tamMsg, r.tamPeer);
+        if (r.texto && ndjson_) {
+            abrirRegistro();
+            saida_ += ",\"text\":\"";
+            escapar(saida_, evento); // prefixo opcional de logTexto
+            escapar(saida_, msg);
+            saida_ += "\"}\n";
+            return;
+        }
+        if (r.texto) {
+            saida_ += evento;
+            saida_ += msg;
+            if (r.nivel) saida_ += '\n'; // no texto, `nivel` indica a quebra de linha
+            return;
+        }
+        static const char* const nomes[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+        abrirRegistro();
+        saida_ += ",\"level\":\"";
+        saida_ += nomes[r.nivel & 3];
+        saida_ += "\",\"event\":\"";
+        escapar(saida_, evento);
+        formatarInstante(r.mono);
+        saida_ += ",\"details\":{\"msg\":\"";
+        escapar(saida_, msg);
+        saida_ += "\",\"bytes\":";
+        saida_ += std::to_string(r.bytes);
+        saida_ += ",\"peer\":\"";
+        escapar(saida_, peer);
+        saida_ += "\"}}\n";
+    }
+
+    void formatarPerda(uint64_t perdidos) {
+        abrirRegistro();
+        saida_ += ",\"level\":\"WARN\",\"event\":\"log";
+        formatarInstante(monotonicoNs());
+        saida_ += ",\"details\":{\"msg\":\"registros de log descartados (anel cheio)\",\"bytes\":";
+        saida_ += std::to_string(perdidos);
+        saida_ += ",\"peer\":\"\"}}\n";
+    }
+
+    // ","ts":"<ISO 8601>","mono":<ns>
+    void formatarInstante(int64_t mono) {
+        char data[TAM_DATA_ISO];
+        formatarDataIso(relogio_.paraParede(mono), data);
+        saida_ += "\",\"ts\":\"";
+        saida_ += data;
+        saida_ += "\",\"mono\":";
+        saida_ += std::to_string(mono);
+    }
+
+    static void escapar(std::string& s, std::string_view texto) {
+        for (char c : texto) {
+            switch (c) {
+            case '"':  s += "\\\""; break;
+            case '\\': s += "\\\\"; break;
+            case '\n': s += "\\n"; break;
+            case '\r': s += "\\r"; break;
+            case '\t': s += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char u[8];
+                    std::snprintf(u, sizeof(u), "\\u%04x", (unsigned)c);
+                    s += u;
+                } else {
+                    s += c;
+                }
+            }
+        }
+    }
+
+    std::mutex mutex_;      // aneis_ e prefixo_
+    std::mutex mutexDreno_; // um dreno por vez (thread de fundo ou descarregar)
+    std::vector<std::unique_ptr<AnelLog>> aneis_;
+    std::string prefixo_ = "{\"module\":\"ipc\",\"role\":\"\",\"pid\":" + std::to_string(getpid()) + ",\"seq\":";
+    std::string saida_;
+    uint64_t seq_ = 0;     // último número dado (só o dreno mexe)
+    bool ndjson_ = false;
+    std::atomic<uint32_t> loteMs_{LOTE_LOG_PADRAO_MS};
+    RelogioParede relogio_;
+
+    std::mutex mutexSono_;
+    std::condition_variable sono_;
+    std::atomic<bool> dormindo_{false};
+    bool acordar_ = false;
+    bool parar_ = false;
+    std::thread thread_;
+};
+
+// Anel da thread atual, criado no primeiro registro e marcado como encerrado
+// quando a thread termina (o thread de fundo o drena e libera).
+inline AnelLog* anelLogDaThread() {
+    struct Guarda {
+        AnelLog* anel = SistemaLog::instancia().registrarAnel();
+        ~Guarda() {
+            anel->encerrado.store(true, std::memory_order_release);
+            SistemaLog::instancia().avisar();
+        }
+    };
+    thread_local Guarda guarda;
+    return guarda.anel;
+}
+
+inline void gravarLog(bool texto, uint8_t nivel, std::string_view evento, std::string_view msg,
+                      int64_t bytes, std::string_view peer) {
+    if (evento.size() > 255) evento = evento.substr(0, 255);
+    if (msg.size() > MAIOR_CAMPO_LOG) msg = msg.substr(0, MAIOR_CAMPO_LOG);
+    if (peer.size() > 255) peer = peer.substr(0, 255);
+    const size_t tamanho = sizeof(CabecalhoRegistroLog) + evento.size() + msg.size() + peer.size();
+
+    AnelLog* anel = anelLogDaThread();
+    char* p = anel->reservar(AnelLog::alinhar(tamanho));
+    if (!p) {
+        anel->perdidos.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    CabecalhoRegistroLog r;
+    r.tamanho = (uint32_t)tamanho;
+    r.nivel = nivel;
+    r.texto = texto;
+    r.tamEvento = (uint16_t)evento.size();
+    r.tamMsg = (uint32_t)msg.size();
+    r.tamPeer = (uint16_t)peer.size();
+    r.reservado = 0;
+    r.bytes = bytes;
+    r.mono = monotonicoNs();
+    std::memcpy(p, &r, sizeof(r));
+    p += sizeof(r);
+    std::memcpy(p, evento.data(), evento.size());
+    std::memcpy(p + evento.size(), msg.data(), msg.size());
+    std::memcpy(p + evento.size() + msg.size(), peer.data(), peer.size());
+    anel->publicar();
+    SistemaLog& sistema = SistemaLog::instancia();
+    if (sistema.loteMs() == 0 || anel->ocupados() >= LIMIAR_LOTE_LOG) sistema.avisar();
+}
+
+// -----------------------------------------------------------------------------
+// API usada pelos módulos
+// -----------------------------------------------------------------------------
+
+// Define "module"/"role" dos registros e lê IPC_LOG_NIVEL, IPC_LOG_FORMATO e
+// IPC_LOG_LOTE_MS.
+inline void iniciarLog(std::string_view modulo, std::string_view papel) {
+    SistemaLog& sistema = SistemaLog::instancia();
+    sistema.configurar(modulo, papel);
+    if (const char* formato = std::getenv("IPC_LOG_FORMATO")) {
+        sistema.definirFormato(std::string_view(formato) == "ndjson");
+    }
+    if (const char* lote = std::getenv("IPC_LOG_LOTE_MS")) {
+        sistema.definirLote((uint32_t)std::strtoul(lote, nullptr, 10));
+    }
+    if (const char* nivel = std::getenv("IPC_LOG_NIVEL")) {
+        std::string_view n(nivel);
+        if (n == "debug") definirNivelLog(NivelLog::Debug);
+        else if (n == "info") definirNivelLog(NivelLog::Info);
+        else if (n == "warn") definirNivelLog(NivelLog::Warn);
+        else if (n == "error") definirNivelLog(NivelLog::Error);
+        else if (n == "off") definirNivelLog(NivelLog::Desligado);
+    }
+}
+
+inline void logger(NivelLog nivel, std::string_view evento, std::string_view msg,
+                   int64_t bytes = 0, std::string_view peer = {}) {
+    if (!logAtivo(nivel)) return;
+    gravarLog(false, (uint8_t)nivel, evento, msg, bytes, peer);
+}
+
+// Linha de texto livre (mensagens para o usuário), na mesma ordem dos
+// registros da thread. Não passa pelo filtro de nível.
+inline void logTexto(std::string_view texto, bool quebraLinha = true) {
+    gravarLog(true, quebraLinha, {}, texto, 0, {});
+}
+
+// prefixo + texto numa linha, sem concatenar (nem alocar) no chamador.
+inline void logTexto(std::string_view prefixo, std::string_view texto) {
+    gravarLog(true, true, prefixo, texto, 0, {});
+}
+
+inline void descarregarLog() { SistemaLog::instancia().descarregar(); }
@@ -0,0 +1,221 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// mensagem.h — mensagens binárias tipadas, lidas no lugar.
+//
+// Layout (inteiros na ordem do host: as mensagens não saem da máquina):
+//
+//   +-----------+-----------+---------+-----------+--------------+
+//   | marca u8  | versao u8 | tipo u8 | campos u8 | tamanho u32  |  8 bytes
+//   +-----------+-----------+---------+-----------+--------------+
+//   | id u8 | tipoCampo u8 | valor ...                            |  campo 1
+//   | ...                                                        |  campo N
+//
+//   valor: U32 = 4 bytes; U64/I64/F64 = 8 bytes;
+//          Texto/Bytes = tamanho u32 + dados (UTF-8 no Texto, sem '\0')
+//   `tamanho` conta a mensagem inteira, cabeçalho incluído.
+//
+// A marca 0xFF nunca aparece no início de um texto UTF-8 válido, então o mesmo
+// canal aceita mensagens de texto puro e binárias (pareceMensagem()).
+// Campos com id desconhecido são ignorados por quem lê: dá para acrescentar
+// campos sem quebrar leitores antigos.
+//
+// Escrita: EscritorMensagem acrescenta a mensagem num std::string do chamador
+// (reaproveitado, não aloca depois de aquecido). Leitura: VisaoMensagem valida
+// o buffer uma vez e devolve os campos como valores ou string_view apontando
+// para o próprio buffer (recv, pipe ou segmento compartilhado), sem cópia e
+// sem objetos no heap.
+// -----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+constexpr uint8_t MARCA_MENSAGEM = 0xFF;
+constexpr uint8_t VERSAO_MENSAGEM = 1;
+constexpr size_t TAM_CABECALHO_MENSAGEM = 8;
+constexpr size_t MAX_CAMPOS_MENSAGEM = 32; // além disso a mensagem é recusada
+
+enum class TipoMensagem : uint8_t {
+    Comando  = 1,
+    Resposta = 2,
+    Evento   = 3, // publicação sem resposta (ex.: writer → readers)
+};
+
+enum class TipoCampo : uint8_t { U32 = 1, U64 = 2, I64 = 3, F64 = 4, Texto = 5, Bytes = 6 };
+
+// Ids de campo usados pelos módulos
+enum class Campo : uint8_t {
+    Texto      = 1, // conteúdo da mensagem (comando, resposta, linha digitada)
+    Seq        = 2, // número de sequência de quem publicou
+    EnviadoEm  = 3, // monotonicoNs() de quem enviou; ecoado nas respostas
+    Origem     = 4, // pid de quem respondeu
+    Valor      = 5, // resultado numérico (ex.: "primos <n>")
+    Referencia = 6, // deslocamento de um objeto na arena do segmento (arena.h)
+};
+
+inline bool pareceMensagem(std::string_view dados) {
+    return !dados.empty() && (uint8_t)dados[0] == MARCA_MENSAGEM;
+}
+
+// -----------------------------------------------------------------------------
+// EscritorMensagem: acrescenta uma mensagem em `destino`.
+//
+//   EscritorMensagem m(buffer, TipoMensagem::Comando);
+//   m.texto(Campo::Texto, "ping").i64(Campo::EnviadoEm, monotonicoNs());
+//   m.fechar();
+// -----------------------------------------------------------------------------
+class EscritorMensagem {
+public:
+    EscritorMensagem(std::string& destino, TipoMensagem tipo) : d_(destino), inicio_(destino.size()) {
+        const char cab[TAM_CABECALHO_MENSAGEM] = {(char)MARCA_MENSAGEM, (char)VERSAO_MENSAGEM, (char)tipo};
+        d_.append(cab, sizeof(cab));
+    }
+
+    EscritorMensagem& u32(Campo id, uint32_t v) { return fixo(id, TipoCampo::U32, &v, 4); }
+    EscritorMensagem& u64(Campo id, uint64_t v) { return fixo(id, TipoCampo::U64, &v, 8); }
+    EscritorMensagem& i64(Campo id, int64_t v) { return fixo(id, TipoCampo::I64, &v, 8); }
+    EscritorMensagem& f64(Campo id, double v) { return fixo(id, TipoCampo::F64, &v, 8); }
+
+    EscritorMensagem& texto(Campo id, std::string_view v) {
+        return variavel(id, TipoCampo::Texto, v.data(), v.size());
+    }
+    EscritorMensagem& bytes(Campo id, const void* dados, size_t n) {
+        return variavel(id, TipoCampo::Bytes, dados, n);
+    }
+
+    // Grava a quantidade de campos e o tamanho no cabeçalho; devolve o tamanho.
+    size_t fechar() {
+        const uint32_t tamanho = (uint32_t)(d_.size() - inicio_);
+        d_[inicio_ + 3] = (char)campos_;
+        std::memcpy(&d_[inicio_ + 4], &tamanho, 4);
+        return tamanho;
+    }
+
+private:
+    EscritorMensagem& fixo(Campo id, TipoCampo tipo, const void* v, size_t n) {
+        const char cab[2] = {(char)id, (char)tipo};
+        d_.append(cab, 2);
+        d_.append((const char*)v, n);
+        ++campos_;
+        return *this;
+    }
+
+    EscritorMensagem& variavel(Campo id, TipoCampo tipo, const void* v, size_t n) {
+        const uint32_t tam = (uint32_t)n;
+        const char cab[2] = {(char)id, (char)tipo};
+        d_.append(cab, 2);
+        d_.append((const char*)&tam, 4);
+        d_.append((const char*)v, n);
+        ++campos_;
+        return *this;
+    }
+
+    std::string& d_;
+    size_t inicio_;
+    uint8_t campos_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// VisaoMensagem: leitura no lugar. As string_view devolvidas apontam para o
+// buffer passado a abrir() e valem enquanto ele valer.
+// -----------------------------------------------------------------------------
+class VisaoMensagem {
+public:
+    // Valida cabeçalho e campos (limites, tipos) e guarda onde cada um começa.
+    bool abrir(const void* dados, size_t n) {
+        campos_ = 0;
+        const uint8_t* p = (const uint8_t*)dados;
+        if (n < TAM_CABECALHO_MENSAGEM || p[0] != MARCA_MENSAGEM || p[1] != VERSAO_MENSAGEM) return false;
+        uint32_t tamanho;
+        std::memcpy(&tamanho, p + 4, 4);
+        if (tamanho < TAM_CABECALHO_MENSAGEM || tamanho > n || p[3] > MAX_CAMPOS_MENSAGEM) return false;
+
+        size_t pos = TAM_CABECALHO_MENSAGEM;
+        for (uint8_t i = 0; i < p[3]; ++i) {
+            if (tamanho - pos < 2) return false;
+            Lido& c = lidos_[i];
+            c.id = p[pos];
+            c.tipo = (TipoCampo)p[pos + 1];
+            pos += 2;
+            switch (c.tipo) {
+            case TipoCampo::U32: c.tamanho = 4; break;
+            case TipoCampo::U64:
+            case TipoCampo::I64:
+            case TipoCampo::F64: c.tamanho = 8; break;
+            case TipoCampo::Texto:
+            case TipoCampo::Bytes:
+                if (tamanho - pos < 4) return false;
+                std::memcpy(&c.tamanho, p + pos, 4);
+                pos += 4;
+                break;
+            default: return false; // tipo desconhecido: não há como pular o valor
+            }
+            if (tamanho - pos < c.tamanho) return false;
+            c.dados = (const char*)p + pos;
+            pos += c.tamanho;
+        }
+        if (pos != tamanho) return false;
+        base_ = (const char*)p;
+        tamanho_ = tamanho;
+        campos_ = p[3];
+        return true;
+    }
+
+    TipoMensagem tipo() const { return (TipoMensagem)base_[2]; }
+    size_t tamanho() const { return tamanho_; }
+    size_t campos() const { return campos_; }
+    bool tem(Campo id) const { return achar(id) != nullptr; }
+
+    // Texto ou Bytes; `padrao` se o campo faltar ou tiver outro tipo
+    std::string_view texto(Campo id, std::string_view padrao = {}) const {
+        const Lido* c = achar(id);
+        if (!c || (c->tipo != TipoCampo::Texto && c->tipo != TipoCampo::Bytes)) return padrao;
+        return std::string_view(c->dados, c->tamanho);
+    }
+
+    // Inteiros: aceita U32, U64 e I64 (convertidos)
+    uint64_t u64(Campo id, uint64_t padrao = 0) const {
+        const Lido* c = achar(id);
+        if (!c) return padrao;
+        if (c->tipo == TipoCampo::U32) {
+            uint32_t v;
+            std::memcpy(&v, c->dados, 4);
+            return v;
+        }
+        if (c->tipo != TipoCampo::U64 && c->tipo != TipoCampo::I64) return padrao;
+        uint64_t v;
+        std::memcpy(&v, c->dados, 8);
+        return v;
+    }
+    int64_t i64(Campo id, int64_t padrao = 0) const { return tem(id) ? (int64_t)u64(id) : padrao; }
+    uint32_t u32(Campo id, uint32_t padrao = 0) const { return tem(id) ? (uint32_t)u64(id) : padrao; }
+
+    double f64(Campo id, double padrao = 0) const {
+        const Lido* c = achar(id);
+        if (!c || c->tipo != TipoCampo::F64) return padrao;
+        double v;
+        std::memcpy(&v, c->dados, 8);
+        return v;
+    }
+
+private:
+    struct Lido {
+        uint8_t id;
+        TipoCampo tipo;
+        uint32_t tamanho;
+        const char* dados;
+    };
+
+    const Lido* achar(Campo id) const {
+        for (size_t i = 0; i < campos_; ++i) {
+            if (lidos_[i].id == (uint8_t)id) return &lidos_[i];
+        }
+        return nullptr;
+    }
+
+    const char* base_ = nullptr;
+    size_t tamanho_ = 0;
+    size_t campos_ = 0;
+    Lido lidos_[MAX_CAMPOS_MENSAGEM];
+};
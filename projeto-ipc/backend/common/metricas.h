@@ -0,0 +1,337 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// metricas.h — contadores e histogramas de latência por thread, com fotos
+// periódicas publicadas numa página de memória compartilhada.
+//
+// Caminho quente (qualquer thread):
+//   contarMetrica(Contador::BytesEnviados, n);
+//   medirLatencia(Latencia::Envio, monotonicoNs() - t0);
+// Cada thread tem o próprio bloco de contadores e histogramas e é o único que
+// escreve nele: incrementar é um load + store relaxed (sem lock, sem
+// instrução atômica de leitura-modificação-escrita, sem linha compartilhada).
+//
+// Histogramas no estilo HDR: valores em ns em faixas log-lineares, 32 faixas
+// por potência de 2 (erro relativo de ~3%), de 0 a ~4,8 h.
+//
+// Um thread de fundo soma os blocos a cada IPC_METRICAS_MS (padrão 1000; 0
+// desliga) e grava uma linha JSON compacta em /dev/shm/ipc_metricas_<módulo>_
+// <papel>_<pid>:
+//   {"module":"sockets","role":"server","pid":4242,"ts":"...","mono":...,
+//    "intervalo_s":1.000,
+//    "total":{"msgs_env":...,"bytes_env":...,"msgs_rec":...,"bytes_rec":...,"erros":...},
+//    "taxa":{...mesmos campos, por segundo no intervalo...},
+//    "lat_ns":{"envio":{"n":...,"p50":...,"p99":...,"p999":...,"max":...},
+//              "recebimento":{...},"espera":{...}}}
+// Percentis e taxas são do último intervalo; "total" acumula desde o início.
+//
+// Layout da página: [u32 seq][u32 tamanho][texto]. `seq` é ímpar enquanto a
+// foto é reescrita: quem lê confere se `seq` é par e igual antes e depois da
+// cópia (seqlock), senão lê de novo.
+// -----------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "relogio.h"
+
+enum class Contador : uint8_t {
+    MensagensEnviadas, BytesEnviados, MensagensRecebidas, BytesRecebidos, Erros, Quantidade
+};
+
+// Envio: duração do envio; Recebimento: duração da recepção (ou ida e volta,
+// no cliente); Espera: tempo parado numa fila (resposta aguardando o kernel,
+// anel cheio, reader estacionado sem dados)
+enum class Latencia : uint8_t { Envio, Recebimento, Espera, Quantidade };
+
+constexpr size_t QTD_CONTADORES = (size_t)Contador::Quantidade;
+constexpr size_t QTD_LATENCIAS = (size_t)Latencia::Quantidade;
+
+constexpr unsigned BITS_SUB_HDR = 5;        // 32 faixas por potência de 2
+constexpr unsigned MAIOR_EXPOENTE_HDR = 44; // 2^44 ns ≈ 4,8 h
+constexpr size_t FAIXAS_HDR = (size_t)(MAIOR_EXPOENTE_HDR - BITS_SUB_HDR + 2) << BITS_SUB_HDR;
+constexpr size_t TAM_PAGINA_METRICAS = 4096;
+
+// Faixa de um valor: linear até 2^BITS_SUB_HDR, depois 32 faixas iguais
+// dentro de cada potência de 2.
+inline size_t faixaHdr(uint64_t v) {
+    if (v < (1u << BITS_SUB_HDR)) return (size_t)v;
+    const unsigned m = 63 - (unsigned)__builtin_clzll(v);
+    if (m > MAIOR_EXPOENTE_HDR) return FAIXAS_HDR - 1;
+    return ((size_t)(m - BITS_SUB_HDR + 1) << BITS_SUB_HDR) +
+           (size_t)((v >> (m - BITS_SUB_HDR)) - (1u << BITS_SUB_HDR));
+}
+
+// Maior valor que cai na faixa `i`
+inline uint64_t limiteFaixaHdr(size_t i) {
+    if (i < (1u << BITS_SUB_HDR)) return i;
+    const unsigned e = (unsigned)(i >> BITS_SUB_HDR) - 1;
+    const uint64_t sub = (i & ((1u << BITS_SUB_HDR) - 1)) + (1u << BITS_SUB_HDR);
+    return ((sub + 1) << e) - 1;
+}
+
+// Bloco de uma thread: só ela escreve; o thread de fundo só lê.
+struct BlocoMetricas {
+    std::atomic<uint64_t> contadores[QTD_CONTADORES] = {};
+    std::atomic<uint64_t> faixas[QTD_LATENCIAS][FAIXAS_HDR] = {};
+    std::atomic<bool> encerrado{false};
+
+    static void incrementar(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+// Soma (não atômica) de vários blocos, usada nas fotos
+struct SomaMetricas {
+    uint64_t contadores[QTD_CONTADORES] = {};
+    uint64_t faixas[QTD_LATENCIAS][FAIXAS_HDR] = {};
+
+    void somar(const BlocoMetricas& b) {
+        for (size_t i = 0; i < QTD_CONTADORES; ++i) contadores[i] += b.contadores[i].load(std::memory_order_relaxed);
+        for (size_t h = 0; h < QTD_LATENCIAS; ++h) {
+            for (size_t i = 0; i < FAIXAS_HDR; ++i) faixas[h][i] += b.faixas[h][i].load(std::memory_order_relaxed);
+        }
+    }
+
+    void somar(const SomaMetricas& s) {
+        for (size_t i = 0; i < QTD_CONTADORES; ++i) contadores[i] += s.contadores[i];
+        for (size_t h = 0; h < QTD_LATENCIAS; ++h) {
+            for (size_t i = 0; i < FAIXAS_HDR; ++i) faixas[h][i] += s.faixas[h][i];
+        }
+    }
+};
+
+// -----------------------------------------------------------------------------
+// Estado global: blocos registrados + thread de fundo que publica as fotos.
+// -----------------------------------------------------------------------------
+class SistemaMetricas {
+public:
+    static SistemaMetricas& instancia() {
+        static SistemaMetricas s;
+        return s;
+    }
+
+    BlocoMetricas* registrarBloco() {
+        std::lock_guard<std::mutex> trava(mutex_);
+        blocos_.push_back(std::make_unique<BlocoMetricas>());
+        return blocos_.back().get();
+    }
+
+    void iniciar(std::string_view modulo, std::string_view papel) {
+        long intervalo = 1000;
+        if (const char* v = std::getenv("IPC_METRICAS_MS")) intervalo = std::strtol(v, nullptr, 10);
+        if (intervalo <= 0 || thread_.joinable()) return;
+#ifndef _WIN32
+        nome_ = "/ipc_metricas_" + std::string(modulo) + "_" + std::string(papel) + "_" +
+                std::to_string(getpid());
+        int fd = shm_open(nome_.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0644);
+        if (fd < 0) return;
+        void* p = MAP_FAILED;
+        if (ftruncate(fd, TAM_PAGINA_METRICAS) == 0) {
+            p = mmap(nullptr, TAM_PAGINA_METRICAS, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (p == MAP_FAILED) {
+            shm_unlink(nome_.c_str());
+            return;
+        }
+        pagina_ = (char*)p;
+        cabecalho_ = "{\"module\":\"" + std::string(modulo) + "\",\"role\":\"" + std::string(papel) +
+                     "\",\"pid\":" + std::to_string(getpid());
+        intervalo_ = std::chrono::milliseconds(intervalo);
+        anteriorMono_ = monotonicoNs();
+        thread_ = std::thread([this] { executar(); });
+#else
+        (void)modulo;
+        (void)papel;
+#endif
+    }
+
+    ~SistemaMetricas() {
+        {
+            std::lock_guard<std::mutex> trava(mutexSono_);
+            parar_ = true;
+            sono_.notify_one();
+        }
+        if (thread_.joinable()) thread_.join();
+#ifndef _WIN32
+        if (pagina_) {
+            munmap(pagina_, TAM_PAGINA_METRICAS);
+            shm_unlink(nome_.c_str());
+        }
+#endif
+    }
+
+private:
+    SistemaMetricas() = default;
+
+    void executar() {
+        std::unique_lock<std::mutex> trava(mutexSono_);
+        while (!sono_.wait_for(trava, intervalo_, [this] { return parar_; })) {
+            publicar();
+        }
+    }
+
+    // Soma todos os blocos; os de threads encerradas são incorporados em
+    // aposentados_ e liberados.
+    void somarTudo(SomaMetricas& total) {
+        std::lock_guard<std::mutex> trava(mutex_);
+        for (size_t i = 0; i < blocos_.size();) {
+            BlocoMetricas& b = *blocos_[i];
+            if (b.encerrado.load(std::memory_order_acquire)) {
+                aposentados_.somar(b);
+                blocos_.erase(blocos_.begin() + i);
+                continue;
+            }
+            total.somar(b);
+            ++i;
+        }
+        total.somar(aposentados_);
+    }
+
+    void publicar() {
+        auto atual = std::make_unique<SomaMetricas>();
+        somarTudo(*atual);
+        const int64_t agora = monotonicoNs();
+        const double segundos = std::max(segundosEntre(anteriorMono_, agora), 1e-9);
+
+        static const char* const nomesContadores[] = {"msgs_env", "bytes_env", "msgs_rec", "bytes_rec", "erros"};
+        static const char* const nomesLatencias[] = {"envio", "recebimento", "espera"};
+        char data[TAM_DATA_ISO];
+        formatarDataIso(paredeNs(), data);
+        std::string json = cabecalho_;
+        char num[400]; // folga para qualquer double em %f
+        std::snprintf(num, sizeof(num), ",\"ts\":\"%s\",\"mono\":%lld,\"intervalo_s\":%.3f", data,
+                      (long long)agora, segundos);
+        json += num;
+        json += ",\"total\":{";
+        for (size_t i = 0; i < QTD_CONTADORES; ++i) {
+            std::snprintf(num, sizeof(num), "%s\"%s\":%llu", i ? "," : "", nomesContadores[i],
+                          (unsigned long long)atual->contadores[i]);
+            json += num;
+        }
+        json += "},\"taxa\":{";
+        for (size_t i = 0; i < QTD_CONTADORES; ++i) {
+            std::snprintf(num, sizeof(num), "%s\"%s\":%.1f", i ? "," : "", nomesContadores[i],
+                          (atual->contadores[i] - anterior_.contadores[i]) / segundos);
+            json += num;
+        }
+        json += "},\"lat_ns\":{";
+        for (size_t h = 0; h < QTD_LATENCIAS; ++h) {
+            // Histograma do intervalo = acumulado agora - acumulado na foto anterior
+            uint64_t faixas[FAIXAS_HDR];
+            uint64_t n = 0;
+            size_t maior = 0;
+            for (size_t i = 0; i < FAIXAS_HDR; ++i) {
+                faixas[i] = atual->faixas[h][i] - anterior_.faixas[h][i];
+                n += faixas[i];
+                if (faixas[i]) maior = i;
+            }
+            auto percentil = [&](double q) -> uint64_t {
+                if (n == 0) return 0;
+                const uint64_t alvo = std::max<uint64_t>(1, (uint64_t)(q * n + 0.5));
+                uint64_t acumulado = 0;
+                for (size_t i = 0; i < FAIXAS_HDR; ++i) {
+                    acumulado += faixas[i];
+                    if (acumulado >= alvo) return limiteFaixaHdr(i);
+                }
+                return limiteFaixaHdr(maior);
+            };
+            std::snprintf(num, sizeof(num), "%s\"%s\":{\"n\":%llu,", h ? "," : "", nomesLatencias[h],
+                          (unsigned long long)n);
+            json += num;
+            std::snprintf(num, sizeof(num), "\"p50\":%llu,\"p99\":%llu,",
+                          (unsigned long long)percentil(0.50), (unsigned long long)percentil(0.99));
+            json += num;
+            std::snprintf(num, sizeof(num), "\"p999\":%llu,\"max\":%llu}",
+                          (unsigned long long)percentil(0.999),
+                          (unsigned long long)(n ? limiteFaixaHdr(maior) : 0));
+            json += num;
+        }
+        json += "}}\n";
+
+        escreverPagina(json);
+        anterior_ = *atual;
+        anteriorMono_ = agora;
+    }
+
+    void escreverPagina(const std::string& json) {
+        auto* seq = (std::atomic<uint32_t>*)pagina_;
+        const size_t n = std::min(json.size(), TAM_PAGINA_METRICAS - 2 * sizeof(uint32_t));
+        const uint32_t s = seq->load(std::memory_order_relaxed);
+        seq->store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        const uint32_t tam = (uint32_t)n;
+        std::memcpy(pagina_ + sizeof(uint32_t), &tam, sizeof(tam));
+        std::memcpy(pagina_ + 2 * sizeof(uint32_t), json.data(), n);
+        seq->store(s + 2, std::memory_order_release);
+    }
+
+    std::mutex mutex_; // blocos_ e aposentados_
+    std::vector<std::unique_ptr<BlocoMetricas>> blocos_;
+    SomaMetricas aposentados_;
+
+    SomaMetricas anterior_;   // acumulado na foto anterior
+    int64_t anteriorMono_ = 0;
+    std::string cabecalho_;
+    std::string nome_;
+    char* pagina_ = nullptr;
+    std::chrono::milliseconds intervalo_{1000};
+
+    std::mutex mutexSono_;
+    std::condition_variable sono_;
+    bool parar_ = false;
+    std::thread thread_;
+};
+
+// Bloco da thread atual, criado no primeiro uso e marcado como encerrado
+// quando a thread termina (o thread de fundo incorpora os números e o libera).
+// O ponteiro é um thread_local trivial: o caminho quente não passa pelo
+// wrapper de inicialização que um thread_local com destrutor exigiria.
+inline BlocoMetricas* registrarBlocoDaThread() {
+    struct Guarda {
+        BlocoMetricas* bloco = SistemaMetricas::instancia().registrarBloco();
+        ~Guarda() { bloco->encerrado.store(true, std::memory_order_release); }
+    };
+    thread_local Guarda guarda;
+    return guarda.bloco;
+}
+
+inline BlocoMetricas& metricasDaThread() {
+    static thread_local BlocoMetricas* bloco = nullptr;
+    if (!bloco) bloco = registrarBlocoDaThread();
+    return *bloco;
+}
+
+// -----------------------------------------------------------------------------
+// API usada pelos módulos
+// -----------------------------------------------------------------------------
+
+// Começa a publicar fotos (se IPC_METRICAS_MS não for 0). Sem esta chamada os
+// números continuam sendo contados, só não são publicados.
+inline void iniciarMetricas(std::string_view modulo, std::string_view papel) {
+    SistemaMetricas::instancia().iniciar(modulo, papel);
+}
+
+inline void contarMetrica(Contador c, uint64_t n = 1) {
+    BlocoMetricas::incrementar(metricasDaThread().contadores[(size_t)c], n);
+}
+
+inline void medirLatencia(Latencia l, int64_t ns) {
+    const size_t faixa = faixaHdr(ns > 0 ? (uint64_t)ns : 0);
+    BlocoMetricas::incrementar(metricasDaThread().faixas[(size_t)l][faixa], 1);
+}
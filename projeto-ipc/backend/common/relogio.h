@@ -0,0 +1,102 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// relogio.h — relógio compartilhado pelos módulos.
+//
+//  - monotonicoNs(): nanossegundos de CLOCK_MONOTONIC (steady_clock). No Linux
+//    é lido pelo vDSO a partir do TSC, sem syscall, e é o mesmo para todos os
+//    processos da máquina: a diferença entre o "mono" de dois registros de log
+//    (ex.: Escrita no writer e Leitura no reader) é a latência da mensagem.
+//  - paredeNs(): tempo de parede (ns desde a época), para datas legíveis.
+//  - RelogioParede: converte instantes monotônicos em tempo de parede por um
+//    deslocamento medido em recalibrar(), para quem registra ler um relógio só.
+//  - formatarDataIso(): "2025-09-04T12:34:56.123456Z" num buffer do chamador,
+//    sem alocar; a parte até os segundos fica em cache por thread e só é
+//    recalculada quando o segundo muda.
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
+inline int64_t monotonicoNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline int64_t paredeNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Intervalo em segundos entre dois instantes de monotonicoNs()
+inline double segundosEntre(int64_t inicioNs, int64_t fimNs) {
+    return (double)(fimNs - inicioNs) / 1e9;
+}
+
+// -----------------------------------------------------------------------------
+// Relógio de parede derivado do monotônico. O deslocamento muda quando o NTP
+// ajusta a hora; recalibrar() de tempos em tempos (o thread de fundo do log o
+// chama a cada lote) acompanha esses ajustes.
+// -----------------------------------------------------------------------------
+class RelogioParede {
+public:
+    RelogioParede() { recalibrar(); }
+
+    void recalibrar() {
+        // Média de duas leituras monotônicas em volta da de parede
+        const int64_t antes = monotonicoNs();
+        const int64_t parede = paredeNs();
+        const int64_t depois = monotonicoNs();
+        deslocamento_.store(parede - (antes + (depois - antes) / 2), std::memory_order_relaxed);
+    }
+
+    int64_t paraParede(int64_t mono) const {
+        return mono + deslocamento_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> deslocamento_{0};
+};
+
+// "AAAA-MM-DDTHH:MM:SS.uuuuuuZ" + '\0'
+constexpr size_t TAM_DATA_ISO = 28;
+
+// Escreve a data (UTC, microssegundos) de `parede` (ns desde a época) em
+// `destino` e devolve o tamanho sem o '\0'. Seguro entre threads.
+inline size_t formatarDataIso(int64_t parede, char (&destino)[TAM_DATA_ISO]) {
+    struct Cache {
+        int64_t segundo = INT64_MIN;
+        char texto[20]; // "AAAA-MM-DDTHH:MM:SS"
+    };
+    thread_local Cache cache;
+
+    int64_t segundo = parede / 1000000000;
+    int64_t resto = parede % 1000000000;
+    if (resto < 0) { // antes da época
+        --segundo;
+        resto += 1000000000;
+    }
+    if (segundo != cache.segundo) {
+        const time_t t = (time_t)segundo;
+        std::tm tm{};
+#ifdef _WIN32
+        gmtime_s(&tm, &t);
+#else
+        gmtime_r(&t, &tm);
+#endif
+        std::strftime(cache.texto, sizeof(cache.texto), "%Y-%m-%dT%H:%M:%S", &tm);
+        cache.segundo = segundo;
+    }
+    std::memcpy(destino, cache.texto, 19);
+    destino[19] = '.';
+    uint32_t micros = (uint32_t)(resto / 1000);
+    for (int i = 25; i >= 20; --i) {
+        destino[i] = (char)('0' + micros % 10);
+        micros /= 10;
+    }
+    destino[26] = 'Z';
+    destino[27] = '\0';
+    return TAM_DATA_ISO - 1;
+}
@@ -0,0 +1,331 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// canal_pipe.h — canal pai ↔ filho sobre pipes anônimos POSIX.
+//
+//  - criarPipe(): pipe2(O_CLOEXEC) e buffer do kernel ampliado com
+//    F_SETPIPE_SZ (o padrão de 64 KiB obriga o escritor a dormir a cada 16
+//    páginas em transferências grandes).
+//  - Mensagens usam os mesmos quadros dos sockets (../sockets/protocolo.h):
+//    cabeçalho de 12 bytes com o tamanho, então qualquer tamanho até
+//    MAIOR_PAYLOAD atravessa o pipe inteiro, sem truncar nem partir.
+//  - EscritorPipe junta vários quadros e os envia com um único writev: os
+//    cabeçalhos ficam num buffer interno e os payloads são referenciados no
+//    lugar, sem cópia.
+//  - Corpos grandes vão como quadros de bloco (FLAG_BLOCO): de um arquivo
+//    com splice (cache de páginas → pipe) e da memória com vmsplice (as
+//    páginas entram no pipe por referência). Quem lê pode mandar o corpo
+//    direto para um arquivo com splice (pipe → arquivo).
+// -----------------------------------------------------------------------------
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../sockets/protocolo.h"
+
+constexpr size_t TAM_PIPE_PADRAO = 1 << 20; // 1 MiB de buffer no kernel
+
+// Maior buffer que um processo sem CAP_SYS_RESOURCE pode pedir
+inline size_t tamanhoMaximoPipe() {
+    size_t maximo = 0;
+    if (FILE* f = std::fopen("/proc/sys/fs/pipe-max-size", "r")) {
+        unsigned long v = 0;
+        if (std::fscanf(f, "%lu", &v) == 1) maximo = v;
+        std::fclose(f);
+    }
+    return maximo;
+}
+
+// Ajusta o buffer do pipe para `desejado` bytes (limitado a pipe-max-size) e
+// devolve o tamanho efetivo; o kernel arredonda para uma potência de 2 de
+// páginas. Se o ajuste falhar, o pipe segue com o tamanho que já tinha.
+inline size_t ajustarTamanhoPipe(int fd, size_t desejado) {
+    if (fcntl(fd, F_SETPIPE_SZ, (int)std::min<size_t>(desejado, INT_MAX)) < 0 && errno == EPERM) {
+        const size_t maximo = tamanhoMaximoPipe();
+        if (maximo > 0) fcntl(fd, F_SETPIPE_SZ, (int)std::min<size_t>(maximo, INT_MAX));
+    }
+    const int atual = fcntl(fd, F_GETPIPE_SZ);
+    return atual > 0 ? (size_t)atual : 0;
+}
+
+// pipe2 com O_CLOEXEC: fds[0] leitura, fds[1] escrita.
+inline bool criarPipe(int fds[2], size_t tamanho = TAM_PIPE_PADRAO) {
+    if (pipe2(fds, O_CLOEXEC) != 0) return false;
+    if (tamanho > 0) ajustarTamanhoPipe(fds[1], tamanho);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Escrita completa: write/writev devolvem menos que o pedido quando o pipe
+// enche no meio (ou num sinal); estes laços continuam de onde pararam.
+// -----------------------------------------------------------------------------
+inline bool escreverTudo(int fd, const void* dados, size_t n) {
+    const char* p = (const char*)dados;
+    while (n > 0) {
+        ssize_t r = ::write(fd, p, n);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+inline bool escreverVetor(int fd, iovec* iov, size_t quantidade) {
+    while (quantidade > 0) {
+        ssize_t r = ::writev(fd, iov, (int)std::min<size_t>(quantidade, IOV_MAX));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        // Pula os vetores já escritos e ajusta o primeiro parcial
+        size_t escritos = (size_t)r;
+        while (quantidade > 0 && escritos >= iov->iov_len) {
+            escritos -= iov->iov_len;
+            ++iov;
+            --quantidade;
+        }
+        if (quantidade > 0) {
+            iov->iov_base = (char*)iov->iov_base + escritos;
+            iov->iov_len -= escritos;
+        }
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// EscritorPipe: acumula quadros e os envia num único writev.
+//
+//   EscritorPipe saida(fd);
+//   saida.enfileirar(TipoQuadro::Comando, 1, "ping");   // payload por referência
+//   saida.enfileirarCopia(TipoQuadro::Resposta, 2, r);  // payload copiado
+//   saida.descarregar();
+//
+// enfileirar() não copia o payload: ele precisa continuar válido até o
+// descarregar(). enfileirarCopia() serve para payloads temporários.
+// -----------------------------------------------------------------------------
+class EscritorPipe {
+public:
+    explicit EscritorPipe(int fd = -1) : fd_(fd) {}
+
+    void definirDescritor(int fd) { fd_ = fd; }
+    int descritor() const { return fd_; }
+
+    void enfileirar(TipoQuadro tipo, uint32_t seq, std::string_view payload) {
+        enfileirarCabecalho(tipo, seq, (uint32_t)payload.size(), 0);
+        if (!payload.empty()) partes_.push_back({payload.data(), 0, payload.size()});
+        bytes_ += payload.size();
+    }
+
+    void enfileirarCopia(TipoQuadro tipo, uint32_t seq, std::string_view payload) {
+        // Cabeçalho e payload ficam contíguos no buffer interno: um vetor só
+        const size_t inicio = internos_.size();
+        codificarQuadro(internos_, tipo, seq, payload);
+        partes_.push_back({nullptr, inicio, TAM_CABECALHO + payload.size()});
+        bytes_ += TAM_CABECALHO + payload.size();
+        ++quadros_;
+    }
+
+    // Quadro montado direto no buffer interno (ex.: EscritorMensagem sobre o
+    // std::string devolvido); fecharQuadro() registra o tamanho final.
+    std::string& abrirQuadro(TipoQuadro tipo, uint32_t seq) {
+        quadroAberto_ = ::abrirQuadro(internos_, tipo, seq);
+        return internos_;
+    }
+
+    void fecharQuadro() {
+        ::fecharQuadro(internos_, quadroAberto_);
+        const size_t tamanho = internos_.size() - quadroAberto_;
+        partes_.push_back({nullptr, quadroAberto_, tamanho});
+        bytes_ += tamanho;
+        ++quadros_;
+    }
+
+    // Só o cabeçalho de um bloco; o corpo segue com enviarBlocoArquivo/Memoria
+    // depois do descarregar().
+    void enfileirarCabecalhoBloco(TipoQuadro tipo, uint32_t seq, uint32_t tamanho) {
+        enfileirarCabecalho(tipo, seq, tamanho, FLAG_BLOCO);
+    }
+
+    size_t quadros() const { return quadros_; }
+    size_t bytes() const { return bytes_; }
+    bool vazio() const { return partes_.empty(); }
+
+    // Envia tudo o que foi enfileirado (writev em lotes de até IOV_MAX).
+    bool descarregar() {
+        if (partes_.empty()) return true;
+        iovecs_.clear();
+        for (const Parte& p : partes_) {
+            // Endereços do buffer interno só são resolvidos aqui: ele pode ter
+            // sido realocado enquanto os quadros eram enfileirados
+            const char* base = p.externo ? p.externo : internos_.data() + p.offset;
+            if (!iovecs_.empty() && !p.externo && iovecs_.back().iov_base != nullptr &&
+                (const char*)iovecs_.back().iov_base + iovecs_.back().iov_len == base) {
+                iovecs_.back().iov_len += p.tamanho; // contíguo ao anterior: junta
+                continue;
+            }
+            iovecs_.push_back({(void*)base, p.tamanho});
+        }
+        const bool ok = escreverVetor(fd_, iovecs_.data(), iovecs_.size());
+        partes_.clear();
+        internos_.clear();
+        quadros_ = 0;
+        bytes_ = 0;
+        return ok;
+    }
+
+private:
+    struct Parte {
+        const char* externo; // payload do chamador, ou nullptr = internos_
+        size_t offset;       // posição em internos_
+        size_t tamanho;
+    };
+
+    void enfileirarCabecalho(TipoQuadro tipo, uint32_t seq, uint32_t tamanho, uint8_t flags) {
+        const size_t inicio = internos_.size();
+        codificarCabecalho(internos_, tipo, seq, tamanho, flags);
+        partes_.push_back({nullptr, inicio, TAM_CABECALHO});
+        bytes_ += TAM_CABECALHO;
+        ++quadros_;
+    }
+
+    int fd_;
+    std::string internos_;       // cabeçalhos + payloads copiados
+    std::vector<Parte> partes_;
+    std::vector<iovec> iovecs_;  // reaproveitado entre descargas
+    size_t quadros_ = 0;
+    size_t bytes_ = 0;
+    size_t quadroAberto_ = 0;    // início do quadro de abrirQuadro()
+};
+
+// -----------------------------------------------------------------------------
+// Corpos de bloco
+// -----------------------------------------------------------------------------
+
+// Envia `tamanho` bytes de `fdArquivo` (a partir de `offset`) com splice: as
+// páginas vão do cache direto para o pipe, sem passar pelo processo. Se o
+// sistema de arquivos não suportar splice, cai para read + write.
+inline bool enviarBlocoArquivo(int fdPipe, int fdArquivo, off_t offset, size_t tamanho) {
+    while (tamanho > 0) {
+        ssize_t n = splice(fdArquivo, &offset, fdPipe, nullptr, tamanho, SPLICE_F_MORE);
+        if (n > 0) {
+            tamanho -= (size_t)n;
+            continue;
+        }
+        if (n == 0) return false; // arquivo encolheu no meio
+        if (errno == EINTR) continue;
+        if (errno != EINVAL && errno != ENOSYS) return false;
+        char buffer[64 * 1024];
+        while (tamanho > 0) {
+            ssize_t r = pread(fdArquivo, buffer, std::min(tamanho, sizeof(buffer)), offset);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0 || !escreverTudo(fdPipe, buffer, (size_t)r)) return false;
+            offset += r;
+            tamanho -= (size_t)r;
+        }
+    }
+    return true;
+}
+
+// Envia `dados` com vmsplice: as páginas do chamador entram no pipe por
+// referência. Elas não podem ser alteradas até o leitor consumir o corpo
+// (ex.: um arquivo mapeado somente leitura, ou um buffer que só será reusado
+// depois da resposta do outro lado).
+inline bool enviarBlocoMemoria(int fdPipe, const void* dados, size_t tamanho) {
+    iovec iov{(void*)dados, tamanho};
+    while (iov.iov_len > 0) {
+        ssize_t n = vmsplice(fdPipe, &iov, 1, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL || errno == ENOSYS) {
+                return escreverTudo(fdPipe, iov.iov_base, iov.iov_len);
+            }
+            return false;
+        }
+        iov.iov_base = (char*)iov.iov_base + n;
+        iov.iov_len -= (size_t)n;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// LeitorPipe: lê em blocos grandes e entrega quadros completos.
+// -----------------------------------------------------------------------------
+class LeitorPipe {
+public:
+    explicit LeitorPipe(int fd = -1) : fd_(fd) {}
+
+    void definirDescritor(int fd) { fd_ = fd; }
+    int descritor() const { return fd_; }
+
+    // Próximo quadro. Retorna false no fim do pipe, num erro de leitura ou
+    // num quadro inválido; `fim` distingue o fechamento normal.
+    // Estado::Bloco deixa o corpo no pipe para receberBloco().
+    bool proximo(Quadro& q, bool& fim) {
+        fim = false;
+        while (true) {
+            auto estado = entrada_.proximo(q);
+            if (estado == DecodificadorQuadros::Estado::Quadro ||
+                estado == DecodificadorQuadros::Estado::Bloco) {
+                return true;
+            }
+            if (estado == DecodificadorQuadros::Estado::Erro) return false;
+            ssize_t n = ::read(fd_, buffer_, sizeof(buffer_));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                fim = n == 0;
+                return false;
+            }
+            entrada_.alimentar(buffer_, (size_t)n);
+        }
+    }
+
+    // Bytes já lidos do pipe que ainda não foram entregues. Como quem escreve
+    // só manda quadros inteiros, menos que um cabeçalho significa que não há
+    // outro quadro a caminho neste lote.
+    size_t pendentesNoBuffer() const { return entrada_.pendentes(); }
+
+    // Consome o corpo de um bloco de `tamanho` bytes. Com fdDestino >= 0 o
+    // que ainda está no pipe vai para o arquivo com splice (sem cópia pelo
+    // processo); sem destino, o corpo é lido e descartado.
+    bool receberBloco(size_t tamanho, int fdDestino = -1) {
+        // Parte do corpo pode ter vindo no mesmo read do cabeçalho
+        while (tamanho > 0 && entrada_.pendentes() > 0) {
+            char parte[64 * 1024];
+            const size_t n = entrada_.tirar(parte, std::min(tamanho, sizeof(parte)));
+            if (fdDestino >= 0 && !escreverTudo(fdDestino, parte, n)) return false;
+            tamanho -= n;
+        }
+        while (tamanho > 0) {
+            ssize_t n;
+            if (fdDestino >= 0) {
+                n = splice(fd_, nullptr, fdDestino, nullptr, tamanho, SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                    // Destino sem suporte a splice (ex.: terminal): cópia comum
+                    n = ::read(fd_, buffer_, std::min(tamanho, sizeof(buffer_)));
+                    if (n > 0 && !escreverTudo(fdDestino, buffer_, (size_t)n)) return false;
+                }
+            } else {
+                n = ::read(fd_, buffer_, std::min(tamanho, sizeof(buffer_)));
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            tamanho -= (size_t)n;
+        }
+        return true;
+    }
+
+private:
+    int fd_;
+    DecodificadorQuadros entrada_;
+    char buffer_[64 * 1024];
+};
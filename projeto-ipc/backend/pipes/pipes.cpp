@@ -1,145 +1,518 @@
-#include <windows.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
-#include <sstream>
-#include <chrono>
-#include <iomanip>
-
-// Função para gerar timestamp em formato ISO 8601
-std::string getTimestamp() {
-    using namespace std::chrono;
-    auto now = system_clock::now();
-    std::time_t now_time = system_clock::to_time_t(now);
-    std::tm* utc_tm = std::gmtime(&now_time);
-    std::ostringstream oss;
-    oss << std::put_time(utc_tm, "%Y-%m-%dT%H:%M:%SZ");
-    return oss.str();
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "canal_pipe.h"
+#include "pool_pipes.h"
+#include "../common/log.h"
+#include "../common/metricas.h"
+#include "../common/mensagem.h"
+
+// Função de tratamento de erro simples
+void ErrorExit(const std::string& msg) {
+    logger(NivelLog::Error, "Erro crítico", msg, errno);
+    descarregarLog();
+    exit(1);
 }
 
-// Função para escapar aspas e caracteres especiais em JSON
-std::string escape_json(const std::string &s) {
-    std::string result;
-    for (char c : s) {
-        if (c == '\"') result += "\\\"";
-        else result += c;
+// --binario: comandos vão como mensagens binárias (common/mensagem.h) e o
+// filho responde no mesmo formato
+bool mensagensBinarias = false;
+
+// Acrescenta o payload de um comando em `destino`, em texto ou binário
+void codificarComando(std::string& destino, std::string_view comando) {
+    if (!mensagensBinarias) {
+        destino.append(comando.data(), comando.size());
+        return;
     }
-    return result;
+    EscritorMensagem m(destino, TipoMensagem::Comando);
+    m.texto(Campo::Texto, comando).i64(Campo::EnviadoEm, monotonicoNs());
+    m.fechar();
 }
 
-// Logger em JSON para pipes
-void logger(const std::string& role, const std::string& level, 
-            const std::string& event, const std::string& msg, int bytes = 0) {
-    std::ostringstream oss;
-    oss << "{\n"
-        << "  \"module\": \"ipc\",\n"
-        << "  \"role\": \"" << role << "\",\n"
-        << "  \"level\": \"" << level << "\",\n"
-        << "  \"event\": \"" << event << "\",\n"
-        << "  \"ts\": \"" << getTimestamp() << "\",\n"
-        << "  \"details\": {\n"
-        << "    \"msg\": \"" << escape_json(msg) << "\",\n"
-        << "    \"bytes\": " << bytes << "\n"
-        << "  }\n"
-        << "}";
-    std::cout << oss.str() << std::endl;
+// Enfileira um comando; em texto o payload aponta para `comando`, que precisa
+// viver até o descarregar()
+void enfileirarComando(EscritorPipe& saida, uint32_t seq, std::string_view comando) {
+    if (!mensagensBinarias) {
+        saida.enfileirar(TipoQuadro::Comando, seq, comando);
+        return;
+    }
+    codificarComando(saida.abrirQuadro(TipoQuadro::Comando, seq), comando);
+    saida.fecharQuadro();
 }
 
-// Função de tratamento de erro simples
-void ErrorExit(const std::string& msg) {
-    logger("pai", "error", "Erro crítico", msg);
-    exit(1);
+// Texto de uma resposta; as binárias são lidas no lugar, sem cópia
+std::string_view textoResposta(std::string_view payload) {
+    VisaoMensagem v;
+    if (pareceMensagem(payload) && v.abrir(payload.data(), payload.size())) return v.texto(Campo::Texto);
+    return payload;
 }
 
-int main(int argc, char* argv[]) {
+// Área constante de onde saem os blocos de "bloco <bytes>": é preenchida uma
+// vez e protegida contra escrita, então pode entrar no pipe por vmsplice
+// sem risco de ser alterada antes de o pai ler.
+struct AreaBlocos {
+    void* base = MAP_FAILED;
+    size_t tamanho = 0;
 
-    // Processo filho
-    if (argc > 1 && std::string(argv[1]) == "child") {
-        HANDLE hRead = (HANDLE)std::stoull(argv[2]);
-        HANDLE hWrite = (HANDLE)std::stoull(argv[3]);
-        DWORD bytesRead;
-        char buffer[256];
+    bool preparar(size_t n) {
+        if (n <= tamanho) return true;
+        if (base != MAP_FAILED) munmap(base, tamanho);
+        base = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            tamanho = 0;
+            return false;
+        }
+        for (size_t i = 0; i < n; ++i) ((char*)base)[i] = (char)('a' + i % 26);
+        mprotect(base, n, PROT_READ);
+        tamanho = n;
+        return true;
+    }
+};
 
-        while (true) {
-            if (!ReadFile(hRead, buffer, sizeof(buffer) - 1, &bytesRead, NULL) || bytesRead == 0) break;
-            buffer[bytesRead] = '\0';
-            logger("filho", "info", "Mensagem recebida", buffer, bytesRead);
+// Trabalho de CPU para o pool: quantos primos há até `n` (crivo)
+size_t contarPrimos(size_t n) {
+    if (n < 2) return 0;
+    std::vector<bool> composto(n + 1, false);
+    size_t primos = 0;
+    for (size_t i = 2; i <= n; ++i) {
+        if (composto[i]) continue;
+        ++primos;
+        for (size_t j = i * i; j <= n; j += i) composto[j] = true;
+    }
+    return primos;
+}
 
-            std::string resp = "Filho recebeu: " + std::string(buffer);
-            DWORD bytesWritten;
-            WriteFile(hWrite, resp.c_str(), (DWORD)resp.size(), &bytesWritten, NULL);
-            logger("filho", "info", "Mensagem enviada", resp, bytesWritten);
+// Separa "a;b;c" em comandos (views sobre `linha`); uma linha vazia vira um
+// comando vazio
+std::vector<std::string_view> separarComandos(const std::string& linha) {
+    std::vector<std::string_view> comandos;
+    size_t comeco = 0;
+    while (comeco <= linha.size()) {
+        size_t fim = linha.find(';', comeco);
+        if (fim == std::string::npos) fim = linha.size();
+        if (fim > comeco || linha.empty()) comandos.emplace_back(linha.data() + comeco, fim - comeco);
+        comeco = fim + 1;
+    }
+    return comandos;
+}
+
+// "arquivo <caminho>" e "bloco <bytes>": o cabeçalho sai junto com o que já
+// estava enfileirado e o corpo vai direto para o pipe (splice do arquivo ou
+// vmsplice da área). Retorna false se o pipe falhou.
+bool responderBloco(EscritorPipe& saida, AreaBlocos& area, uint32_t seq, std::string_view comando) {
+    const bool deArquivo = comando[0] == 'a';
+    const std::string argumento(comando.substr(deArquivo ? 8 : 6));
+    int fd = -1;
+    size_t tamanho = 0;
+    bool ok;
+    if (deArquivo) {
+        fd = open(argumento.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st{};
+        ok = fd >= 0 && fstat(fd, &st) == 0 && (uint64_t)st.st_size <= UINT32_MAX;
+        tamanho = ok ? (size_t)st.st_size : 0;
+    } else {
+        tamanho = std::strtoull(argumento.c_str(), nullptr, 10);
+        ok = tamanho <= UINT32_MAX && area.preparar(tamanho);
+    }
+    if (!ok) {
+        saida.enfileirarCopia(TipoQuadro::Resposta, seq, "Erro: " + argumento);
+        contarMetrica(Contador::Erros);
+        if (fd >= 0) close(fd);
+        return true;
+    }
+    const int64_t inicio = monotonicoNs();
+    saida.enfileirarCabecalhoBloco(TipoQuadro::Resposta, seq, (uint32_t)tamanho);
+    ok = saida.descarregar() &&
+         (deArquivo ? enviarBlocoArquivo(saida.descritor(), fd, 0, tamanho)
+                    : enviarBlocoMemoria(saida.descritor(), area.base, tamanho));
+    if (fd >= 0) close(fd);
+    if (!ok) {
+        logger(NivelLog::Error, "Erro ao enviar bloco", argumento, errno);
+        contarMetrica(Contador::Erros);
+        return false;
+    }
+    medirLatencia(Latencia::Envio, monotonicoNs() - inicio);
+    contarMetrica(Contador::MensagensEnviadas);
+    contarMetrica(Contador::BytesEnviados, tamanho);
+    logger(NivelLog::Info, "Bloco enviado", argumento, (int64_t)tamanho);
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Processo filho: lê os quadros disponíveis, responde a cada um e devolve as
+// respostas do lote num único writev.
+// -----------------------------------------------------------------------------
+int executarFilho(int fdLeitura, int fdEscrita, const char* papel) {
+    iniciarLog("ipc", papel);
+    iniciarMetricas("ipc", papel);
+    LeitorPipe entrada(fdLeitura);
+    EscritorPipe saida(fdEscrita);
+    AreaBlocos area;
+    bool encerrar = false;
 
-            if (std::string(buffer) == "sair") break;
+    while (!encerrar) {
+        Quadro q;
+        bool fim;
+        if (!entrada.proximo(q, fim)) {
+            if (!fim) logger(NivelLog::Error, "Erro de leitura", "Quadro inválido ou falha no read", errno);
+            break;
+        }
+        if (q.flags & FLAG_BLOCO) { // o pai não manda blocos: descarta o corpo
+            if (!entrada.receberBloco(q.tamanho)) break;
+        } else {
+            contarMetrica(Contador::MensagensRecebidas);
+            contarMetrica(Contador::BytesRecebidos, q.payload.size());
+
+            // Pedido binário: o texto é lido no lugar e a resposta sai no
+            // mesmo formato, ecoando o instante de envio
+            VisaoMensagem pedido;
+            const bool binario = pareceMensagem(q.payload) && pedido.abrir(q.payload.data(), q.payload.size());
+            const std::string_view comando = binario ? pedido.texto(Campo::Texto) : q.payload;
+            logger(NivelLog::Info, "Mensagem recebida", comando, q.payload.size());
+            if (comando.rfind("arquivo ", 0) == 0 || comando.rfind("bloco ", 0) == 0) {
+                if (!responderBloco(saida, area, q.seq, comando)) break;
+            } else {
+                std::string resp;
+                const bool ehPrimos = comando.rfind("primos ", 0) == 0;
+                size_t primos = 0;
+                if (ehPrimos) {
+                    const size_t n = std::strtoull(std::string(comando.substr(7)).c_str(), nullptr, 10);
+                    primos = contarPrimos(n);
+                    resp = "primos até " + std::to_string(n) + ": " + std::to_string(primos);
+                } else {
+                    resp = "Filho recebeu: ";
+                    resp.append(comando.data(), comando.size());
+                }
+                if (binario) {
+                    EscritorMensagem m(saida.abrirQuadro(TipoQuadro::Resposta, q.seq), TipoMensagem::Resposta);
+                    m.texto(Campo::Texto, resp).u32(Campo::Origem, (uint32_t)getpid());
+                    if (ehPrimos) m.u64(Campo::Valor, primos);
+                    if (pedido.tem(Campo::EnviadoEm)) m.i64(Campo::EnviadoEm, pedido.i64(Campo::EnviadoEm));
+                    m.fechar();
+                    saida.fecharQuadro();
+                } else {
+                    saida.enfileirarCopia(TipoQuadro::Resposta, q.seq, resp);
+                }
+                contarMetrica(Contador::MensagensEnviadas);
+                logger(NivelLog::Info, "Mensagem enviada", resp, resp.size());
+                encerrar = comando == "sair";
+            }
         }
 
-        CloseHandle(hRead);
-        CloseHandle(hWrite);
-        return 0;
+        // Fim do que já foi lido: responde o lote de uma vez
+        if (!saida.vazio() && (encerrar || entrada.pendentesNoBuffer() < TAM_CABECALHO)) {
+            const size_t bytes = saida.bytes();
+            const int64_t inicio = monotonicoNs();
+            if (!saida.descarregar()) {
+                logger(NivelLog::Error, "Erro ao enviar mensagem", "writev falhou", errno);
+                contarMetrica(Contador::Erros);
+                break;
+            }
+            medirLatencia(Latencia::Envio, monotonicoNs() - inicio);
+            contarMetrica(Contador::BytesEnviados, bytes);
+        }
     }
-    
-    // Processo pai
-    SECURITY_ATTRIBUTES sa = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
-    HANDLE parentRead, parentWrite, childRead, childWrite;
+    close(fdLeitura);
+    close(fdEscrita);
+    descarregarLog();
+    return 0;
+}
 
-    if (!CreatePipe(&parentRead, &childWrite, &sa, 0)) {
-        ErrorExit("Falha ao criar pipe pai->filho");
+// -----------------------------------------------------------------------------
+// Processo pai: recebe as respostas de `quantos` pedidos. Corpos de bloco vão
+// para `fdSaida` (splice) quando houver um.
+// -----------------------------------------------------------------------------
+bool receberRespostas(LeitorPipe& entrada, size_t quantos, int fdSaida, int64_t inicio, bool registrar) {
+    for (size_t i = 0; i < quantos; ++i) {
+        Quadro q;
+        bool fim;
+        if (!entrada.proximo(q, fim)) {
+            if (!fim) contarMetrica(Contador::Erros);
+            return false;
+        }
+        if (q.flags & FLAG_BLOCO) {
+            if (!entrada.receberBloco(q.tamanho, fdSaida)) {
+                logger(NivelLog::Error, "Erro ao receber bloco", "Pipe fechado no meio do corpo", q.tamanho);
+                contarMetrica(Contador::Erros);
+                return false;
+            }
+            contarMetrica(Contador::BytesRecebidos, q.tamanho);
+            logger(NivelLog::Info, "Bloco recebido", fdSaida >= 0 ? "gravado no arquivo de saída" : "descartado",
+                   q.tamanho);
+        } else {
+            contarMetrica(Contador::BytesRecebidos, TAM_CABECALHO + q.payload.size());
+            if (registrar) logger(NivelLog::Info, "Mensagem recebida", textoResposta(q.payload), q.payload.size());
+        }
+        // Ida e volta: do writev do lote até a resposta
+        medirLatencia(Latencia::Recebimento, monotonicoNs() - inicio);
+        contarMetrica(Contador::MensagensRecebidas);
     }
-    if (!CreatePipe(&childRead, &parentWrite, &sa, 0)) {
-        ErrorExit("Falha ao criar pipe filho->pai");
+    return true;
+}
+
+// Envia um lote e mede o writev
+bool enviarLote(EscritorPipe& saida) {
+    const size_t quadros = saida.quadros();
+    const size_t bytes = saida.bytes();
+    const int64_t inicio = monotonicoNs();
+    if (!saida.descarregar()) {
+        contarMetrica(Contador::Erros);
+        return false;
     }
-    logger("pai", "info", "Pipes criados", "Pipes pai->filho e filho->pai criados com sucesso");
+    medirLatencia(Latencia::Envio, monotonicoNs() - inicio);
+    contarMetrica(Contador::MensagensEnviadas, quadros);
+    contarMetrica(Contador::BytesEnviados, bytes);
+    return true;
+}
 
-    char modulePath[MAX_PATH];
-    GetModuleFileNameA(NULL, modulePath, MAX_PATH);
+// -----------------------------------------------------------------------------
+// Modo pool (--trabalhadores=N): N processos trabalhadores mantidos vivos;
+// cada comando vai para o menos ocupado e as respostas chegam fora de ordem.
+// -----------------------------------------------------------------------------
+// Comandos que não vão para os trabalhadores: blocos ("arquivo", "bloco") não
+// passam pelo pool, e o pool os trataria como queda do trabalhador
+bool aceitoNoPool(std::string_view comando) {
+    return comando.rfind("arquivo ", 0) != 0 && comando.rfind("bloco ", 0) != 0;
+}
 
-    std::string cmdStr = "\"" + std::string(modulePath) + "\" child " +
-                         std::to_string((unsigned long long)childRead) + " " +
-                         std::to_string((unsigned long long)childWrite);
-    char cmd[1024];
-    strcpy(cmd, cmdStr.c_str());
+int executarPool(unsigned quantidade, size_t tamanhoPipe, size_t total, size_t janela,
+                 const std::string& mensagem) {
+    PoolTrabalhadores pool({"/proc/self/exe", "--trabalhador"}, janela, tamanhoPipe);
+    if (!pool.iniciar(quantidade)) ErrorExit("Falha ao criar os trabalhadores");
+    logger(NivelLog::Info, "Pool criado", std::to_string(quantidade) + " trabalhadores", (int64_t)quantidade);
 
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    PROCESS_INFORMATION pi;
+    auto registrar = [](bool ok, std::string_view resposta) {
+        if (ok) logger(NivelLog::Info, "Mensagem recebida", textoResposta(resposta), resposta.size());
+        else logger(NivelLog::Error, "Resposta perdida", "Trabalhador caiu antes de responder");
+    };
+    // Espera a janela abrir e enfileira
+    std::string carga; // payload codificado, reaproveitado
+    auto enviar = [&pool, &carga](std::string_view comando, PoolTrabalhadores::Callback cb) {
+        carga.clear();
+        codificarComando(carga, comando);
+        while (!pool.tentarEnviar(carga, cb)) {
+            if (pool.processar(100) < 0) return false;
+        }
+        return true;
+    };
 
-    if (!CreateProcessA(NULL, cmd, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
-        ErrorExit("Falha ao criar processo filho");
+    if (total > 0 && (mensagem == "sair" || !aceitoNoPool(mensagem))) {
+        logger(NivelLog::Error, "Comando recusado", "Sem blocos nem sair no pool: " + mensagem);
+        pool.encerrar();
+        return 1;
+    }
+    if (total > 0) {
+        // Vazão: mantém até `janela` pedidos em voo por trabalhador
+        size_t respondidos = 0, falhas = 0, enviados = 0;
+        auto contar = [&](bool ok, std::string_view) { ok ? ++respondidos : ++falhas; };
+        const int64_t inicio = monotonicoNs();
+        while (respondidos + falhas < total) {
+            while (enviados < total) {
+                carga.clear();
+                codificarComando(carga, mensagem);
+                if (!pool.tentarEnviar(carga, contar)) break;
+                ++enviados;
+            }
+            if (pool.processar(100) < 0) break;
+        }
+        const double segundos = segundosEntre(inicio, monotonicoNs());
+        std::string resumo = std::to_string(respondidos) + " respostas em " + std::to_string(segundos) +
+                             " s (" + std::to_string((uint64_t)(respondidos / segundos)) + " msg/s, " +
+                             std::to_string(pool.tamanho()) + " trabalhadores, " +
+                             std::to_string(pool.reinicios()) + " reinícios)";
+        logTexto(resumo);
+        logger(falhas ? NivelLog::Error : NivelLog::Info, "vazao", resumo, (int64_t)falhas);
+    } else {
+        std::string msg;
+        while (true) {
+            logTexto("Digite mensagem para os trabalhadores (sair para terminar): ", false);
+            descarregarLog();
+            if (!std::getline(std::cin, msg) || msg == "sair") break;
+            // Os comandos da linha são distribuídos entre os trabalhadores. Um
+            // "sair" no meio da linha não vai para eles (o trabalhador sairia e
+            // contaria como queda): encerra depois das respostas, e o que vem
+            // depois dele é ignorado, como sem o pool
+            bool ok = true, sair = false;
+            for (std::string_view comando : separarComandos(msg)) {
+                if (comando == "sair") {
+                    sair = true;
+                    break;
+                }
+                if (!aceitoNoPool(comando)) {
+                    logger(NivelLog::Warn, "Comando recusado", "Blocos não passam pelo pool: " + std::string(comando));
+                    continue;
+                }
+                logger(NivelLog::Info, "Mensagem enviada", comando, comando.size());
+                if (!(ok = enviar(comando, registrar))) break;
+            }
+            while (ok && pool.emVoo() > 0) ok = pool.processar(100) >= 0;
+            if (ok && sair) break;
+            if (!ok) {
+                logger(NivelLog::Error, "Pool vazio", "Nenhum trabalhador disponível");
+                break;
+            }
+        }
     }
-    logger("pai", "info", "Processo filho criado", "Child process iniciado com sucesso");
 
-    CloseHandle(childRead);
-    CloseHandle(childWrite);
+    pool.encerrar();
+    logger(NivelLog::Info, "Finalização", "Programa encerrado com sucesso");
+    return 0;
+}
 
-    std::string msg;
-    DWORD bytesWritten, bytesRead;
-    char buffer[256];
+int main(int argc, char* argv[]) {
+    /* Opções:
+    --tamanho-pipe=N  buffer de cada pipe no kernel (padrão 1 MiB; F_SETPIPE_SZ)
+    --saida=<arq>     grava os blocos recebidos ("arquivo <caminho>", "bloco <n>")
+    --total=N         vazão: N mensagens de --bytes=B bytes em lotes de --lote=L
+                      (--comando=<texto> troca a mensagem, ex.: "primos 100000")
+    --trabalhadores=N pool de N processos (0 = um por núcleo); --lote vira a
+                      janela de pedidos em voo por trabalhador
+    --binario         comandos e respostas como mensagens binárias (mensagem.h)
+    Sem --total, lê comandos da entrada padrão; vários separados por ';' vão
+    num único writev (no pool, são distribuídos entre os trabalhadores). */
+    size_t tamanhoPipe = TAM_PIPE_PADRAO;
+    std::string destinoBloco;
+    size_t total = 0, lote = 64, bytesMensagem = 16;
+    std::string comando;
+    bool pool = false;
+    unsigned trabalhadores = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        // Processo criado pelo pool: os pipes já estão nos fds 3 e 4
+        if (arg == "--trabalhador") {
+            return executarFilho(FD_TRABALHADOR_ENTRADA, FD_TRABALHADOR_SAIDA, "trabalhador");
+        }
+        if (arg.rfind("--tamanho-pipe=", 0) == 0) tamanhoPipe = std::strtoull(arg.c_str() + 15, nullptr, 10);
+        else if (arg.rfind("--saida=", 0) == 0) destinoBloco = arg.substr(8);
+        else if (arg.rfind("--total=", 0) == 0) total = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--lote=", 0) == 0) lote = std::max<size_t>(1, std::strtoull(arg.c_str() + 7, nullptr, 10));
+        else if (arg.rfind("--bytes=", 0) == 0) bytesMensagem = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--comando=", 0) == 0) comando = arg.substr(10);
+        else if (arg == "--binario") mensagensBinarias = true;
+        else if (arg.rfind("--trabalhadores=", 0) == 0) {
+            pool = true;
+            trabalhadores = (unsigned)std::strtoul(arg.c_str() + 16, nullptr, 10);
+        }
+    }
+    const std::string mensagem = comando.empty() ? std::string(bytesMensagem, 'x') : comando;
 
-    while (true) {
-        std::cout << "Digite mensagem para filho (sair para terminar): ";
-        std::getline(std::cin, msg);
+    if (pool) {
+        iniciarLog("ipc", "pai");
+        iniciarMetricas("ipc", "pai");
+        if (trabalhadores == 0) trabalhadores = std::max(1u, std::thread::hardware_concurrency());
+        return executarPool(trabalhadores, tamanhoPipe, total, lote, mensagem);
+    }
 
-        // Envio da mensagem
-        if (!WriteFile(parentWrite, msg.c_str(), (DWORD)msg.size(), &bytesWritten, NULL)) {
-            logger("pai", "error", "Erro ao enviar mensagem", msg);
-        } else {
-            logger("pai", "info", "Mensagem enviada", msg, bytesWritten);
-        }
+    /* Cria os pipes e o filho antes de iniciar o log e as métricas: fork só
+    copia o thread que o chamou, e os threads de fundo de log.h e metricas.h
+    não existiriam no filho. Cada processo inicia os seus depois do fork. */
+    signal(SIGPIPE, SIG_IGN); // filho morto vira erro de escrita, não sinal
+    int paiParaFilho[2], filhoParaPai[2];
+    if (!criarPipe(paiParaFilho, tamanhoPipe) || !criarPipe(filhoParaPai, tamanhoPipe)) {
+        ErrorExit("Falha ao criar pipes");
+    }
+    pid_t filho = fork();
+    if (filho < 0) ErrorExit("Falha ao criar processo filho");
+    if (filho == 0) {
+        close(paiParaFilho[1]);
+        close(filhoParaPai[0]);
+        return executarFilho(paiParaFilho[0], filhoParaPai[1], "filho");
+    }
 
-        if (!ReadFile(parentRead, buffer, sizeof(buffer) - 1, &bytesRead, NULL) || bytesRead == 0) break;
-        buffer[bytesRead] = '\0';
-        logger("pai", "info", "Mensagem recebida", buffer, bytesRead);
+    // Processo pai
+    iniciarLog("ipc", "pai");
+    iniciarMetricas("ipc", "pai");
+    close(paiParaFilho[0]);
+    close(filhoParaPai[1]);
+    logger(NivelLog::Info, "Pipes criados", "Pipes pai->filho e filho->pai criados com sucesso",
+           (int64_t)ajustarTamanhoPipe(paiParaFilho[1], tamanhoPipe));
+    logger(NivelLog::Info, "Processo filho criado", "Child process iniciado com sucesso", 0,
+           std::to_string(filho));
 
-        if (msg == "sair") break;
+    int fdSaida = -1;
+    if (!destinoBloco.empty()) {
+        fdSaida = open(destinoBloco.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fdSaida < 0) ErrorExit("Falha ao abrir " + destinoBloco);
     }
 
-    CloseHandle(parentRead);
-    CloseHandle(parentWrite);
+    EscritorPipe saida(paiParaFilho[1]);
+    LeitorPipe entrada(filhoParaPai[0]);
+
+    if (total > 0) {
+        // Vazão: lotes de `lote` quadros, um writev por lote; o pai espera as
+        // respostas do lote antes de mandar o próximo. O filho responde no meio
+        // do lote, então um writev maior que o pipe de ida travaria os dois
+        // (cada um bloqueado escrevendo num pipe cheio): o lote é cortado para
+        // caber inteiro nele, com pelo menos um quadro
+        const int capacidadePipe = fcntl(paiParaFilho[1], F_GETPIPE_SZ);
+        const size_t capacidade = capacidadePipe > 0 ? (size_t)capacidadePipe : PIPE_BUF;
+        const int64_t inicio = monotonicoNs();
+        size_t respondidos = 0;
+        uint32_t seq = 1;
+        while (respondidos < total) {
+            const size_t maximo = std::min(lote, total - respondidos);
+            size_t n = 0, tamQuadro = 0;
+            do {
+                enfileirarComando(saida, seq++, mensagem);
+                if (++n == 1) tamQuadro = saida.bytes();
+            } while (n < maximo && saida.bytes() + tamQuadro <= capacidade);
+            const int64_t envio = monotonicoNs();
+            if (!enviarLote(saida) || !receberRespostas(entrada, n, fdSaida, envio, false)) break;
+            respondidos += n;
+        }
+        const double segundos = segundosEntre(inicio, monotonicoNs());
+        const double mib = (double)respondidos * (TAM_CABECALHO + mensagem.size()) / (1 << 20);
+        std::string resumo = std::to_string(respondidos) + " respostas em " + std::to_string(segundos) +
+                             " s (" + std::to_string((uint64_t)(respondidos / segundos)) + " msg/s, " +
+                             std::to_string(mib / segundos) + " MiB/s, lote " + std::to_string(lote) + ")";
+        logTexto(resumo);
+        logger(respondidos < total ? NivelLog::Error : NivelLog::Info, "vazao", resumo,
+               (int64_t)(respondidos * mensagem.size()));
+        enfileirarComando(saida, seq, "sair");
+        if (enviarLote(saida)) receberRespostas(entrada, 1, fdSaida, monotonicoNs(), false);
+    } else {
+        std::string msg;
+        uint32_t seq = 1;
+        while (true) {
+            logTexto("Digite mensagem para filho (sair para terminar): ", false);
+            descarregarLog();
+            if (!std::getline(std::cin, msg)) msg = "sair";
+
+            // Comandos separados por ';' vão juntos; os payloads apontam para
+            // `msg`, que vive até o fim do lote
+            bool sair = false;
+            for (std::string_view comando : separarComandos(msg)) {
+                enfileirarComando(saida, seq++, comando);
+                logger(NivelLog::Info, "Mensagem enviada", comando, comando.size());
+                sair = sair || comando == "sair";
+            }
+            const size_t quantos = saida.quadros();
+            const int64_t inicio = monotonicoNs();
+            if (!enviarLote(saida)) {
+                logger(NivelLog::Error, "Erro ao enviar mensagem", msg, errno);
+                break;
+            }
+            if (!receberRespostas(entrada, quantos, fdSaida, inicio, true) || sair) break;
+        }
+    }
 
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
+    close(paiParaFilho[1]);
+    close(filhoParaPai[0]);
+    if (fdSaida >= 0) close(fdSaida);
+    waitpid(filho, nullptr, 0);
 
-    logger("pai", "info", "Finalização", "Programa encerrado com sucesso");
+    logger(NivelLog::Info, "Finalização", "Programa encerrado com sucesso");
 
     return 0;
 }
@@ -0,0 +1,348 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// pool_pipes.h — pool de processos trabalhadores ligados por pipes.
+//
+// Uso típico:
+//   PoolTrabalhadores pool({"/proc/self/exe", "--trabalhador"}, 64);
+//   pool.iniciar(4);
+//   pool.tentarEnviar("primos 1000000", [](bool ok, std::string_view r) { ... });
+//   while (pool.emVoo() > 0) pool.processar(100);
+//
+// Os trabalhadores são criados uma vez (posix_spawn) e mantidos vivos; cada um
+// tem um par de pipes (canal_pipe.h) e recebe os quadros de protocolo.h no fd
+// 3, respondendo no fd 4. Cada pedido vai para o trabalhador com menos pedidos
+// em voo, e as respostas de todos são recolhidas num único epoll, fora de
+// ordem entre trabalhadores. Um trabalhador responde na ordem em que recebeu,
+// então cada um guarda só uma fila de pendentes.
+//
+// posix_spawn (exec) em vez de fork puro: o pai já tem os threads de log e de
+// métricas rodando, e um fork sem exec deixaria o filho com as travas deles
+// num estado qualquer. Quem morre é recriado no lugar; os pedidos que estavam
+// com ele recebem ok = false.
+// -----------------------------------------------------------------------------
+#include <sys/epoll.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "canal_pipe.h"
+#include "../common/log.h"
+#include "../common/metricas.h"
+
+extern char** environ;
+
+// Descritores em que o trabalhador encontra os pipes
+constexpr int FD_TRABALHADOR_ENTRADA = 3;
+constexpr int FD_TRABALHADOR_SAIDA = 4;
+
+// Quedas seguidas sem nenhuma resposta antes de desistir de um trabalhador
+constexpr unsigned MAX_QUEDAS_SEGUIDAS = 5;
+
+class PoolTrabalhadores {
+public:
+    // ok = false quando o trabalhador morreu antes de responder.
+    using Callback = std::function<void(bool ok, std::string_view resposta)>;
+
+    // `argv` do trabalhador (argv[0] é o executável) e o máximo de pedidos em
+    // voo por trabalhador.
+    explicit PoolTrabalhadores(std::vector<std::string> argv, size_t janela = 64,
+                               size_t tamanhoPipe = TAM_PIPE_PADRAO)
+        : argv_(std::move(argv)), janela_(janela), tamanhoPipe_(tamanhoPipe) {}
+    PoolTrabalhadores(const PoolTrabalhadores&) = delete;
+    PoolTrabalhadores& operator=(const PoolTrabalhadores&) = delete;
+    ~PoolTrabalhadores() { encerrar(); }
+
+    bool iniciar(unsigned quantidade) {
+        // Escrever num trabalhador morto não pode derrubar o pai
+        signal(SIGPIPE, SIG_IGN);
+        epfd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd_ < 0) return false;
+        trabalhadores_.resize(quantidade);
+        for (size_t i = 0; i < trabalhadores_.size(); ++i) {
+            if (!criar(i)) return false;
+        }
+        return true;
+    }
+
+    // Enfileira um comando no trabalhador menos carregado. Retorna false se
+    // todos estão com a janela cheia (chame processar()).
+    bool tentarEnviar(std::string_view comando, Callback cb) {
+        Trabalhador* escolhido = nullptr;
+        // Começa de um índice rotativo para desempatar sem favorecer o primeiro
+        const size_t n = trabalhadores_.size();
+        for (size_t k = 0; k < n; ++k) {
+            Trabalhador& t = trabalhadores_[(proximo_ + k) % n];
+            if (t.pid <= 0 || t.pendentes.size() >= janela_) continue;
+            if (!escolhido || t.pendentes.size() < escolhido->pendentes.size()) escolhido = &t;
+        }
+        if (!escolhido) return false;
+        proximo_ = (proximo_ + 1) % n;
+
+        const uint32_t seq = proximoSeq_++;
+        escolhido->pendentes.push_back({seq, monotonicoNs(), cb ? std::move(cb) : [](bool, std::string_view) {}});
+        codificarQuadro(escolhido->saida, TipoQuadro::Comando, seq, comando);
+        contarMetrica(Contador::MensagensEnviadas);
+        ++emVoo_;
+        return true;
+    }
+
+    // Envia o que estiver enfileirado, espera até `timeoutMs` por respostas e
+    // despacha as que chegaram. Retorna quantos callbacks foram chamados, ou
+    // -1 se não sobrou nenhum trabalhador.
+    int processar(int timeoutMs) {
+        int chamados = 0;
+        for (size_t i = 0; i < trabalhadores_.size(); ++i) {
+            if (trabalhadores_[i].pid > 0 && !descarregar(i)) chamados += substituir(i);
+        }
+        if (vivos() == 0) return -1;
+
+        epoll_event eventos[64];
+        int n = epoll_wait(epfd_, eventos, 64, timeoutMs);
+        if (n < 0) return errno == EINTR ? chamados : -1;
+        for (int e = 0; e < n; ++e) {
+            const size_t i = (size_t)(eventos[e].data.u64 >> 1);
+            const bool escrita = eventos[e].data.u64 & 1;
+            if (i >= trabalhadores_.size() || trabalhadores_[i].pid <= 0) continue;
+            // EPOLLHUP na leitura chega junto com os últimos dados: lê tudo antes
+            const bool ok = escrita ? descarregar(i) : receber(i, chamados);
+            if (!ok) chamados += substituir(i);
+        }
+        return chamados;
+    }
+
+    size_t emVoo() const { return emVoo_; }
+    size_t tamanho() const { return trabalhadores_.size(); }
+    size_t reinicios() const { return reinicios_; }
+
+    size_t vivos() const {
+        return (size_t)std::count_if(trabalhadores_.begin(), trabalhadores_.end(),
+                                     [](const Trabalhador& t) { return t.pid > 0; });
+    }
+
+    // Fecha as entradas (cada trabalhador sai ao ver o fim do pipe) e espera
+    // todos terminarem. Pedidos ainda em voo recebem ok = false.
+    void encerrar() {
+        for (Trabalhador& t : trabalhadores_) {
+            if (t.fdEscrita >= 0) ::close(t.fdEscrita);
+            t.fdEscrita = -1;
+        }
+        for (Trabalhador& t : trabalhadores_) {
+            if (t.pid > 0) waitpid(t.pid, nullptr, 0);
+            t.pid = 0;
+            fecharDescritores(t);
+            falharPendentes(t);
+        }
+        trabalhadores_.clear();
+        if (epfd_ >= 0) ::close(epfd_);
+        epfd_ = -1;
+    }
+
+private:
+    struct Pedido {
+        uint32_t seq;
+        int64_t desde; // monotonicoNs() do envio, para a latência de ida e volta
+        Callback cb;
+    };
+
+    struct Trabalhador {
+        pid_t pid = 0;
+        int fdEscrita = -1;     // pai → trabalhador (não bloqueante)
+        int fdLeitura = -1;     // trabalhador → pai (não bloqueante)
+        bool querEscrita = false; // EPOLLOUT registrado
+        unsigned quedas = 0;    // quedas seguidas sem nenhuma resposta
+        std::string saida;
+        size_t enviados = 0;
+        DecodificadorQuadros entrada;
+        std::deque<Pedido> pendentes; // na ordem de envio
+    };
+
+    bool criar(size_t i) {
+        Trabalhador& t = trabalhadores_[i];
+        int ida[2], volta[2];
+        if (!criarPipe(ida, tamanhoPipe_)) return false;
+        if (!criarPipe(volta, tamanhoPipe_)) {
+            ::close(ida[0]);
+            ::close(ida[1]);
+            return false;
+        }
+
+        // No trabalhador: ida[0] vira o fd 3 e volta[1] o fd 4 (dup2 limpa o
+        // O_CLOEXEC); todo o resto é fechado pelo exec
+        posix_spawn_file_actions_t acoes;
+        posix_spawn_file_actions_init(&acoes);
+        posix_spawn_file_actions_adddup2(&acoes, ida[0], FD_TRABALHADOR_ENTRADA);
+        posix_spawn_file_actions_adddup2(&acoes, volta[1], FD_TRABALHADOR_SAIDA);
+        std::vector<char*> args;
+        for (std::string& a : argv_) args.push_back(a.data());
+        args.push_back(nullptr);
+        pid_t pid;
+        const int erro = posix_spawn(&pid, args[0], &acoes, nullptr, args.data(), environ);
+        posix_spawn_file_actions_destroy(&acoes);
+        ::close(ida[0]);
+        ::close(volta[1]);
+        if (erro != 0) {
+            ::close(ida[1]);
+            ::close(volta[0]);
+            errno = erro;
+            return false;
+        }
+
+        t.pid = pid;
+        t.fdEscrita = ida[1];
+        t.fdLeitura = volta[0];
+        fcntl(t.fdEscrita, F_SETFL, O_NONBLOCK);
+        fcntl(t.fdLeitura, F_SETFL, O_NONBLOCK);
+        t.querEscrita = false;
+        t.saida.clear();
+        t.enviados = 0;
+        t.entrada = DecodificadorQuadros();
+
+        // data.u64 = índice * 2 + (1 na ponta de escrita)
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = (uint64_t)i << 1;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, t.fdLeitura, &ev);
+        ev.events = 0;
+        ev.data.u64 = ((uint64_t)i << 1) | 1;
+        epoll_ctl(epfd_, EPOLL_CTL_ADD, t.fdEscrita, &ev);
+        logger(NivelLog::Info, "Trabalhador criado", "Processo trabalhador iniciado", 0, std::to_string(pid));
+        return true;
+    }
+
+    // Envia o que der sem bloquear; o resto espera o EPOLLOUT.
+    bool descarregar(size_t i) {
+        Trabalhador& t = trabalhadores_[i];
+        while (t.enviados < t.saida.size()) {
+            ssize_t n = ::write(t.fdEscrita, t.saida.data() + t.enviados, t.saida.size() - t.enviados);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                return false;
+            }
+            t.enviados += (size_t)n;
+            contarMetrica(Contador::BytesEnviados, (uint64_t)n);
+        }
+        if (t.enviados == t.saida.size()) {
+            t.saida.clear();
+            t.enviados = 0;
+        }
+        // Liga/desliga EPOLLOUT conforme haja bytes pendentes
+        const bool quer = !t.saida.empty();
+        if (quer != t.querEscrita) {
+            epoll_event ev{};
+            ev.events = quer ? (uint32_t)EPOLLOUT : 0u;
+            ev.data.u64 = ((uint64_t)i << 1) | 1;
+            epoll_ctl(epfd_, EPOLL_CTL_MOD, t.fdEscrita, &ev);
+            t.querEscrita = quer;
+        }
+        return true;
+    }
+
+    // Lê o que houver e despacha as respostas completas. Retorna false se o
+    // trabalhador fechou a saída ou mandou algo que não é uma resposta.
+    bool receber(size_t i, int& chamados) {
+        Trabalhador& t = trabalhadores_[i];
+        char buffer[64 * 1024];
+        bool vivo = true;
+        while (true) {
+            ssize_t n = ::read(t.fdLeitura, buffer, sizeof(buffer));
+            if (n > 0) {
+                contarMetrica(Contador::BytesRecebidos, (uint64_t)n);
+                t.entrada.alimentar(buffer, (size_t)n);
+                if ((size_t)n < sizeof(buffer)) break;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            vivo = false; // fim do pipe (morreu) ou erro de leitura
+            break;
+        }
+
+        Quadro q;
+        DecodificadorQuadros::Estado estado;
+        const int64_t agora = monotonicoNs();
+        while ((estado = t.entrada.proximo(q)) == DecodificadorQuadros::Estado::Quadro) {
+            // Respostas chegam na ordem dos pedidos; qualquer outra coisa é erro
+            if (q.tipo != TipoQuadro::Resposta || t.pendentes.empty() || t.pendentes.front().seq != q.seq) {
+                return false;
+            }
+            Pedido p = std::move(t.pendentes.front());
+            t.pendentes.pop_front();
+            --emVoo_;
+            t.quedas = 0;
+            medirLatencia(Latencia::Recebimento, agora - p.desde);
+            contarMetrica(Contador::MensagensRecebidas);
+            p.cb(true, q.payload);
+            ++chamados;
+        }
+        // Blocos (FLAG_BLOCO) não são tratados no pool
+        return vivo && estado != DecodificadorQuadros::Estado::Erro &&
+               estado != DecodificadorQuadros::Estado::Bloco;
+    }
+
+    // Recolhe um trabalhador que morreu (ou falhou) e cria outro no lugar.
+    // Retorna quantos callbacks foram chamados (os pedidos perdidos).
+    int substituir(size_t i) {
+        Trabalhador& t = trabalhadores_[i];
+        const pid_t antigo = t.pid;
+        fecharDescritores(t);
+        ::kill(antigo, SIGKILL); // se só o pipe falhou, o processo pode seguir vivo
+        int status = 0;
+        waitpid(antigo, &status, 0);
+        t.pid = 0;
+        const int perdidos = (int)t.pendentes.size();
+        contarMetrica(Contador::Erros, perdidos + 1);
+        falharPendentes(t);
+
+        if (++t.quedas > MAX_QUEDAS_SEGUIDAS) {
+            logger(NivelLog::Error, "Trabalhador abandonado",
+                   "Quedas seguidas sem resposta; o trabalhador não será recriado", 0, std::to_string(antigo));
+            return perdidos;
+        }
+        logger(NivelLog::Warn, "Trabalhador reiniciado",
+               std::to_string(perdidos) + " pedidos perdidos (" +
+                   (WIFSIGNALED(status) ? "sinal " + std::to_string(WTERMSIG(status))
+                                        : "saída " + std::to_string(WEXITSTATUS(status))) + ")", 0,
+               std::to_string(antigo));
+        ++reinicios_;
+        if (!criar(i)) {
+            logger(NivelLog::Error, "Trabalhador abandonado", "Falha ao recriar o trabalhador", errno,
+                   std::to_string(antigo));
+        }
+        return perdidos;
+    }
+
+    void fecharDescritores(Trabalhador& t) {
+        // close() também tira os descritores do epoll
+        if (t.fdEscrita >= 0) ::close(t.fdEscrita);
+        if (t.fdLeitura >= 0) ::close(t.fdLeitura);
+        t.fdEscrita = t.fdLeitura = -1;
+    }
+
+    void falharPendentes(Trabalhador& t) {
+        while (!t.pendentes.empty()) {
+            Pedido p = std::move(t.pendentes.front());
+            t.pendentes.pop_front();
+            --emVoo_;
+            p.cb(false, {});
+        }
+    }
+
+    std::vector<std::string> argv_;
+    size_t janela_;
+    size_t tamanhoPipe_;
+    int epfd_ = -1;
+    std::vector<Trabalhador> trabalhadores_;
+    size_t proximo_ = 0;
+    uint32_t proximoSeq_ = 1;
+    size_t emVoo_ = 0;
+    size_t reinicios_ = 0;
+};
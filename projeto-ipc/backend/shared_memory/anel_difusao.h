@@ -0,0 +1,295 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// anel_difusao.h — anel de difusão (broadcast): um writer, até MAX_LEITORES
+// readers, e cada reader recebe todas as mensagens publicadas depois de se
+// inscrever.
+//
+// Layout no segmento:
+//   [CabecalhoDifusao][slot 0][slot 1]...[slot N-1]
+//
+// Cada slot guarda uma mensagem de até `tamSlot` bytes e uma sequência no
+// estilo seqlock: 2i+1 enquanto o writer grava a mensagem i, 2i+2 quando ela
+// está completa. O reader copia o payload e confere a sequência de novo; se
+// mudou, o slot foi sobrescrito durante a cópia.
+//
+// Cada reader mantém o próprio cursor (próxima mensagem a ler) numa linha de
+// cache do cabeçalho. Dois modos de lidar com um reader lento:
+//   - Modo::Bloquear:     o writer espera o reader mais lento (backpressure);
+//   - Modo::Sobrescrever: o writer nunca espera; o reader atrasado pula para
+//                         perto do início do anel e recebe a contagem de
+//                         mensagens perdidas.
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include "anel_spsc.h"
+#include "notificacao.h"
+
+constexpr uint32_t MAGICO_DIFUSAO = 0x49504342; // "IPCB"
+constexpr uint32_t VERSAO_DIFUSAO = 1;
+constexpr uint32_t MAX_LEITORES = 16;
+constexpr uint32_t INSCRICAO_ATIVA = 1;
+constexpr uint32_t INSCRICAO_RESERVADA = 2; // cursor e pid ainda não gravados
+
+struct alignas(TAM_LINHA_CACHE) CursorLeitor {
+    std::atomic<uint32_t> ativo;   // 1 = inscrição em uso, 2 = sendo ocupada
+    std::atomic<int32_t> pid;      // dono da inscrição (para descartar readers mortos)
+    std::atomic<uint64_t> cursor;  // próxima mensagem que este reader vai ler
+};
+
+struct CabecalhoDifusao {
+    alignas(TAM_LINHA_CACHE) uint32_t magico;
+    uint32_t versao;
+    uint64_t slots;                          // potência de 2
+    uint64_t tamSlot;                        // maior payload por mensagem
+    uint32_t modo;                           // AnelDifusao::Modo
+    std::atomic<uint32_t> encerrar_flag;
+
+    alignas(TAM_LINHA_CACHE) std::atomic<uint64_t> publicadas; // só o writer escreve
+    alignas(TAM_LINHA_CACHE) EventoCompartilhado dados;        // acorda readers
+    alignas(TAM_LINHA_CACHE) EventoCompartilhado espaco;       // acorda o writer (modo Bloquear)
+    CursorLeitor leitores[MAX_LEITORES];
+};
+
+struct SlotDifusao {
+    std::atomic<uint64_t> seq;
+    uint32_t tamanho;
+    uint32_t reservado;
+    // payload de `tamSlot` bytes logo em seguida
+};
+
+class AnelDifusao {
+public:
+    enum class Modo : uint32_t { Bloquear = 0, Sobrescrever = 1 };
+
+    AnelDifusao() = default;
+    AnelDifusao(const AnelDifusao&) = delete;
+    AnelDifusao& operator=(const AnelDifusao&) = delete;
+    ~AnelDifusao() { cancelarInscricao(); }
+
+    static size_t passoSlot(size_t tamSlot) {
+        return (sizeof(SlotDifusao) + tamSlot + TAM_LINHA_CACHE - 1) & ~(TAM_LINHA_CACHE - 1);
+    }
+
+    static size_t tamanhoNecessario(size_t slots, size_t tamSlot) {
+        return sizeof(CabecalhoDifusao) + slots * passoSlot(tamSlot);
+    }
+
+    size_t maiorMensagem() const { return tamSlot_; }
+    Modo modo() const { return (Modo)cab_->modo; }
+
+    bool inicializar(void* mem, size_t slots, size_t tamSlot, Modo modo) {
+        if (slots < 2 || (slots & (slots - 1)) != 0) return false;
+        auto* cab = new (mem) CabecalhoDifusao();
+        cab->versao = VERSAO_DIFUSAO;
+        cab->slots = slots;
+        cab->tamSlot = tamSlot;
+        cab->modo = (uint32_t)modo;
+        cab->encerrar_flag.store(0, std::memory_order_relaxed);
+        cab->publicadas.store(0, std::memory_order_relaxed);
+        inicializarEvento(cab->dados);
+        inicializarEvento(cab->espaco);
+        for (auto& l : cab->leitores) {
+            l.ativo.store(0, std::memory_order_relaxed);
+            l.pid.store(0, std::memory_order_relaxed);
+            l.cursor.store(0, std::memory_order_relaxed);
+        }
+        uint8_t* base = reinterpret_cast<uint8_t*>(cab + 1);
+        for (size_t i = 0; i < slots; ++i) {
+            new (base + i * passoSlot(tamSlot)) SlotDifusao{};
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        cab->magico = MAGICO_DIFUSAO;
+        return anexar(mem);
+    }
+
+    bool anexar(void* mem) {
+        auto* cab = static_cast<CabecalhoDifusao*>(mem);
+        if (cab->magico != MAGICO_DIFUSAO || cab->versao != VERSAO_DIFUSAO) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        cab_ = cab;
+        slotsBase_ = reinterpret_cast<uint8_t*>(cab + 1);
+        slots_ = cab->slots;
+        mascara_ = slots_ - 1;
+        tamSlot_ = cab->tamSlot;
+        passo_ = passoSlot(tamSlot_);
+        publicadasLocal_ = cab->publicadas.load(std::memory_order_acquire);
+        menorCursorCache_ = publicadasLocal_;
+        return true;
+    }
+
+    // ------------------------------------------------------------------ writer
+
+    // Publica uma mensagem para todos os readers inscritos. No modo Bloquear,
+    // espera (spin → yield → futex) enquanto o reader mais lento estiver um
+    // anel inteiro atrasado. Retorna false se a mensagem excede maiorMensagem().
+    bool publicar(const void* dados, size_t n,
+                  const PoliticaEspera& politica = PoliticaEspera()) {
+        if (n > tamSlot_) return false;
+        const uint64_t i = publicadasLocal_;
+
+        if (modo() == Modo::Bloquear && i - menorCursorCache_ >= slots_) {
+            // Reconsulta a cada 100 ms estacionado para descartar readers que
+            // morreram sem cancelar a inscrição.
+            const timespec limite{0, 100 * 1000 * 1000};
+            auto livre = [&] {
+                menorCursorCache_ = menorCursor(i);
+                return i - menorCursorCache_ < slots_;
+            };
+            while (!aguardar(cab_->espaco, livre, politica, &limite)) {
+                descartarLeitoresMortos();
+            }
+        }
+
+        SlotDifusao* slot = slotDe(i);
+        slot->seq.store(2 * i + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot->tamanho = (uint32_t)n;
+        std::memcpy(payloadDe(slot), dados, n);
+        slot->seq.store(2 * i + 2, std::memory_order_release);
+
+        publicadasLocal_ = i + 1;
+        cab_->publicadas.store(publicadasLocal_, std::memory_order_release);
+        notificar(cab_->dados);
+        return true;
+    }
+
+    void sinalizarEncerramento() {
+        cab_->encerrar_flag.store(1, std::memory_order_release);
+        notificar(cab_->dados);
+    }
+
+    // Quantos readers estão inscritos agora.
+    uint32_t leitoresAtivos() const {
+        uint32_t n = 0;
+        for (auto& l : cab_->leitores) n += l.ativo.load(std::memory_order_acquire) == INSCRICAO_ATIVA;
+        return n;
+    }
+
+    // ------------------------------------------------------------------ reader
+
+    // Ocupa um cursor livre; o reader passa a receber as mensagens publicadas
+    // a partir de agora. Retorna false se já há MAX_LEITORES inscritos.
+    bool inscrever() {
+        for (uint32_t k = 0; k < MAX_LEITORES; ++k) {
+            uint32_t livre = 0;
+            CursorLeitor& l = cab_->leitores[k];
+            // Reservada, a entrada ainda não conta para o writer: ele só a
+            // enxerga depois que o cursor novo está gravado
+            if (!l.ativo.compare_exchange_strong(livre, INSCRICAO_RESERVADA, std::memory_order_acq_rel)) continue;
+            cursorLocal_ = cab_->publicadas.load(std::memory_order_acquire);
+            l.pid.store((int32_t)getpid(), std::memory_order_relaxed);
+            l.cursor.store(cursorLocal_, std::memory_order_relaxed);
+            l.ativo.store(INSCRICAO_ATIVA, std::memory_order_release);
+            meu_ = &l;
+            return true;
+        }
+        return false;
+    }
+
+    void cancelarInscricao() {
+        if (!meu_) return;
+        meu_->ativo.store(0, std::memory_order_release);
+        notificar(cab_->espaco); // o writer pode estar esperando por este reader
+        meu_ = nullptr;
+    }
+
+    // Copia a próxima mensagem para `saida`. Retorna false se não há mensagem
+    // nova. Se o writer sobrescreveu mensagens que este reader ainda não leu
+    // (modo Sobrescrever), `perdidas` recebe quantas foram puladas.
+    bool tentarLer(std::string& saida, uint64_t& perdidas) {
+        perdidas = 0;
+        while (true) {
+            const uint64_t j = cursorLocal_;
+            const uint64_t publicadas = cab_->publicadas.load(std::memory_order_acquire);
+            if (j == publicadas) return false;
+
+            SlotDifusao* slot = slotDe(j);
+            const uint64_t s1 = slot->seq.load(std::memory_order_acquire);
+            if (s1 == 2 * j + 2) {
+                const uint32_t n = slot->tamanho;
+                if (n <= tamSlot_) {
+                    saida.assign(reinterpret_cast<const char*>(payloadDe(slot)), n);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (slot->seq.load(std::memory_order_relaxed) == s1) {
+                        avancar(j + 1);
+                        return true;
+                    }
+                }
+            }
+            // O slot já pertence a uma volta posterior do anel: este reader foi
+            // ultrapassado. Pula para metade do anel atrás do writer, deixando
+            // folga para não ser ultrapassado de novo na leitura seguinte.
+            const uint64_t atual = cab_->publicadas.load(std::memory_order_acquire);
+            const uint64_t destino = atual > slots_ / 2 ? atual - slots_ / 2 : 0;
+            if (destino > j) {
+                perdidas += destino - j;
+                avancar(destino);
+            }
+        }
+    }
+
+    // Bloqueia até haver mensagem nova ou o writer sinalizar encerramento.
+    void aguardarDados(const PoliticaEspera& politica = PoliticaEspera()) {
+        aguardar(cab_->dados, [this] {
+            return cursorLocal_ != cab_->publicadas.load(std::memory_order_acquire) || encerrado();
+        }, politica);
+    }
+
+    bool encerrado() const {
+        return cab_->encerrar_flag.load(std::memory_order_acquire) != 0;
+    }
+
+private:
+    SlotDifusao* slotDe(uint64_t i) const {
+        return reinterpret_cast<SlotDifusao*>(slotsBase_ + (i & mascara_) * passo_);
+    }
+    static uint8_t* payloadDe(SlotDifusao* s) { return reinterpret_cast<uint8_t*>(s + 1); }
+
+    void avancar(uint64_t novo) {
+        cursorLocal_ = novo;
+        meu_->cursor.store(novo, std::memory_order_release);
+        if (modo() == Modo::Bloquear) notificar(cab_->espaco);
+    }
+
+    // Cursor do reader mais atrasado; sem readers, ninguém segura o writer.
+    uint64_t menorCursor(uint64_t publicadas) const {
+        uint64_t menor = publicadas;
+        for (auto& l : cab_->leitores) {
+            if (l.ativo.load(std::memory_order_acquire) != INSCRICAO_ATIVA) continue;
+            const uint64_t c = l.cursor.load(std::memory_order_acquire);
+            if (c < menor) menor = c;
+        }
+        return menor;
+    }
+
+    void descartarLeitoresMortos() {
+        for (auto& l : cab_->leitores) {
+            if (l.ativo.load(std::memory_order_acquire) != INSCRICAO_ATIVA) continue;
+            const pid_t pid = l.pid.load(std::memory_order_relaxed);
+            if (pid > 0 && kill(pid, 0) != 0 && errno == ESRCH) {
+                l.ativo.store(0, std::memory_order_release);
+            }
+        }
+    }
+
+    CabecalhoDifusao* cab_ = nullptr;
+    uint8_t* slotsBase_ = nullptr;
+    uint64_t slots_ = 0;
+    uint64_t mascara_ = 0;
+    uint64_t tamSlot_ = 0;
+    uint64_t passo_ = 0;
+
+    // Estado local do writer
+    uint64_t publicadasLocal_ = 0;
+    uint64_t menorCursorCache_ = 0;
+
+    // Estado local do reader
+    CursorLeitor* meu_ = nullptr;
+    uint64_t cursorLocal_ = 0;
+};
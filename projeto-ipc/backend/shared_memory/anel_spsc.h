@@ -0,0 +1,374 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// anel_spsc.h — anel (ring buffer) single-producer/single-consumer de registros
+// de tamanho variável, pensado para viver dentro da memória compartilhada.
+//
+// Layout no segmento:
+//   [CabecalhoAnel][área de dados com `capacidade` bytes]
+//
+// Cada registro é [uint32_t tamanho][payload] alinhado a 8 bytes. Quando um
+// registro não cabe no fim da área, o produtor grava MARCA_PULO e recomeça do
+// início. Os índices `escrita`/`leitura` são contadores de bytes monotônicos
+// (nunca voltam a zero) e cada um fica em sua própria linha de cache, assim o
+// produtor e o consumidor não disputam a mesma linha (false sharing).
+//
+// Não há mutex no caminho de dados: o produtor publica com store-release em
+// `escrita` e o consumidor devolve espaço com store-release em `leitura`.
+// Cada lado ainda guarda localmente a última cópia do índice do outro lado e
+// só relê a linha compartilhada quando essa cópia indica anel cheio/vazio.
+//
+// O consumidor pode bloquear em aguardarDados(): gira, cede a CPU e estaciona
+// num futex do segmento (notificacao.h) até o produtor publicar.
+//
+// Controle de fluxo: o anel tem capacidade fixa e o que fazer quando ele enche
+// é uma política gravada no cabeçalho por quem o cria (PoliticaCheio), usada
+// por escrever():
+//   - Bloquear:         o produtor estaciona num segundo futex (`espaco`) até
+//                       o consumidor liberar espaço; nada se perde
+//   - Girar:            o produtor gira e cede a CPU sem nunca dormir
+//   - DescartarAntigas: o produtor nunca espera o consumidor: descarta os
+//                       registros mais antigos até caber o novo
+//   - Falhar:           escrever() devolve false (EAGAIN) na hora
+// Descartes e recusas são contados no cabeçalho e os dois lados enxergam os
+// contadores; creditos() diz quantos bytes cabem antes de a política agir.
+//
+// Em DescartarAntigas o produtor também avança `leitura`, então o consumidor
+// toma posse de cada registro com CAS ao espiar() e anuncia em `lendo` o que
+// ainda está usando; o produtor não reaproveita espaço a partir de `lendo`, e
+// a view devolvida por espiar() continua válida até consumir().
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <string>
+#include <thread>
+#include "notificacao.h"
+
+constexpr size_t TAM_LINHA_CACHE = 64;
+constexpr uint32_t MAGICO_ANEL = 0x49504352; // "IPCR"
+constexpr uint32_t VERSAO_ANEL = 3;
+
+// O que escrever() faz com o anel cheio (ver o comentário do topo)
+enum class PoliticaCheio : uint32_t { Bloquear, Girar, DescartarAntigas, Falhar };
+
+struct CabecalhoAnel {
+    alignas(TAM_LINHA_CACHE) uint32_t magico;  // gravado por último na inicialização
+    uint32_t versao;
+    uint64_t capacidade;                       // bytes da área de dados (potência de 2)
+    std::atomic<uint32_t> encerrar_flag;       // sinaliza encerramento (definida pelo writer)
+    PoliticaCheio politica;                    // fixa desde a inicialização
+
+    alignas(TAM_LINHA_CACHE) std::atomic<uint64_t> escrita; // só o produtor escreve
+    std::atomic<uint64_t> descartadas;         // registros descartados (DescartarAntigas)
+    std::atomic<uint64_t> recusadas;           // escritas recusadas (Falhar)
+
+    alignas(TAM_LINHA_CACHE) std::atomic<uint64_t> leitura; // consumidor (e produtor, ao descartar)
+    std::atomic<uint64_t> lendo;               // DescartarAntigas: registro em uso pelo consumidor
+
+    alignas(TAM_LINHA_CACHE) EventoCompartilhado dados;     // acorda o consumidor
+    alignas(TAM_LINHA_CACHE) EventoCompartilhado espaco;    // acorda o produtor (Bloquear)
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "o anel depende de atômicos de 64 bits sem lock entre processos");
+
+class AnelSPSC {
+public:
+    static constexpr uint32_t MARCA_PULO = 0xFFFFFFFFu;
+    static constexpr uint64_t OCIOSO = UINT64_MAX; // `lendo` sem registro em uso
+
+    // Bytes necessários no segmento para um anel com `capacidade` bytes de dados.
+    static size_t tamanhoNecessario(size_t capacidade) {
+        return sizeof(CabecalhoAnel) + capacidade;
+    }
+
+    // Bytes da área de dados; o que vier depois no segmento começa em
+    // tamanhoNecessario(capacidade()).
+    size_t capacidade() const { return capacidade_; }
+
+    // Maior payload que cabe em um único registro.
+    size_t maiorMensagem() const { return capacidade_ - sizeof(uint32_t); }
+
+    // Inicializa o anel em `mem` (lado que cria o segmento). `capacidade`
+    // precisa ser potência de 2 e múltiplo de 8.
+    bool inicializar(void* mem, size_t capacidade, PoliticaCheio politica = PoliticaCheio::Bloquear) {
+        if (capacidade < 64 || (capacidade & (capacidade - 1)) != 0) return false;
+        auto* cab = new (mem) CabecalhoAnel();
+        cab->versao = VERSAO_ANEL;
+        cab->capacidade = capacidade;
+        cab->politica = politica;
+        cab->encerrar_flag.store(0, std::memory_order_relaxed);
+        cab->escrita.store(0, std::memory_order_relaxed);
+        cab->descartadas.store(0, std::memory_order_relaxed);
+        cab->recusadas.store(0, std::memory_order_relaxed);
+        cab->leitura.store(0, std::memory_order_relaxed);
+        cab->lendo.store(OCIOSO, std::memory_order_relaxed);
+        inicializarEvento(cab->dados);
+        inicializarEvento(cab->espaco);
+        std::atomic_thread_fence(std::memory_order_release);
+        cab->magico = MAGICO_ANEL;
+        return anexar(mem);
+    }
+
+    // Anexa a um anel já inicializado por outro processo.
+    bool anexar(void* mem) {
+        auto* cab = static_cast<CabecalhoAnel*>(mem);
+        if (cab->magico != MAGICO_ANEL || cab->versao != VERSAO_ANEL) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        cab_ = cab;
+        dados_ = reinterpret_cast<uint8_t*>(cab + 1);
+        capacidade_ = cab->capacidade;
+        mascara_ = capacidade_ - 1;
+        politica_ = cab->politica;
+        escritaLocal_ = leituraCache_ = cab->escrita.load(std::memory_order_acquire);
+        leituraLocal_ = escritaCache_ = cab->leitura.load(std::memory_order_acquire);
+        return true;
+    }
+
+    PoliticaCheio politica() const { return politica_; }
+
+    // Bytes livres agora (aproximado: o outro lado pode estar mexendo)
+    size_t creditos() const {
+        const uint64_t ocupados = cab_->escrita.load(std::memory_order_acquire) -
+                                  cab_->leitura.load(std::memory_order_acquire);
+        return ocupados >= capacidade_ ? 0 : (size_t)(capacidade_ - ocupados);
+    }
+    uint64_t descartadas() const { return cab_->descartadas.load(std::memory_order_relaxed); }
+    uint64_t recusadas() const { return cab_->recusadas.load(std::memory_order_relaxed); }
+
+    // ---------------------------------------------------------------- produtor
+
+    // Publica um registro aplicando a política do anel quando ele está cheio.
+    // false só com Falhar (errno = EAGAIN) ou registro maior que
+    // maiorMensagem() (EMSGSIZE); `espera` é o orçamento de Bloquear/Girar.
+    bool escrever(const void* dados, size_t n, const PoliticaEspera& espera = PoliticaEspera()) {
+        if (n > maiorMensagem()) {
+            errno = EMSGSIZE;
+            return false;
+        }
+        if (tentarEscrever(dados, n)) return true;
+        switch (politica_) {
+        case PoliticaCheio::Bloquear:
+            do {
+                aguardarEspaco(n, espera);
+            } while (!tentarEscrever(dados, n));
+            return true;
+        case PoliticaCheio::Girar:
+            for (uint32_t i = 0; !tentarEscrever(dados, n); ++i) {
+                if (i < espera.giros) pausaCpu();
+                else std::this_thread::yield();
+            }
+            return true;
+        case PoliticaCheio::DescartarAntigas:
+            // Sem nada a descartar, o espaço que falta está com o consumidor,
+            // que o devolve em consumir()
+            while (!tentarEscrever(dados, n)) {
+                if (!descartarMaisAntigo()) std::this_thread::yield();
+            }
+            return true;
+        case PoliticaCheio::Falhar:
+            break;
+        }
+        cab_->recusadas.fetch_add(1, std::memory_order_relaxed);
+        errno = EAGAIN;
+        return false;
+    }
+
+    // Bloqueia até tentarEscrever(n) poder avançar: se o registro precisa de
+    // pulo, até caber o pulo (tentarEscrever o publica e, sem espaço ainda
+    // para o registro, devolve false: chame de novo); senão até caber o
+    // registro. Use em laço com tentarEscrever().
+    void aguardarEspaco(size_t n, const PoliticaEspera& politica = PoliticaEspera()) {
+        aguardar(cab_->espaco, [this, n] { return temEspaco(bytesParaEscrever(n)); }, politica);
+    }
+
+    // Tenta publicar um registro. Retorna false se o anel está cheio (ou se o
+    // registro é maior que maiorMensagem()); nada é sobrescrito.
+    bool tentarEscrever(const void* dados, size_t n) {
+        const uint64_t total = alinhar(sizeof(uint32_t) + n);
+        if (total > capacidade_) return false;
+
+        uint64_t pos = escritaLocal_ & mascara_;
+        const uint64_t ateFim = capacidade_ - pos;
+        if (total > ateFim) {
+            // Não cabe contíguo: marca o resto da área como pulo e volta ao início.
+            if (!temEspaco(ateFim)) return false;
+            const uint32_t marca = MARCA_PULO;
+            std::memcpy(dados_ + pos, &marca, sizeof(marca));
+            escritaLocal_ += ateFim;
+            cab_->escrita.store(escritaLocal_, std::memory_order_release);
+            pos = 0;
+        }
+        if (!temEspaco(total)) return false;
+
+        const uint32_t tam = (uint32_t)n;
+        std::memcpy(dados_ + pos, &tam, sizeof(tam));
+        std::memcpy(dados_ + pos + sizeof(tam), dados, n);
+        escritaLocal_ += total;
+        cab_->escrita.store(escritaLocal_, std::memory_order_release);
+        notificar(cab_->dados);
+        return true;
+    }
+
+    void sinalizarEncerramento() {
+        cab_->encerrar_flag.store(1, std::memory_order_release);
+        notificar(cab_->dados);
+    }
+
+    // -------------------------------------------------------------- consumidor
+
+    // Devolve um ponteiro para o payload do próximo registro (sem copiar) e
+    // seu tamanho em `n`, ou nullptr se o anel está vazio. O ponteiro vale até
+    // a chamada de consumir().
+    const uint8_t* espiar(size_t& n) {
+        if (politica_ == PoliticaCheio::DescartarAntigas) return espiarDisputado(n);
+        while (true) {
+            if (leituraLocal_ == escritaCache_) {
+                escritaCache_ = cab_->escrita.load(std::memory_order_acquire);
+                if (leituraLocal_ == escritaCache_) return nullptr;
+            }
+            const uint64_t pos = leituraLocal_ & mascara_;
+            uint32_t tam;
+            std::memcpy(&tam, dados_ + pos, sizeof(tam));
+            if (tam == MARCA_PULO) {
+                leituraLocal_ += capacidade_ - pos;
+                cab_->leitura.store(leituraLocal_, std::memory_order_release);
+                // O produtor pode estar esperando justamente estes bytes
+                if (politica_ == PoliticaCheio::Bloquear) notificar(cab_->espaco);
+                continue;
+            }
+            tamEspiado_ = tam;
+            n = tam;
+            return dados_ + pos + sizeof(tam);
+        }
+    }
+
+    // Libera o registro devolvido pelo último espiar().
+    void consumir() {
+        if (politica_ == PoliticaCheio::DescartarAntigas) {
+            // `leitura` já passou deste registro ao espiar(); só devolve o espaço
+            emPosse_ = false;
+            cab_->lendo.store(OCIOSO, std::memory_order_release);
+            return;
+        }
+        leituraLocal_ += alinhar(sizeof(uint32_t) + tamEspiado_);
+        cab_->leitura.store(leituraLocal_, std::memory_order_release);
+        if (politica_ == PoliticaCheio::Bloquear) notificar(cab_->espaco);
+    }
+
+    // Bloqueia até haver registro para ler ou o writer sinalizar encerramento.
+    void aguardarDados(const PoliticaEspera& politica = PoliticaEspera()) {
+        aguardar(cab_->dados, [this] {
+            const uint64_t leitura = politica_ == PoliticaCheio::DescartarAntigas
+                ? cab_->leitura.load(std::memory_order_acquire) : leituraLocal_;
+            return leitura != cab_->escrita.load(std::memory_order_acquire) || encerrado();
+        }, politica);
+    }
+
+    // Conveniência: copia o próximo registro para `saida`.
+    bool tentarLer(std::string& saida) {
+        size_t n;
+        const uint8_t* p = espiar(n);
+        if (!p) return false;
+        saida.assign(reinterpret_cast<const char*>(p), n);
+        consumir();
+        return true;
+    }
+
+    bool encerrado() const {
+        return cab_->encerrar_flag.load(std::memory_order_acquire) != 0;
+    }
+
+private:
+    static uint64_t alinhar(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+    bool temEspaco(uint64_t n) {
+        if (escritaLocal_ + n - leituraCache_ <= capacidade_) return true;
+        leituraCache_ = cab_->leitura.load(std::memory_order_seq_cst);
+        if (politica_ == PoliticaCheio::DescartarAntigas) {
+            // Lido depois de `leitura`: o registro que o consumidor tomou
+            // antes do último avanço aparece aqui
+            const uint64_t lendo = cab_->lendo.load(std::memory_order_seq_cst);
+            if (lendo < leituraCache_) leituraCache_ = lendo;
+        }
+        return escritaLocal_ + n - leituraCache_ <= capacidade_;
+    }
+
+    // Bytes que tentarEscrever() precisa para o próximo passo com `n`: o
+    // pulo do fim, se o registro não cabe contíguo, ou o registro. Pulo e
+    // registro juntos podem passar da capacidade, então nunca se espera pela
+    // soma: o pulo é publicado antes e libera o início para o registro
+    uint64_t bytesParaEscrever(size_t n) const {
+        const uint64_t total = alinhar(sizeof(uint32_t) + n);
+        const uint64_t ateFim = capacidade_ - (escritaLocal_ & mascara_);
+        return total > ateFim ? ateFim : total;
+    }
+
+    // DescartarAntigas, produtor: tira o registro mais antigo do anel. false
+    // se não há o que tirar (vazio ou só o que o consumidor está lendo).
+    bool descartarMaisAntigo() {
+        uint64_t l = cab_->leitura.load(std::memory_order_acquire);
+        if (l == escritaLocal_) return false;
+        uint32_t tam;
+        std::memcpy(&tam, dados_ + (l & mascara_), sizeof(tam));
+        const uint64_t fim = l + (tam == MARCA_PULO ? capacidade_ - (l & mascara_)
+                                                    : alinhar(sizeof(uint32_t) + tam));
+        // Falha se o consumidor tomou este registro antes: tenta o seguinte
+        if (!cab_->leitura.compare_exchange_strong(l, fim, std::memory_order_seq_cst)) return true;
+        if (tam != MARCA_PULO) cab_->descartadas.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // DescartarAntigas, consumidor: anuncia em `lendo` o registro do início e
+    // toma posse dele com CAS em `leitura`. Se o produtor o descartou no
+    // caminho, recomeça do novo início.
+    const uint8_t* espiarDisputado(size_t& n) {
+        if (emPosse_) { // espiar() de novo sem consumir(): o mesmo registro
+            n = tamEspiado_;
+            return dados_ + (leituraLocal_ & mascara_) + sizeof(uint32_t);
+        }
+        while (true) {
+            uint64_t l = cab_->leitura.load(std::memory_order_acquire);
+            // O produtor pode ter levado `leitura` além da cópia local de `escrita`
+            if (l >= escritaCache_) {
+                escritaCache_ = cab_->escrita.load(std::memory_order_acquire);
+                if (l == escritaCache_) {
+                    cab_->lendo.store(OCIOSO, std::memory_order_release);
+                    return nullptr;
+                }
+            }
+            cab_->lendo.store(l, std::memory_order_seq_cst);
+            if (cab_->leitura.load(std::memory_order_seq_cst) != l) continue;
+            // Com `lendo` visível o produtor não reaproveita este espaço
+            const uint64_t pos = l & mascara_;
+            uint32_t tam;
+            std::memcpy(&tam, dados_ + pos, sizeof(tam));
+            const uint64_t fim = l + (tam == MARCA_PULO ? capacidade_ - pos : alinhar(sizeof(uint32_t) + tam));
+            if (!cab_->leitura.compare_exchange_strong(l, fim, std::memory_order_seq_cst)) continue;
+            if (tam == MARCA_PULO) continue;
+            leituraLocal_ = l;
+            tamEspiado_ = tam;
+            emPosse_ = true;
+            n = tam;
+            return dados_ + pos + sizeof(tam);
+        }
+    }
+
+    CabecalhoAnel* cab_ = nullptr;
+    uint8_t* dados_ = nullptr;
+    uint64_t capacidade_ = 0;
+    uint64_t mascara_ = 0;
+    PoliticaCheio politica_ = PoliticaCheio::Bloquear;
+
+    // Estado local do produtor
+    uint64_t escritaLocal_ = 0;
+    uint64_t leituraCache_ = 0;
+
+    // Estado local do consumidor
+    uint64_t leituraLocal_ = 0;
+    uint64_t escritaCache_ = 0;
+    uint32_t tamEspiado_ = 0;
+    bool emPosse_ = false; // DescartarAntigas: registro tomado e não consumido
+};
@@ -0,0 +1,244 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// arena.h — heap dentro do segmento compartilhado, para objetos de tamanho
+// variável (textos, vetores, árvores) montados direto na memória compartilhada.
+// Pelo canal (anel) passa só o deslocamento do objeto.
+//
+// Layout no segmento:
+//   [CabecalhoArena][blocos ...]
+//
+// Cada bloco tem um cabeçalho de 16 bytes e tamanho 2^classe (32 B, 64 B, ...).
+// alocar() tira um bloco da lista livre da classe e, se ela estiver vazia,
+// avança `topo` sobre a área ainda não usada; liberar() devolve o bloco à
+// lista da classe. As listas são pilhas de Treiber: o topo de cada uma é um
+// atômico de 64 bits com [etiqueta u32][deslocamento/16 u32], e a etiqueta
+// muda a cada troca para que um bloco retirado e devolvido no meio de uma CAS
+// não seja confundido (ABA). Sem mutex: qualquer processo aloca e libera, e
+// um bloco alocado pelo writer pode ser liberado pelo reader.
+//
+// Endereços variam entre processos (cada um mapeia o segmento onde o kernel
+// quiser), então nada dentro da arena guarda ponteiros comuns:
+//   - deslocamento(p)/endereco<T>(d): posição a partir do início da arena
+//     (0 = nulo), para mandar pelo canal;
+//   - PtrRelativo<T>: ponteiro guardado como distância até ele mesmo, válido
+//     em qualquer mapeamento, para ligar objetos entre si (ex.: nós de árvore).
+//
+// Não há compactação: um bloco liberado só volta a servir pedidos da mesma
+// classe. Tipos guardados na arena não podem ter ponteiros comuns, std::string
+// ou vtable, e liberar() não chama destrutores.
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "anel_spsc.h" // TAM_LINHA_CACHE
+
+constexpr uint32_t MAGICO_ARENA = 0x49504341; // "IPCA"
+constexpr uint32_t VERSAO_ARENA = 1;
+constexpr uint32_t MAGICO_BLOCO = 0x424C4F43; // "BLOC": bloco entregue por alocar()
+constexpr size_t CLASSE_MINIMA = 5;           // 32 bytes: cabeçalho + 16 de dados
+constexpr size_t NUM_CLASSES = 32;            // até 2^36 bytes por bloco
+constexpr size_t UNIDADE_ARENA = 16;          // deslocamentos nas listas contam de 16 em 16
+
+struct CabecalhoArena {
+    alignas(TAM_LINHA_CACHE) uint32_t magico; // gravado por último na inicialização
+    uint32_t versao;
+    uint64_t tamanho;                         // bytes da arena, cabeçalho incluído
+
+    alignas(TAM_LINHA_CACHE) std::atomic<uint64_t> topo;  // início da área nunca usada
+    std::atomic<uint64_t> emUso;                          // bytes em blocos entregues
+    alignas(TAM_LINHA_CACHE) std::atomic<uint64_t> livres[NUM_CLASSES];
+};
+
+// Cabeçalho de cada bloco (os dados começam logo depois, alinhados a 16)
+struct alignas(16) CabecalhoBloco {
+    uint32_t magico;
+    uint32_t classe;
+    std::atomic<uint32_t> proximo; // na lista livre: próximo bloco (deslocamento/16)
+};
+
+static_assert(sizeof(CabecalhoBloco) == UNIDADE_ARENA, "cabeçalho de bloco deve ter 16 bytes");
+
+class ArenaCompartilhada {
+public:
+    // Bytes necessários no segmento para uma arena com `dados` bytes de blocos.
+    static size_t tamanhoNecessario(size_t dados) {
+        return sizeof(CabecalhoArena) + (dados + UNIDADE_ARENA - 1) / UNIDADE_ARENA * UNIDADE_ARENA;
+    }
+
+    // Inicializa a arena em `mem` (lado que cria o segmento), com `tamanho`
+    // bytes ao todo; `mem` alinhado a TAM_LINHA_CACHE.
+    bool inicializar(void* mem, size_t tamanho) {
+        if (tamanho <= sizeof(CabecalhoArena) || tamanho / UNIDADE_ARENA > UINT32_MAX) return false;
+        auto* cab = new (mem) CabecalhoArena();
+        cab->versao = VERSAO_ARENA;
+        cab->tamanho = tamanho / UNIDADE_ARENA * UNIDADE_ARENA;
+        cab->topo.store(sizeof(CabecalhoArena), std::memory_order_relaxed);
+        cab->emUso.store(0, std::memory_order_relaxed);
+        for (auto& l : cab->livres) l.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        cab->magico = MAGICO_ARENA;
+        return anexar(mem);
+    }
+
+    // Anexa a uma arena já inicializada por outro processo.
+    bool anexar(void* mem) {
+        auto* cab = static_cast<CabecalhoArena*>(mem);
+        if (cab->magico != MAGICO_ARENA || cab->versao != VERSAO_ARENA) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        cab_ = cab;
+        base_ = static_cast<char*>(mem);
+        return true;
+    }
+
+    // Bloco com pelo menos `n` bytes, alinhado a 16; nullptr se a arena esgotou.
+    void* alocar(size_t n) {
+        size_t classe = CLASSE_MINIMA;
+        while (classe < CLASSE_MINIMA + NUM_CLASSES && ((size_t)1 << classe) < n + sizeof(CabecalhoBloco)) {
+            ++classe;
+        }
+        if (classe == CLASSE_MINIMA + NUM_CLASSES) return nullptr;
+        const uint64_t bytes = (uint64_t)1 << classe;
+
+        CabecalhoBloco* b = retirar(cab_->livres[classe - CLASSE_MINIMA]);
+        if (!b) {
+            uint64_t topo = cab_->topo.load(std::memory_order_relaxed);
+            do {
+                if (bytes > cab_->tamanho - topo) return nullptr;
+            } while (!cab_->topo.compare_exchange_weak(topo, topo + bytes, std::memory_order_relaxed));
+            b = reinterpret_cast<CabecalhoBloco*>(base_ + topo);
+            b->classe = (uint32_t)classe;
+        }
+        b->magico = MAGICO_BLOCO;
+        cab_->emUso.fetch_add(bytes, std::memory_order_relaxed);
+        return b + 1;
+    }
+
+    // Devolve um bloco de alocar() (de qualquer processo). false se `p` não é
+    // um bloco em uso desta arena.
+    bool liberar(void* p) {
+        if (!p) return true;
+        auto* b = static_cast<CabecalhoBloco*>(p) - 1;
+        if ((char*)b < base_ + sizeof(CabecalhoArena) || (char*)b >= base_ + cab_->tamanho) return false;
+        if (b->magico != MAGICO_BLOCO || b->classe < CLASSE_MINIMA ||
+            b->classe >= CLASSE_MINIMA + NUM_CLASSES) {
+            return false;
+        }
+        b->magico = 0; // liberar duas vezes o mesmo bloco falha na segunda
+        cab_->emUso.fetch_sub((uint64_t)1 << b->classe, std::memory_order_relaxed);
+        devolver(cab_->livres[b->classe - CLASSE_MINIMA], b);
+        return true;
+    }
+
+    // Constrói um T na arena (T sem ponteiros comuns; ver o topo do arquivo)
+    template <typename T, typename... Args>
+    T* criar(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "liberar() não chama destrutores");
+        void* p = alocar(sizeof(T));
+        return p ? new (p) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    // Posição de `p` a partir do início da arena (0 = nulo), para o canal
+    uint64_t deslocamento(const void* p) const { return p ? (uint64_t)((const char*)p - base_) : 0; }
+
+    // Endereço, neste processo, de um deslocamento recebido; nullptr se ele
+    // não cai num bloco da arena
+    template <typename T = void>
+    T* endereco(uint64_t d) const {
+        if (d < sizeof(CabecalhoArena) + sizeof(CabecalhoBloco) || d >= cab_->tamanho) return nullptr;
+        return reinterpret_cast<T*>(base_ + d);
+    }
+
+    size_t tamanho() const { return cab_->tamanho; }
+    size_t emUso() const { return cab_->emUso.load(std::memory_order_relaxed); }
+    size_t nuncaUsado() const { return cab_->tamanho - cab_->topo.load(std::memory_order_relaxed); }
+
+private:
+    static uint32_t indice(uint64_t lista) { return (uint32_t)lista; }
+
+    CabecalhoBloco* bloco(uint32_t indice) const {
+        return indice ? reinterpret_cast<CabecalhoBloco*>(base_ + (uint64_t)indice * UNIDADE_ARENA) : nullptr;
+    }
+
+    // Pilha de Treiber: a etiqueta (32 bits altos) muda a cada troca
+    CabecalhoBloco* retirar(std::atomic<uint64_t>& lista) {
+        uint64_t topo = lista.load(std::memory_order_acquire);
+        while (CabecalhoBloco* b = bloco(indice(topo))) {
+            const uint64_t novo = ((topo >> 32) + 1) << 32 | b->proximo.load(std::memory_order_relaxed);
+            if (lista.compare_exchange_weak(topo, novo, std::memory_order_acquire, std::memory_order_acquire)) {
+                return b;
+            }
+        }
+        return nullptr;
+    }
+
+    void devolver(std::atomic<uint64_t>& lista, CabecalhoBloco* b) {
+        const uint32_t meu = (uint32_t)(((char*)b - base_) / UNIDADE_ARENA);
+        uint64_t topo = lista.load(std::memory_order_relaxed);
+        do {
+            b->proximo.store(indice(topo), std::memory_order_relaxed);
+        } while (!lista.compare_exchange_weak(topo, ((topo >> 32) + 1) << 32 | meu, std::memory_order_release,
+                                              std::memory_order_relaxed));
+    }
+
+    CabecalhoArena* cab_ = nullptr;
+    char* base_ = nullptr;
+};
+
+// -----------------------------------------------------------------------------
+// PtrRelativo<T>: ponteiro guardado como distância (em bytes) do próprio campo
+// até o alvo; 0 = nulo. Vale em qualquer processo, desde que o campo e o alvo
+// estejam no mesmo segmento.
+//
+//   struct No { int64_t chave; PtrRelativo<No> esq, dir; };
+//   No* raiz = arena.criar<No>(No{10});
+//   raiz->esq = arena.criar<No>(No{5});
+//   ... no outro processo: arena.endereco<No>(d)->esq->chave
+// -----------------------------------------------------------------------------
+template <typename T>
+class PtrRelativo {
+public:
+    PtrRelativo() = default;
+    PtrRelativo(T* p) { *this = p; }
+    PtrRelativo(const PtrRelativo& o) { *this = o.get(); }
+
+    PtrRelativo& operator=(T* p) {
+        distancia_ = p ? (int64_t)((const char*)p - (const char*)this) : 0;
+        return *this;
+    }
+    PtrRelativo& operator=(const PtrRelativo& o) { return *this = o.get(); }
+
+    T* get() const { return distancia_ ? (T*)((const char*)this + distancia_) : nullptr; }
+    T* operator->() const { return get(); }
+    T& operator*() const { return *get(); }
+    explicit operator bool() const { return distancia_ != 0; }
+
+private:
+    int64_t distancia_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Texto na arena: [u64 tamanho][bytes]. copiarTexto devolve o deslocamento
+// (0 se não coube); lerTexto devolve uma view sobre a própria arena.
+// -----------------------------------------------------------------------------
+inline uint64_t copiarTexto(ArenaCompartilhada& arena, std::string_view texto) {
+    char* p = static_cast<char*>(arena.alocar(sizeof(uint64_t) + texto.size()));
+    if (!p) return 0;
+    const uint64_t tamanho = texto.size();
+    std::memcpy(p, &tamanho, sizeof(tamanho));
+    std::memcpy(p + sizeof(tamanho), texto.data(), texto.size());
+    return arena.deslocamento(p);
+}
+
+inline std::string_view lerTexto(const ArenaCompartilhada& arena, uint64_t d) {
+    const char* p = arena.endereco<const char>(d);
+    if (!p || arena.tamanho() - d < sizeof(uint64_t)) return {};
+    uint64_t tamanho;
+    std::memcpy(&tamanho, p, sizeof(tamanho));
+    if (tamanho > arena.tamanho() - d - sizeof(tamanho)) return {};
+    return std::string_view(p + sizeof(tamanho), tamanho);
+}
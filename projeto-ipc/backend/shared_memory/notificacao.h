@@ -0,0 +1,102 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// notificacao.h — evento de notificação entre processos (futex) que vive no
+// segmento compartilhado.
+//
+// O consumidor espera em modo adaptativo: primeiro gira (spin) consultando a
+// condição, depois cede a CPU algumas vezes e, por fim, estaciona no futex até
+// o produtor acordá-lo. O produtor só faz a syscall de wake quando há alguém
+// estacionado (`esperando` > 0), então no caminho quente publicar custa apenas
+// uma barreira de memória.
+//
+// Protocolo (evita wakeup perdido):
+//   produtor:   publica dados; fence seq_cst; se esperando > 0 → ++sequencia, wake
+//   consumidor: ++esperando (seq_cst); lê sequencia; reconsulta a condição;
+//               futex_wait(sequencia, valor lido); --esperando
+// Ou o produtor enxerga o consumidor em `esperando`, ou o consumidor enxerga
+// os dados na reconsulta; o futex_wait ainda confere `sequencia` no kernel.
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct EventoCompartilhado {
+    std::atomic<uint32_t> sequencia;  // palavra do futex, incrementada a cada wake
+    std::atomic<uint32_t> esperando;  // consumidores estacionados (ou prestes a)
+};
+
+// Orçamento de espera ativa antes de estacionar no futex. Ajustável por
+// implantação: mais giros = menor latência de despertar, mais CPU ociosa.
+struct PoliticaEspera {
+    uint32_t giros = 2000;     // iterações com `pause` consultando a condição
+    uint32_t cedencias = 50;   // chamadas a sched_yield antes de estacionar
+};
+
+inline void pausaCpu() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Sem FUTEX_PRIVATE_FLAG: a palavra é compartilhada entre processos.
+// `limite` é relativo (nullptr = sem limite).
+inline long futexEsperar(std::atomic<uint32_t>* palavra, uint32_t valor,
+                         const timespec* limite = nullptr) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(palavra), FUTEX_WAIT, valor,
+                   limite, nullptr, 0);
+}
+
+inline long futexAcordar(std::atomic<uint32_t>* palavra, int quantos) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(palavra), FUTEX_WAKE, quantos,
+                   nullptr, nullptr, 0);
+}
+
+inline void inicializarEvento(EventoCompartilhado& ev) {
+    ev.sequencia.store(0, std::memory_order_relaxed);
+    ev.esperando.store(0, std::memory_order_relaxed);
+}
+
+// Chamado pelo produtor logo após publicar (store-release dos índices).
+inline void notificar(EventoCompartilhado& ev) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ev.esperando.load(std::memory_order_relaxed) == 0) return;
+    ev.sequencia.fetch_add(1, std::memory_order_release);
+    futexAcordar(&ev.sequencia, INT_MAX);
+}
+
+// Bloqueia até `pronto()` ser verdadeiro, girando → cedendo → estacionando.
+// Com `limite`, desiste após esse tempo estacionado e devolve false.
+template <typename Pronto>
+bool aguardar(EventoCompartilhado& ev, Pronto pronto, const PoliticaEspera& politica,
+              const timespec* limite = nullptr) {
+    for (uint32_t i = 0; i < politica.giros; ++i) {
+        if (pronto()) return true;
+        pausaCpu();
+    }
+    for (uint32_t i = 0; i < politica.cedencias; ++i) {
+        if (pronto()) return true;
+        std::this_thread::yield();
+    }
+    while (true) {
+        ev.esperando.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const uint32_t seq = ev.sequencia.load(std::memory_order_acquire);
+        if (pronto()) {
+            ev.esperando.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        long r = futexEsperar(&ev.sequencia, seq, limite); // EAGAIN/EINTR: só reconsulta
+        int erro = errno;
+        ev.esperando.fetch_sub(1, std::memory_order_relaxed);
+        if (pronto()) return true;
+        if (r != 0 && erro == ETIMEDOUT) return false;
+    }
+}
@@ -1,120 +1,166 @@
-#include <windows.h>
-#include <iostream>
 #include <string>
-#include <chrono>
-#include <iomanip>
-#include <sstream>
-#include <ctime>
+#include <cerrno>
+#include <cstdlib>
+#include "segmento.h"
+#include "anel_spsc.h"
+#include "anel_difusao.h"
+#include "arena.h"
+#include "../common/log.h"
+#include "../common/metricas.h"
+#include "../common/mensagem.h"
+#include "notificacao.h"
 
-// Definições sobre a memória compartilhada e o mutex
-const wchar_t* NOME_MEMORIA = L"MinhaMemoria";
-const wchar_t* NOME_MUTEX   = L"MeuMutex";
-const int TAM_MEMORIA = 256;
+// Definições sobre a memória compartilhada
+const char* NOME_MEMORIA = "/MinhaMemoria";
 
-// Estrutura de dados que serão armazenados na memória compartilhada
-struct DadosCompartilhados {
-    wchar_t mensagem[TAM_MEMORIA]; // buffer da mensagem escrita pelo writer
-    bool encerrar_flag;             // flag para sinalizar encerramento (definida pelo writer)
-};
-
-// Função para gerar timestamp em formato ISO 8601
-std::string getTimestamp() {
-    using namespace std::chrono;
-    auto now = system_clock::now();
-    std::time_t now_time = system_clock::to_time_t(now);
-    std::tm* utc_tm = std::gmtime(&now_time);  // padrão C
-    std::ostringstream oss;
-    oss << std::put_time(utc_tm, "%Y-%m-%dT%H:%M:%SZ");
-    return oss.str();
+// Registra uma mensagem lida. As binárias (writer --binario) são lidas no lugar,
+// direto do segmento, e o instante de envio dá a latência writer → reader.
+// Com arena (writer --arena), o texto é lido na arena e o bloco liberado.
+void registrarLeitura(const char* dados, size_t n, ArenaCompartilhada* arena = nullptr) {
+    contarMetrica(Contador::MensagensRecebidas);
+    contarMetrica(Contador::BytesRecebidos, n);
+    std::string_view texto(dados, n);
+    VisaoMensagem m;
+    if (pareceMensagem(texto) && m.abrir(dados, n)) {
+        texto = m.texto(Campo::Texto);
+        if (m.tem(Campo::EnviadoEm)) medirLatencia(Latencia::Recebimento, monotonicoNs() - m.i64(Campo::EnviadoEm));
+        if (arena && m.tem(Campo::Referencia)) {
+            const uint64_t referencia = m.u64(Campo::Referencia);
+            texto = lerTexto(*arena, referencia);
+            contarMetrica(Contador::BytesRecebidos, texto.size());
+            // O logger copia o texto antes de o bloco voltar para a arena
+            logger(NivelLog::Info, "Leitura", texto, texto.size(), "shared_memory");
+            if (!arena->liberar(arena->endereco(referencia))) {
+                logger(NivelLog::Warn, "Leitura", "Referência fora da arena", (int64_t)referencia, "shared_memory");
+                contarMetrica(Contador::Erros);
+            }
+            return;
+        }
+    }
+    logger(NivelLog::Info, "Leitura", texto, n, "shared_memory");
 }
 
-// Logger em JSON
-void logger(const std::wstring& level, const std::wstring& event,
-            const std::wstring& msg, int bytes, const std::wstring& peer) {
-    std::wcout << L"{\n"
-               << L"  \"module\": \"ipc\",\n"
-               << L"  \"role\": \"reader\",\n"
-               << L"  \"level\": \"" << level << L"\",\n"
-               << L"  \"event\": \"" << event << L"\",\n"
-               << L"  \"ts\": \"" << getTimestamp().c_str() << L"\",\n"
-               << L"  \"details\": {\n"
-               << L"    \"msg\": \"" << msg << L"\",\n"
-               << L"    \"bytes\": " << bytes << L",\n"
-               << L"    \"peer\": \"" << peer << L"\"\n"
-               << L"  }\n"
-               << L"}" << std::endl;
+// Modo difusão: este reader é um entre vários inscritos e tem o próprio cursor
+int lerDifusao(AnelDifusao& anel, const PoliticaEspera& politica) {
+    if (!anel.inscrever()) {
+        logger(NivelLog::Error, "inscrição", "Limite de readers atingido", MAX_LEITORES, "system");
+        return 1;
+    }
+    logTexto("Reader iniciado (difusão)...");
+
+    std::string atual;
+    uint64_t perdidas = 0;
+    while (true) {
+        bool lida = anel.tentarLer(atual, perdidas);
+        if (perdidas > 0) {
+            // O writer sobrescreveu mensagens que este reader ainda não tinha lido
+            logger(NivelLog::Warn, "Perda", std::to_string(perdidas) + " mensagens perdidas", 0, "shared_memory");
+            contarMetrica(Contador::Erros, perdidas);
+        }
+        if (lida) {
+            registrarLeitura(atual.data(), atual.size());
+            continue;
+        }
+        if (anel.encerrado()) {
+            if (anel.tentarLer(atual, perdidas)) {
+                registrarLeitura(atual.data(), atual.size());
+                continue;
+            }
+            logger(NivelLog::Info, "Encerrar", "Reader encerrado", 0, "shared_memory");
+            break;
+        }
+        const int64_t inicioEspera = monotonicoNs();
+        anel.aguardarDados(politica);
+        medirLatencia(Latencia::Espera, monotonicoNs() - inicioEspera);
+    }
+    anel.cancelarInscricao();
+    return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    iniciarLog("ipc", "reader");
+    iniciarMetricas("ipc", "reader");
+    /* Orçamento de espera ativa (opcional):
+    --spin=N  iterações girando antes de ceder a CPU (0 = estaciona direto no futex)
+    --yield=N chamadas a sched_yield antes de estacionar
+    Mais giros reduzem a latência de despertar ao custo de CPU ociosa.
+    Mapeamento (segmento.h): --preencher mapeia todas as páginas na abertura e
+    --travar faz mlock, para que a leitura não pague faltas de página. */
+    PoliticaEspera politica;
+    OpcoesSegmento opcoes;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--spin=", 0) == 0) politica.giros = std::strtoul(arg.c_str() + 7, nullptr, 10);
+        else if (arg.rfind("--yield=", 0) == 0) politica.cedencias = std::strtoul(arg.c_str() + 8, nullptr, 10);
+        else if (arg == "--preencher") opcoes.preencher = true;
+        else if (arg == "--travar") opcoes.travar = true;
+    }
+
     /* Abre a memória compartilhada criada pelo writer
-    - cria um handle
-    - OpenFileMappingW: abre um mapeamento de memória já existente
-    - FILE_MAP_ALL_ACCESS: permite tanto leitura quanto escrita
-    - FALSE: não herda o handle para processos filhos
-    - NOME_MEMORIA*/
-    HANDLE hMapFile = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, NOME_MEMORIA);
-    if (!hMapFile) { 
-        logger(L"error", L"abrindo memória", L"Erro ao abrir memória compartilhada", GetLastError(), L"system");
-        return 1; 
+    - shm_open sem O_CREAT: o segmento precisa já existir
+    - mmap(MAP_SHARED) com o tamanho real do objeto (fstat)*/
+    SegmentoCompartilhado segmento;
+    if (!segmento.abrir(NOME_MEMORIA, opcoes)) {
+        logger(NivelLog::Error, "abrindo memória", "Erro ao abrir memória compartilhada", errno, "system");
+        return 1;
     }
-    // Mapeia a memória compartilhada para o espaço de endereços do processo
-    DadosCompartilhados* pontMem = (DadosCompartilhados*)MapViewOfFile(hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(DadosCompartilhados));
-    // Verifica se o o ponteiro que a aponta para a memória é valido, se a memória foi mapeada com sucesso
-    if (!pontMem) { 
-        logger(L"error", L"mapeando memória", L"Erro ao mapear memória", GetLastError(), L"system");
-        CloseHandle(hMapFile); //Fecha o handle da memória compartilhada
-        return 1; 
+    // Verifica se o segmento contém um anel inicializado pelo writer; o tipo
+    // (SPSC ou difusão) é identificado pelo número mágico do cabeçalho
+    AnelSPSC anel;
+    AnelDifusao anelDifusao;
+    if (anelDifusao.anexar(segmento.base())) {
+        return lerDifusao(anelDifusao, politica);
     }
-
-    /* Abre o mutex para sincronizar o acesso à memória compartilhada
-       - SYNCHRONIZE: permite operações de sincronização (ex: WaitForSingleObject)
-       - NOME_MUTEX: nome do mutex criado pelo writer*/
-    HANDLE hMutex = OpenMutexW(SYNCHRONIZE, FALSE, NOME_MUTEX);
-    // Verifica se o handle é valido, se o mutex foi aberto com sucesso
-    if (!hMutex) { 
-        logger(L"error", L"abrindo mutex", L"Erro ao abrir Mutex", GetLastError(), L"system");
-        UnmapViewOfFile(pontMem); // Desmapeia a memória
-        CloseHandle(hMapFile); 
-        return 1; 
+    if (!anel.anexar(segmento.base())) {
+        logger(NivelLog::Error, "mapeando memória", "Segmento não contém um anel válido", 0, "system");
+        return 1;
+    }
+    // Arena do writer --arena, logo depois do anel (se o segmento tiver uma)
+    ArenaCompartilhada arenaSegmento;
+    ArenaCompartilhada* arena = nullptr;
+    const size_t tamanhoAnel = AnelSPSC::tamanhoNecessario(anel.capacidade());
+    if (segmento.tamanho() > tamanhoAnel && arenaSegmento.anexar((char*)segmento.base() + tamanhoAnel)) {
+        arena = &arenaSegmento;
     }
 
-    std::wcout << L"Reader iniciado...\n";
+    logTexto("Reader iniciado...");
 
+    // writer --cheio=descartar: avisa as mensagens que o writer descartou
+    // antes de este reader chegar a elas, como no modo difusão
+    const bool descartes = anel.politica() == PoliticaCheio::DescartarAntigas;
+    uint64_t descartesVistos = 0;
     while (true) {
-        // Espera para adquirir o mutex
-        DWORD dwWait = WaitForSingleObject(hMutex, INFINITE);
-        if (dwWait != WAIT_OBJECT_0) {
-            logger(L"error", L"esperando mutex", L"Falha ao esperar pelo Mutex", GetLastError(), L"system");
-            break;
+        if (descartes && anel.descartadas() != descartesVistos) {
+            const uint64_t perdidas = anel.descartadas() - descartesVistos;
+            descartesVistos += perdidas;
+            logger(NivelLog::Warn, "Perda", std::to_string(perdidas) + " mensagens perdidas", 0, "shared_memory");
+            contarMetrica(Contador::Erros, perdidas);
         }
-
-        // Lê a mensagem atual da memória compartilhada
-        std::wstring atual(pontMem->mensagem);
-
-        // Verifica se a flag de encerramento doi definida como true pelo writer e encerra
-        if (pontMem->encerrar_flag) {
-            logger(L"info", L"mutex adiquirido", L"Leitura protegida por mutex", 0, L"system");
-            logger(L"info", L"Encerrar", L"Reader encerrado", 0, L"shared_memory");
-            logger(L"info", L"mutex liberado", L"Reader liberou o mutex", 0, L"system");
-            ReleaseMutex(hMutex); // libera o mutex antes de sair
-            break;
+        // Drena todos os registros disponíveis, lendo o payload direto do segmento
+        size_t n;
+        const uint8_t* p = anel.espiar(n);
+        if (p) {
+            // O logger copia o payload para o próprio anel antes de consumir()
+            registrarLeitura((const char*)p, n, arena);
+            anel.consumir(); // devolve o espaço ao writer
+            continue;
         }
 
-        // Se há mensagem nova, registra no logger
-        if (!atual.empty()) {
-            logger(L"info", L"mutex adiquirido", L"Leitura protegida por mutex", 0, L"system");
-            logger(L"info", L"Leitura", atual, atual.size(), L"shared_memory");
-            logger(L"info", L"mutex liberado", L"Reader liberou o mutex", 0, L"system");
-            pontMem->mensagem[0] = L'\0'; // Limpa a mensagem após ler, libera o buffer
+        // Anel vazio: a flag só é definida depois da última escrita, então se
+        // ela estiver ativa e o anel continuar vazio não há mais nada a ler
+        if (anel.encerrado()) {
+            if (anel.espiar(n)) continue;
+            logger(NivelLog::Info, "Encerrar", "Reader encerrado", 0, "shared_memory");
+            break;
         }
 
-        ReleaseMutex(hMutex); // libera o mutex para o writer
-        Sleep(200); // evita busy wait (pausa pequena antes da próxima leitura)
+        // Sem mensagem: gira, cede a CPU e então bloqueia no futex até o writer
+        // publicar (ou sinalizar encerramento); não há polling periódico
+        const int64_t inicioEspera = monotonicoNs();
+        anel.aguardarDados(politica);
+        medirLatencia(Latencia::Espera, monotonicoNs() - inicioEspera);
     }
 
-   // Lopp encerrado, desmapeia a memoria e fecha os handles da memória e do mutex
-    UnmapViewOfFile(pontMem);
-    CloseHandle(hMapFile);
-    CloseHandle(hMutex);
+    // Loop encerrado, o destrutor do segmento desfaz o mapeamento
     return 0;
 }
@@ -0,0 +1,219 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// segmento.h — segmento de memória compartilhada POSIX (shm_open + mmap).
+//
+// O writer cria o segmento (criar) e o reader o abre (abrir). O objeto é dono
+// do mapeamento e o desfaz no destrutor; remover() apaga o nome em /dev/shm.
+// Erros são sinalizados pelo retorno (false) com errno preenchido, para que o
+// chamador registre no logger como antes fazia com GetLastError().
+//
+// Segmentos grandes (anéis de centenas de MB) podem ser ajustados por
+// OpcoesSegmento, para tirar do caminho dos dados as faltas de TLB e as faltas
+// de página do primeiro acesso:
+//   - paginas=Enormes:       arquivo num ponto de montagem hugetlbfs (páginas
+//                            de 2 MiB/1 GiB reservadas em vm.nr_hugepages) em
+//                            vez de /dev/shm; abrir() procura nos dois lugares
+//   - paginas=Transparentes: continua em /dev/shm e pede THP com madvise
+//                            (precisa de shmem_enabled = advise ou always;
+//                            sem isso o pedido é ignorado pelo kernel)
+//   - noNuma:                mbind das páginas no nó, antes do primeiro toque
+//   - preencher:             todas as páginas alocadas e mapeadas já no criar/abrir
+//   - travar:                mlock: as páginas nunca vão para o swap
+//                            (limitado por RLIMIT_MEMLOCK)
+// Opções pedidas que o sistema não atende fazem criar/abrir falhar, exceto o
+// madvise de THP, que é só uma dica.
+// -----------------------------------------------------------------------------
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <mntent.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23 // Linux 5.14
+#endif
+
+constexpr size_t TAM_PAGINA_ENORME_THP = 2u << 20;
+
+struct OpcoesSegmento {
+    enum class Paginas { Normais, Enormes, Transparentes };
+    Paginas paginas = Paginas::Normais;
+    int noNuma = -1;        // -1: política de memória do processo
+    bool preencher = false; // MAP_POPULATE / MADV_POPULATE_WRITE
+    bool travar = false;    // mlock
+};
+
+// Primeiro ponto de montagem hugetlbfs (/proc/mounts); vazio se não houver.
+inline std::string montagemHugetlbfs() {
+    std::string caminho;
+    FILE* f = setmntent("/proc/mounts", "r");
+    if (!f) return caminho;
+    while (mntent* m = getmntent(f)) {
+        if (std::strcmp(m->mnt_type, "hugetlbfs") == 0) {
+            caminho = m->mnt_dir;
+            break;
+        }
+    }
+    endmntent(f);
+    return caminho;
+}
+
+class SegmentoCompartilhado {
+public:
+    SegmentoCompartilhado() = default;
+    SegmentoCompartilhado(const SegmentoCompartilhado&) = delete;
+    SegmentoCompartilhado& operator=(const SegmentoCompartilhado&) = delete;
+    ~SegmentoCompartilhado() { fechar(); }
+
+    // Cria (ou recria do zero) um segmento com pelo menos `tamanho` bytes
+    // zerados (arredondado para a página enorme com Enormes/Transparentes).
+    bool criar(const std::string& nome, size_t tamanho, const OpcoesSegmento& opcoes = {}) {
+        fechar();
+        nome_ = nome;
+        caminhoEnorme_.clear();
+        // Descarta sobras de uma execução anterior, em qualquer dos dois lugares
+        shm_unlink(nome.c_str());
+        const std::string montagem = montagemHugetlbfs();
+        if (!montagem.empty()) unlink((montagem + nome).c_str());
+
+        int fd;
+        if (opcoes.paginas == OpcoesSegmento::Paginas::Enormes) {
+            if (montagem.empty()) {
+                errno = ENOENT; // nenhum hugetlbfs montado
+                return false;
+            }
+            caminhoEnorme_ = montagem + nome;
+            fd = open(caminhoEnorme_.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+            struct statfs fs{};
+            if (fd >= 0 && fstatfs(fd, &fs) == 0) tamanho = arredondar(tamanho, (size_t)fs.f_bsize);
+        } else {
+            fd = shm_open(nome.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (opcoes.paginas == OpcoesSegmento::Paginas::Transparentes) {
+                tamanho = arredondar(tamanho, TAM_PAGINA_ENORME_THP);
+            }
+        }
+        if (fd < 0) return false;
+        if (ftruncate(fd, (off_t)tamanho) != 0) {
+            int erro = errno;
+            close(fd);
+            remover();
+            errno = erro;
+            return false;
+        }
+        if (mapear(fd, tamanho, opcoes, true)) return true;
+        int erro = errno;
+        remover();
+        errno = erro;
+        return false;
+    }
+
+    // Abre um segmento já criado; o tamanho vem do próprio objeto (fstat).
+    // Um segmento em hugetlbfs é achado pelo mesmo nome. Só preencher e
+    // travar se aplicam aqui: as páginas já foram postas pelo criador.
+    bool abrir(const std::string& nome, const OpcoesSegmento& opcoes = {}) {
+        fechar();
+        nome_ = nome;
+        caminhoEnorme_.clear();
+        int fd = shm_open(nome.c_str(), O_RDWR, 0);
+        if (fd < 0 && errno == ENOENT) {
+            const std::string montagem = montagemHugetlbfs();
+            if (!montagem.empty()) {
+                fd = open((montagem + nome).c_str(), O_RDWR | O_CLOEXEC);
+                if (fd >= 0) caminhoEnorme_ = montagem + nome;
+            }
+            if (fd < 0) errno = ENOENT;
+        }
+        if (fd < 0) return false;
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            int erro = errno;
+            close(fd);
+            errno = erro;
+            return false;
+        }
+        return mapear(fd, (size_t)st.st_size, opcoes, false);
+    }
+
+    // Remove o nome do segmento; quem já mapeou continua com acesso.
+    void remover() {
+        if (!caminhoEnorme_.empty()) unlink(caminhoEnorme_.c_str());
+        else if (!nome_.empty()) shm_unlink(nome_.c_str());
+    }
+
+    void fechar() {
+        if (base_) munmap(base_, tamanho_);
+        base_ = nullptr;
+        tamanho_ = 0;
+    }
+
+    void* base() const { return base_; }
+    size_t tamanho() const { return tamanho_; }
+    bool emHugetlbfs() const { return !caminhoEnorme_.empty(); }
+
+private:
+    static size_t arredondar(size_t n, size_t passo) { return (n + passo - 1) / passo * passo; }
+
+    bool mapear(int fd, size_t tamanho, const OpcoesSegmento& opcoes, bool criando) {
+        // Com nó NUMA, as páginas só podem ser tocadas depois do mbind
+        const bool posicionar = criando && opcoes.noNuma >= 0;
+        const int flags = MAP_SHARED | (opcoes.preencher && !posicionar ? MAP_POPULATE : 0);
+        void* p = mmap(nullptr, tamanho, PROT_READ | PROT_WRITE, flags, fd, 0);
+        int erro = errno;
+        close(fd); // o mapeamento mantém o objeto vivo
+        if (p == MAP_FAILED) {
+            errno = erro;
+            return false;
+        }
+        base_ = p;
+        tamanho_ = tamanho;
+
+        if (criando && opcoes.paginas == OpcoesSegmento::Paginas::Transparentes) {
+            madvise(p, tamanho, MADV_HUGEPAGE); // só uma dica
+        }
+        bool ok = true;
+        if (posicionar) {
+            unsigned long mascara[4] = {};
+            const unsigned no = (unsigned)opcoes.noNuma;
+            if (no >= sizeof(mascara) * 8) {
+                errno = EINVAL;
+                ok = false;
+            } else {
+                mascara[no / (8 * sizeof(long))] = 1ul << (no % (8 * sizeof(long)));
+                ok = syscall(SYS_mbind, p, tamanho, MPOL_BIND, mascara, sizeof(mascara) * 8 + 1, 0) == 0;
+            }
+            if (ok && opcoes.preencher) ok = preencherPaginas(p, tamanho);
+        }
+        if (ok && opcoes.travar) ok = mlock(p, tamanho) == 0;
+        if (!ok) {
+            erro = errno;
+            fechar();
+            errno = erro;
+        }
+        return ok;
+    }
+
+    // Aloca todas as páginas sem esperar o primeiro acesso; em kernels sem
+    // MADV_POPULATE_WRITE, toca uma vez cada página (o conteúdo é zero).
+    static bool preencherPaginas(void* p, size_t tamanho) {
+        if (madvise(p, tamanho, MADV_POPULATE_WRITE) == 0) return true;
+        if (errno != EINVAL) return false;
+        const size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+        volatile char* c = (volatile char*)p;
+        for (size_t i = 0; i < tamanho; i += pagina) c[i] = 0;
+        return true;
+    }
+
+    std::string nome_;
+    std::string caminhoEnorme_; // arquivo em hugetlbfs; vazio = /dev/shm
+    void* base_ = nullptr;
+    size_t tamanho_ = 0;
+};
@@ -0,0 +1,109 @@
+// -----------------------------------------------------------------------------
+// teste_anel.cpp — regressão do AnelSPSC com política Bloquear.
+//
+// Registros maiores que metade do anel que não cabem contíguos no fim
+// precisam do pulo mais o registro, e a soma passa da capacidade: o produtor
+// não pode esperar por ela. Roda a sequência que travava num anel de 1024:
+// 596 e 396 bytes, lê o primeiro, 296 (pula o fim) e 796, que precisa pular
+// 724 bytes com só 300 livres; depois tamanhos aleatórios até maiorMensagem(),
+// conferindo o conteúdo no consumidor. Um vigia encerra com código 1 se nada
+// andar em 5 s. Falhas saem com _Exit: o outro lado pode estar estacionado no
+// anel e nunca chegaria a um join.
+//
+// Compilação:
+//   g++ -std=c++17 -O2 -Wall -pthread backend/shared_memory/teste_anel.cpp -o backend/shared_memory/teste_anel
+// -----------------------------------------------------------------------------
+#include "anel_spsc.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::string registro(size_t n, uint32_t seq) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; ++i) s[i] = (char)(seq * 31 + i);
+    return s;
+}
+
+int main() {
+    constexpr size_t CAPACIDADE = 1024;
+    constexpr uint32_t ALEATORIOS = 20000;
+
+    void* mem = std::aligned_alloc(64, AnelSPSC::tamanhoNecessario(CAPACIDADE));
+    AnelSPSC produtor, consumidor;
+    if (!mem || !produtor.inicializar(mem, CAPACIDADE, PoliticaCheio::Bloquear) || !consumidor.anexar(mem)) {
+        std::fprintf(stderr, "[teste_anel] falha ao criar o anel\n");
+        return 1;
+    }
+
+    std::vector<size_t> tamanhos = {596, 396, 296, 796};
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<size_t> dist(0, produtor.maiorMensagem());
+    for (uint32_t i = 0; i < ALEATORIOS; ++i) tamanhos.push_back(dist(rng));
+
+    // Prefixo determinístico, sem o thread consumidor: 300 bytes livres no fim
+    std::string r;
+    for (uint32_t seq = 0; seq < 2; ++seq) {
+        r = registro(tamanhos[seq], seq);
+        produtor.escrever(r.data(), r.size());
+    }
+    if (!consumidor.tentarLer(r) || r != registro(tamanhos[0], 0)) {
+        std::fprintf(stderr, "[teste_anel] primeiro registro não confere\n");
+        return 1;
+    }
+    r = registro(tamanhos[2], 2);
+    produtor.escrever(r.data(), r.size());
+
+    std::atomic<uint32_t> progresso{1};
+
+    // Atrasado: o 796 precisa esperar o consumidor
+    std::thread leitor([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        std::string r;
+        for (uint32_t seq = 1; seq < tamanhos.size(); ++seq) {
+            while (!consumidor.tentarLer(r)) consumidor.aguardarDados();
+            if (r != registro(tamanhos[seq], seq)) {
+                std::fprintf(stderr, "[teste_anel] registro %u corrompido (%zu bytes, esperado %zu)\n",
+                             seq, r.size(), tamanhos[seq]);
+                std::_Exit(1);
+            }
+            progresso.store(seq + 1, std::memory_order_relaxed);
+        }
+    });
+
+    std::thread vigia([&] {
+        uint32_t visto = 0;
+        auto ultimo = std::chrono::steady_clock::now();
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            const uint32_t agora = progresso.load(std::memory_order_relaxed);
+            if (agora == tamanhos.size()) return;
+            if (agora != visto) {
+                visto = agora;
+                ultimo = std::chrono::steady_clock::now();
+            } else if (std::chrono::steady_clock::now() - ultimo > std::chrono::seconds(5)) {
+                std::fprintf(stderr, "[teste_anel] travou no registro %u (%zu bytes)\n", agora, tamanhos[agora]);
+                std::_Exit(1);
+            }
+        }
+    });
+
+    for (uint32_t seq = 3; seq < tamanhos.size(); ++seq) {
+        const std::string r = registro(tamanhos[seq], seq);
+        if (!produtor.escrever(r.data(), r.size())) {
+            std::perror("[teste_anel] escrever");
+            std::_Exit(1);
+        }
+    }
+    leitor.join();
+    vigia.join();
+    std::free(mem);
+
+    std::printf("[teste_anel] OK: %zu registros\n", tamanhos.size());
+    return 0;
+}
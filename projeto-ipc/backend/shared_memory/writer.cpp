@@ -1,134 +1,189 @@
-#include <windows.h>
 #include <iostream>
 #include <string>
-#include <chrono>
-#include <iomanip>
-#include <sstream>
-#include <ctime>
+#include <cerrno>
+#include <cstdlib>
+#include "segmento.h"
+#include "anel_spsc.h"
+#include "anel_difusao.h"
+#include "arena.h"
+#include "../common/log.h"
+#include "../common/metricas.h"
+#include "../common/mensagem.h"
 
-//Definições sobre a memória compartilhada e o mutex
-const wchar_t* NOME_MEMORIA = L"MinhaMemoria";
-const wchar_t* NOME_MUTEX   = L"MeuMutex";
-const int TAM_MEMORIA = 256;
+// Definições sobre a memória compartilhada
+const char* NOME_MEMORIA = "/MinhaMemoria";
+const size_t CAPACIDADE_ANEL = 1 << 20; // padrão: 1 MiB de registros em trânsito
+const size_t SLOTS_DIFUSAO = 4096;       // mensagens retidas no modo difusão
+const size_t TAM_SLOT_DIFUSAO = 1024;    // maior mensagem no modo difusão
 
-// Estrtura de dados que serão armazenados na memória compartilhada
-struct DadosCompartilhados {
-    wchar_t mensagem[TAM_MEMORIA]; //buffer da mensagem
-    bool encerrar_flag; //flag para sinalizar encerramento
-};
-// Função para gerar timestamp em formato ISO 8601
-std::string getTimestamp() {
-    using namespace std::chrono;
-    auto now = system_clock::now();
-    std::time_t now_time = system_clock::to_time_t(now);
-    std::tm* utc_tm = std::gmtime(&now_time);  // padrão C
-    std::ostringstream oss;
-    oss << std::put_time(utc_tm, "%Y-%m-%dT%H:%M:%SZ");
-    return oss.str();
-}
-
-// Logger em JSON para formatar as mensagens de log, para a comunicação com o frontend
-void logger(const std::wstring& level, const std::wstring& event,
-            const std::wstring& msg, int bytes, const std::wstring& peer) {
-    std::wcout << L"{\n"
-               << L"  \"module\": \"ipc\",\n"
-               << L"  \"role\": \"writer\",\n"
-               << L"  \"level\": \"" << level << L"\",\n"
-               << L"  \"event\": \"" << event << L"\",\n"
-               << L"  \"ts\": \"" << getTimestamp().c_str() << L"\",\n"
-               << L"  \"details\": {\n"
-               << L"    \"msg\": \"" << msg << L"\",\n"
-               << L"    \"bytes\": " << bytes << L",\n"
-               << L"    \"peer\": \"" << peer << L"\"\n"
-               << L"  }\n"
-               << L"}" << std::endl;
-}
+int main(int argc, char* argv[]) {
+    iniciarLog("ipc", "writer");
+    iniciarMetricas("ipc", "writer");
+    /* Modos (opcionais):
+    --difusao      um writer para vários readers; cada reader recebe todas as mensagens
+    --sobrescrever (com --difusao) não espera readers lentos; eles são avisados das perdas
+    --binario      publica mensagens binárias (common/mensagem.h) com número de
+                   sequência e instante de envio, em vez do texto puro
+    --capacidade=N bytes de dados do anel SPSC (potência de 2; padrão 1 MiB)
+    --cheio=bloquear|girar|descartar|falhar
+                   o que fazer com o anel SPSC cheio: estacionar até o reader
+                   liberar espaço (padrão), girar sem dormir, descartar as
+                   mensagens mais antigas ou recusar a nova (ver anel_spsc.h)
+    --arena=N      (sem --difusao) arena de N bytes depois do anel: cada linha é
+                   copiada para a arena e pelo anel passa só o deslocamento
+    --paginas=enormes|thp  hugetlbfs (vm.nr_hugepages) ou THP em /dev/shm
+    --numa=N       páginas do segmento no nó NUMA N (mbind)
+    --preencher    aloca todas as páginas na criação (sem faltas no caminho dos dados)
+    --travar       mlock do segmento (RLIMIT_MEMLOCK)
+    Sem opções, usa o anel SPSC (um único reader). */
+    bool difusao = false;
+    bool sobrescrever = false;
+    bool binario = false;
+    size_t capacidade = CAPACIDADE_ANEL;
+    size_t bytesArena = 0;
+    PoliticaCheio cheio = PoliticaCheio::Bloquear;
+    OpcoesSegmento opcoes;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--difusao") difusao = true;
+        else if (arg == "--sobrescrever") sobrescrever = true;
+        else if (arg == "--binario") binario = true;
+        else if (arg.rfind("--capacidade=", 0) == 0) capacidade = std::strtoull(arg.c_str() + 13, nullptr, 10);
+        else if (arg == "--cheio=bloquear") cheio = PoliticaCheio::Bloquear;
+        else if (arg == "--cheio=girar") cheio = PoliticaCheio::Girar;
+        else if (arg == "--cheio=descartar") cheio = PoliticaCheio::DescartarAntigas;
+        else if (arg == "--cheio=falhar") cheio = PoliticaCheio::Falhar;
+        else if (arg.rfind("--arena=", 0) == 0) bytesArena = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg == "--paginas=enormes") opcoes.paginas = OpcoesSegmento::Paginas::Enormes;
+        else if (arg == "--paginas=thp") opcoes.paginas = OpcoesSegmento::Paginas::Transparentes;
+        else if (arg.rfind("--numa=", 0) == 0) opcoes.noNuma = std::atoi(arg.c_str() + 7);
+        else if (arg == "--preencher") opcoes.preencher = true;
+        else if (arg == "--travar") opcoes.travar = true;
+    }
 
-int main() {
-    /*Cria memória compartilhada
-    cria um handle (idenrificador para o SO) para a memória compartilhada
-    - INVALID_HANDLE_VALUE: memória do sistema (RAM)
-    - PAGE_READWRITE: permite leitura e escrita
-    - NOME_MEMORIA: permite que outros processos a localizem
-    - sizeof(DadosCompartilhados): tamanho da memória */
-    HANDLE hMapFile = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(DadosCompartilhados), NOME_MEMORIA);
-    // Verifica se o handle é valido, se a memória foi criada com sucesso
-    if (!hMapFile) {
-        logger(L"error", L"criando memória", L"Erro ao criar memória compartilhada", GetLastError(), L"system");
+    /*Cria memória compartilhada (POSIX)
+    - shm_open + ftruncate: objeto em /dev/shm com o tamanho do anel (ou um
+      arquivo em hugetlbfs, com --paginas=enormes; ver segmento.h)
+    - mmap(MAP_SHARED): mapeia o objeto no espaço de endereços do processo
+    - NOME_MEMORIA: permite que o reader localize o segmento */
+    SegmentoCompartilhado segmento;
+    // Na difusão cada reader teria que liberar a mesma linha; descartando, a
+    // linha de um registro descartado nunca seria liberada
+    if (difusao || cheio == PoliticaCheio::DescartarAntigas) bytesArena = 0;
+    const size_t tamanhoAnel = AnelSPSC::tamanhoNecessario(capacidade);
+    const size_t tamanho = difusao ? AnelDifusao::tamanhoNecessario(SLOTS_DIFUSAO, TAM_SLOT_DIFUSAO)
+        : tamanhoAnel + (bytesArena ? ArenaCompartilhada::tamanhoNecessario(bytesArena) : 0);
+    if (!segmento.criar(NOME_MEMORIA, tamanho, opcoes)) {
+        logger(NivelLog::Error, "criando memória", "Erro ao criar memória compartilhada", errno, "system");
         return 1;
     }
 
-    /*Mapeia a memória compartilhada para o espaço de endereço do processo
-    cria um ponteiro do tipo DadosCompartilhados que aponta para a memoria compartilhada (pontMem)
-    - hMapFile: handle da memória compartilhada criada acima
-    - FILE_MAP_ALL_ACCESS: acesso de leitura e escrita
-    - 0 (dwFileOffsetHigh) e 0 (dwFileOffsetLow): começa a mapear do início da memória
-    - sizeof(SharedData): quantidade de bytes que serão mapeados*/
-    DadosCompartilhados* pontMem = (DadosCompartilhados*)MapViewOfFile(hMapFile, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(DadosCompartilhados));
-    // Verifica se o o ponteiro que a aponta para a memória é valido, se a memória foi mapeada com sucesso
-    if (!pontMem) {
-        logger(L"error", L"mapeando memória", L"Erro ao mapear memória", GetLastError(), L"system");
-        CloseHandle(hMapFile); //Fecha o handle da memória compartilhada
+    /* Inicializa o anel SPSC dentro do segmento. Não há mutex: o writer é o
+    único produtor e o reader o único consumidor, e cada um só escreve no seu
+    próprio índice (escrita/leitura). No modo difusão, cada reader tem seu
+    cursor no segmento e o writer acompanha o mais lento. */
+    AnelSPSC anel;
+    AnelDifusao anelDifusao;
+    const bool inicializado = difusao
+        ? anelDifusao.inicializar(segmento.base(), SLOTS_DIFUSAO, TAM_SLOT_DIFUSAO,
+                                  sobrescrever ? AnelDifusao::Modo::Sobrescrever
+                                               : AnelDifusao::Modo::Bloquear)
+        : anel.inicializar(segmento.base(), capacidade, cheio);
+    if (!inicializado) {
+        logger(NivelLog::Error, "inicializando anel", "Erro ao inicializar o anel", 0, "system");
+        segmento.remover();
         return 1;
     }
-
-    /* Cria mutex para sincronização, apenas um processo acesse a região crítica (memória compartilhada) por vez.
-    - nullptr = usa atributos de segurança padrão
-    - FALSE = o mutex não é adquirido imediatamente pelo processo que o cria
-    - NOME_MUTEX = nome do mutex, permitindo que outros processos abram o mesmo mutex */
-    HANDLE hMutex = CreateMutexW(nullptr, FALSE, NOME_MUTEX);
-    // Verifica se o handle é valido, se o mutex foi criada com sucesso
-    if (!hMutex) {
-        logger(L"error", L"criando mutex", L"Erro ao criar Mutex", GetLastError(), L"system");
-        UnmapViewOfFile(pontMem); // Desmapeia a memória
-        CloseHandle(hMapFile);
+    // A arena fica logo depois do anel; o reader a acha pelo mesmo cálculo
+    ArenaCompartilhada arena;
+    if (bytesArena && !arena.inicializar((char*)segmento.base() + tamanhoAnel, segmento.tamanho() - tamanhoAnel)) {
+        logger(NivelLog::Error, "inicializando arena", "Erro ao inicializar a arena", 0, "system");
+        segmento.remover();
         return 1;
     }
     //Mensagem inicial para o usuário
-    std::wcout << L"Writer iniciado...\nDigite mensagens. Digite 'sair' para encerrar.\n";
+    logTexto("Writer iniciado...\nDigite mensagens. Digite 'sair' para encerrar.");
     //Variável para armazenar a entrada do usuário
-    std::wstring input;
+    std::string input;
+    std::string registro; // mensagem binária (--binario), reaproveitada
+    uint64_t seq = 0;
 
-    while (true) {
-        std::getline(std::wcin, input); // lê uma linha do teclado e armazena na variável input, preservando caracteres Unicode.
-
-        /* Espera para adquirir mutex antes de escrever na memória compartilhada
-        WaitForSingleObject bloqueia o processo até que o mutex esteja disponível
-        INFINITE = espera indefinidamente*/
-        DWORD dwWait = WaitForSingleObject(hMutex, INFINITE);
-        // Verifica se o mutex foi adiquirido com sucerro
-        if (dwWait != WAIT_OBJECT_0) { //waitforSingleObject retornou WAIT_OBJECT_0 (quer dizer que foi adiquirido)
-            logger(L"error", L"esperando pelo mutex", L"Falha ao esperar pelo Mutex", GetLastError(), L"system");
-            break;
-        }
+    while (std::getline(std::cin, input)) { // lê uma linha (UTF-8) da entrada padrão
 
         // Verifica se usuário digitou "sair" para encerrar
-        if (input == L"sair") {
-            pontMem->encerrar_flag = true; // defini a flag de encerramento como verdadeira para poder encerrar o reader
-            //Loggers com as informações sobre o encerramento e do mutex
-            logger(L"info", L"mutex adiquiro", L"Escrita protegida por mutex", 0, L"system");
-            logger(L"info", L"encerrar", L"Encerramento Solicitado", 0, L"shared_memory");
-            logger(L"info", L"mutex liberado", L"Writer liberou o mutex", 0, L"system");
-            ReleaseMutex(hMutex); // libera mutex antes de sair do loop
+        if (input == "sair") {
             break;
         }
-        // Se a entrada não estiver vazia, escreve na memória compartilhada
+        // Se a entrada não estiver vazia, publica um registro no anel
         if (!input.empty()) {
-            // escreve mensagem na memória compartilhada
-            wcsncpy(pontMem->mensagem, input.c_str(), TAM_MEMORIA - 1); //copia a entrada para o buffer message do ponteiro sharedMem, até TAM_MEMORIA - 1 
-            pontMem->mensagem[TAM_MEMORIA - 1] = L'\0'; //O último caractere é colocado como '\0'
-            //Logger com as informaÇões da mensagem e do mutex
-            logger(L"info", L"mutex adiquirido", L"Escrita protegida por mutex", 0, L"system");
-            logger(L"info", L"Escrita", input, input.size(), L"shared_memory");
-            logger(L"info", L"mutex liberado", L"Writer liberou o mutex", 0, L"system");
+            const int64_t inicio = monotonicoNs();
+            std::string_view dados = input;
+            if (bytesArena) {
+                // O texto vai para a arena; o reader o lê lá e libera o bloco
+                const uint64_t referencia = copiarTexto(arena, input);
+                if (!referencia) {
+                    logger(NivelLog::Error, "Escrita", "Arena esgotada", input.size(), "shared_memory");
+                    contarMetrica(Contador::Erros);
+                    continue;
+                }
+                registro.clear();
+                EscritorMensagem m(registro, TipoMensagem::Evento);
+                m.u64(Campo::Referencia, referencia).u64(Campo::Seq, ++seq).i64(Campo::EnviadoEm, inicio);
+                m.fechar();
+                dados = registro;
+            } else if (binario) {
+                registro.clear();
+                EscritorMensagem m(registro, TipoMensagem::Evento);
+                m.texto(Campo::Texto, input).u64(Campo::Seq, ++seq).i64(Campo::EnviadoEm, inicio);
+                m.fechar();
+                dados = registro;
+            }
+            if (difusao) {
+                // Bloqueia no reader mais lento (ou sobrescreve, com --sobrescrever)
+                if (!anelDifusao.publicar(dados.data(), dados.size())) {
+                    logger(NivelLog::Error, "Escrita", "Mensagem maior que o slot", dados.size(), "shared_memory");
+                    contarMetrica(Contador::Erros);
+                    continue;
+                }
+                medirLatencia(Latencia::Envio, monotonicoNs() - inicio);
+                contarMetrica(Contador::MensagensEnviadas);
+                contarMetrica(Contador::BytesEnviados, dados.size());
+                logger(NivelLog::Info, "Escrita", input, dados.size(), "shared_memory");
+                continue;
+            }
+            if (dados.size() > anel.maiorMensagem()) {
+                logger(NivelLog::Error, "Escrita", "Mensagem maior que o anel", dados.size(), "shared_memory");
+                contarMetrica(Contador::Erros);
+                continue;
+            }
+            /* Anel cheio: a política escolhida em --cheio decide (esperar o
+            reader, descartar as mais antigas ou recusar esta). */
+            if (!anel.tentarEscrever(dados.data(), dados.size())) {
+                if (!anel.escrever(dados.data(), dados.size())) {
+                    logger(NivelLog::Warn, "Recusada", "Anel cheio", (int64_t)anel.creditos(), "shared_memory");
+                    contarMetrica(Contador::Erros);
+                    continue;
+                }
+                medirLatencia(Latencia::Espera, monotonicoNs() - inicio);
+            }
+            medirLatencia(Latencia::Envio, monotonicoNs() - inicio);
+            contarMetrica(Contador::MensagensEnviadas);
+            contarMetrica(Contador::BytesEnviados, dados.size());
+            logger(NivelLog::Info, "Escrita", input, dados.size(), "shared_memory");
         }
+    }
 
-        ReleaseMutex(hMutex); // libera mutex para o reader
+    // Defini a flag de encerramento depois da última publicação, assim o reader
+    // ainda drena tudo o que já está no anel antes de sair
+    if (difusao) anelDifusao.sinalizarEncerramento();
+    else anel.sinalizarEncerramento();
+    if (!difusao && (anel.descartadas() || anel.recusadas())) {
+        logger(NivelLog::Warn, "Fluxo", std::to_string(anel.descartadas()) + " descartadas, " +
+               std::to_string(anel.recusadas()) + " recusadas com o anel cheio", 0, "shared_memory");
     }
+    logger(NivelLog::Info, "encerrar", "Encerramento Solicitado", 0, "shared_memory");
 
-    // Lopp encerrado, desmapeia a memoria e fecha os handles da memória e do mutex
-    UnmapViewOfFile(pontMem);
-    CloseHandle(hMapFile);
-    CloseHandle(hMutex);
+    // Loop encerrado: remove o nome do segmento (o reader mantém seu mapeamento)
+    segmento.remover();
     return 0;
 }
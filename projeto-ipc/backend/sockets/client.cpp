@@ -1,176 +1,402 @@
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <string>
-#include <chrono>
-#include <iomanip>
-#include <sstream>
-#include <ctime>
-#pragma comment(lib, "Ws2_32.lib")
+#include <cstdlib>
+#include <vector>
+#include "protocolo.h"
+#include "cliente_async.h"
+#include "pool_conexoes.h"
+#include "zerocopia.h"
+#include "transporte.h"
+#include "../common/log.h"
+#include "../common/relogio.h"
+#include "../common/metricas.h"
+#include "../common/mensagem.h"
+#include <deque>
 
-std::string getTimestamp() {
-    // Get the current calendar time as a time_t object
-    time_t currentTime = time(NULL); 
+// Endereço do servidor, como aparece no campo "peer" dos logs
+std::string peerServidor = "[::1]:8080";
 
-    // Convert the time_t object to a human-readable string (local time)
-    char* dateTimeString = ctime(&currentTime);
+// --binario: comandos vão como mensagens binárias (common/mensagem.h), com o
+// instante de envio num campo próprio
+bool mensagensBinarias = false;
 
-    return std::string(dateTimeString);
+// Acrescenta em `saida` o payload de um comando, em texto ou binário
+void codificarCarga(std::string& saida, std::string_view comando) {
+    if (!mensagensBinarias) {
+        saida.append(comando.data(), comando.size());
+        return;
+    }
+    EscritorMensagem m(saida, TipoMensagem::Comando);
+    m.texto(Campo::Texto, comando).i64(Campo::EnviadoEm, monotonicoNs());
+    m.fechar();
 }
 
-// Logger JSON
-void logger(const std::string& level, const std::string& event, const std::string& ts,
-            const std::string& msg, int bytes, const std::string& peer) {
-    std::cout << "{\n"
-              << "  \"module\": \"sockets\",\n"
-              << "  \"role\": \"client\",\n"
-              << "  \"level\": \"" << level << "\",\n"
-              << "  \"event\": \"" << event << "\",\n"
-              << "  \"ts\": \"" << ts << "\",\n"
-              << "  \"details\": {\n"
-              << "    \"msg\": \"" << msg << "\",\n"
-              << "    \"bytes\": " << bytes << ",\n"
-              << "    \"peer\": \"" << peer << "\"\n"
-              << "  }\n"
-              << "}" << std::endl;
+// Texto de uma resposta; as binárias são lidas no lugar, sem cópia
+std::string_view textoResposta(std::string_view payload) {
+    VisaoMensagem v;
+    if (pareceMensagem(payload) && v.abrir(payload.data(), payload.size())) return v.texto(Campo::Texto);
+    return payload;
 }
 
-int main() {
-    WSADATA wsa;
-
-    // WSAStartup inicializa a DLL do Winsock no Windows (obrigatório).
-    // MAKEWORD(2,2) pede a versão 2.2 da API. Se retornar != 0, houve falha.
-    // Em caso de erro, imprimimos mensagem, registramos no logger e encerramos.
-    if (WSAStartup(MAKEWORD(2,2), &wsa) != 0) {
-        std::cerr << "[ERRO] WSAStartup: " << WSAGetLastError() << "\n";
-        // logger() e getTimestamp() são utilitários do seu projeto:
-        // - logger(nível, função, timestamp, mensagem, bytes, peer)
-        // - getTimestamp() retorna o horário atual como string.
-        // Aqui registramos o erro sem bytes/peer (0 e "N/A").
-        logger("ERROR", "WSAStartup", getTimestamp(), "WSAStartup failed", 0, "N/A");
-        return 1;
+// -----------------------------------------------------------------------------
+// Recebe o corpo de um bloco (resposta de "arquivo <caminho>") direto no
+// destino final: o arquivo de --saida, mapeado em memória, ou um buffer em
+// memória quando não há --saida. Mede a vazão da transferência.
+// -----------------------------------------------------------------------------
+bool receberBloco(int fd, DecodificadorQuadros& entrada, uint32_t tamanho, const std::string& destino) {
+    const int64_t inicio = monotonicoNs();
+    bool ok;
+    if (!destino.empty()) {
+        int saida = open(destino.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (saida < 0 || ftruncate(saida, tamanho) != 0) {
+            std::cerr << "[ERRO] " << destino << ": " << strerror(errno) << "\n";
+            if (saida >= 0) close(saida);
+            return false;
+        }
+        char* mapa = nullptr;
+        if (tamanho > 0) {
+            void* p = mmap(nullptr, tamanho, PROT_READ | PROT_WRITE, MAP_SHARED, saida, 0);
+            if (p == MAP_FAILED) {
+                std::cerr << "[ERRO] mmap: " << strerror(errno) << "\n";
+                close(saida);
+                return false;
+            }
+            mapa = (char*)p;
+        }
+        ok = receberCorpo(fd, entrada, mapa, tamanho);
+        if (mapa) munmap(mapa, tamanho);
+        close(saida);
     } else {
-        // Log de sucesso para auditoria/diagnóstico.
-        logger("INFO", "WSAStartup", getTimestamp(), "WSAStartup successful", 0, "N/A");
+        std::vector<char> buffer(tamanho);
+        ok = receberCorpo(fd, entrada, buffer.data(), tamanho);
     }
+    if (!ok) return false;
+
+    double segundos = segundosEntre(inicio, monotonicoNs());
+    std::string resumo = "Bloco recebido: " + std::to_string(tamanho) + " bytes em " +
+                         std::to_string(segundos) + " s (" +
+                         std::to_string((uint64_t)(tamanho / (segundos > 0 ? segundos : 1e-9) / 1e6)) + " MB/s)";
+    logTexto(resumo);
+    logger(NivelLog::Info, "recv", resumo, (int)tamanho, peerServidor);
+    return true;
+}
 
-    // Criação do socket do cliente:
-    // - AF_INET6: IPv6
-    // - SOCK_STREAM: TCP (fluxo orientado à conexão)
-    // - protocolo = 0: usa o padrão para STREAM em IPv6 (TCP)
-    // Se retornar INVALID_SOCKET, a criação falhou.
-    SOCKET clientSocket = socket(AF_INET6, SOCK_STREAM, 0);
-    if (clientSocket == INVALID_SOCKET) {
-        std::cerr << "[ERRO] socket: " << WSAGetLastError() << "\n";
-        logger("ERROR", "socket", getTimestamp(), "Socket creation failed", 0, "N/A");
-        WSACleanup();
+// -----------------------------------------------------------------------------
+// Modo pipeline (client --pipeline=N [--total=M]): dispara M pings mantendo até
+// N pedidos em voo na mesma conexão e mede a vazão. Sem esperar cada resposta,
+// a taxa deixa de ser limitada pela latência de ida e volta. --comando=<texto>
+// troca o ping (ex.: "primos 1000000", que o servidor roda no pool).
+// -----------------------------------------------------------------------------
+int modoPipeline(const Endereco& endereco, size_t janela, uint64_t total, const std::string& comando) {
+    ClientePipeline cli(janela);
+    if (!cli.conectar((const sockaddr*)&endereco.addr, endereco.len, endereco.tipo)) {
+        std::cerr << "[ERRO] connect: " << strerror(errno) << "\n";
+        logger(NivelLog::Error, "connect", "Connect failed", 0, peerServidor);
+        return 1;
+    }
+    logger(NivelLog::Info, "connect", "Connected to server (pipeline)", 0, peerServidor);
+
+    uint64_t enviados = 0, respondidos = 0, falhas = 0;
+    auto aoResponder = [&](bool ok, std::string_view) {
+        if (ok) ++respondidos;
+        else ++falhas;
+    };
+
+    std::string carga; // reaproveitada: só muda o instante de envio
+    const int64_t inicio = monotonicoNs();
+    while (respondidos + falhas < total) {
+        // Completa a janela e deixa processar() enviar tudo num único send
+        while (enviados < total) {
+            carga.clear();
+            codificarCarga(carga, comando);
+            if (!cli.tentarEnviar(carga, aoResponder)) break;
+            ++enviados;
+        }
+        if (cli.processar(1000) < 0 && !cli.conectado()) {
+            falhas += total - enviados; // o que nem chegou a ser enviado
+            break;
+        }
+    }
+    double segundos = segundosEntre(inicio, monotonicoNs());
+
+    std::string resumo = std::to_string(respondidos) + " respostas em " + std::to_string(segundos) +
+                         " s (" + std::to_string((uint64_t)(respondidos / segundos)) + " req/s, janela " +
+                         std::to_string(janela) + ")";
+    logTexto(resumo);
+    logger(falhas ? NivelLog::Error : NivelLog::Info, "pipeline", resumo, 0, peerServidor);
+    return falhas ? 1 : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Modo pedidos curtos (client --curtos=M [--conexoes=N] [--sem-reuso]): M
+// pedidos, um de cada vez, cada um esperando a sua resposta, como faz quem só
+// quer mandar um comando. Pelo pool (pool_conexoes.h) até N conexões ficam
+// abertas e são reaproveitadas; com --sem-reuso cada pedido abre e fecha a
+// sua conexão, para comparar o custo de conectar a cada vez.
+// -----------------------------------------------------------------------------
+int modoCurtos(const std::string& uri, const Endereco& endereco, uint64_t total, size_t conexoes, bool reusar,
+               const std::string& comando) {
+    OpcoesPool opcoes;
+    opcoes.maximo = conexoes;
+    PoolConexoes pool(opcoes);
+    std::string carga, resposta;
+    uint64_t respondidos = 0, aberturas = 0;
+    const int64_t inicio = monotonicoNs();
+    for (uint64_t i = 0; i < total; ++i) {
+        carga.clear();
+        codificarCarga(carga, comando);
+        if (!reusar) pool.fechar(); // sem reaproveitar: connect a cada pedido
+        const uint64_t antes = pool.aberturas();
+        if (!pool.pedir(uri, carga, resposta, 5000)) {
+            std::cerr << "[ERRO] pedido " << i << ": " << strerror(errno) << "\n";
+            break;
+        }
+        aberturas += pool.aberturas() - antes;
+        ++respondidos;
+    }
+    const double segundos = segundosEntre(inicio, monotonicoNs());
+
+    std::string resumo = std::to_string(respondidos) + " pedidos curtos em " + std::to_string(segundos) +
+                         " s (" + std::to_string((uint64_t)(respondidos / segundos)) + " req/s, " +
+                         std::to_string(aberturas) + " conexões abertas)";
+    logTexto(resumo);
+    logger(respondidos < total ? NivelLog::Error : NivelLog::Info, "curtos", resumo, 0, endereco.descricao);
+    return respondidos < total ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    iniciarLog("sockets", "client");
+    iniciarMetricas("sockets", "client");
+    size_t janela = 0;
+    uint64_t total = 1000000;
+    uint64_t curtos = 0;       // --curtos=M: pedidos curtos pelo pool de conexões
+    size_t conexoes = 4;       // --conexoes=N: máximo do pool
+    bool reusar = true;        // --sem-reuso: uma conexão por pedido
+    std::string uri = "tcp://[::1]:8080";
+    std::string destinoBloco; // --saida=<arquivo>: onde gravar blocos recebidos
+    std::string comando = "ping"; // --comando=<texto>: pedido do modo pipeline
+    Endereco endereco = enderecoPadrao(); // --endereco=URI (transporte.h)
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--pipeline=", 0) == 0) janela = std::strtoull(arg.c_str() + 11, nullptr, 10);
+        else if (arg.rfind("--total=", 0) == 0) total = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        else if (arg.rfind("--saida=", 0) == 0) destinoBloco = arg.substr(8);
+        else if (arg.rfind("--comando=", 0) == 0) comando = arg.substr(10);
+        else if (arg.rfind("--curtos=", 0) == 0) curtos = std::strtoull(arg.c_str() + 9, nullptr, 10);
+        else if (arg.rfind("--conexoes=", 0) == 0) conexoes = std::strtoull(arg.c_str() + 11, nullptr, 10);
+        else if (arg == "--sem-reuso") reusar = false;
+        else if (arg == "--binario") mensagensBinarias = true;
+        else if (arg.rfind("--endereco=", 0) == 0) {
+            uri = arg.substr(11);
+            if (!resolverEndereco(uri, endereco)) {
+                std::cerr << "[ERRO] endereço inválido: " << uri << "\n";
+                return 1;
+            }
+        }
+    }
+    peerServidor = endereco.descricao;
+    if (janela > 0) return modoPipeline(endereco, janela, total, comando);
+    if (curtos > 0) return modoCurtos(uri, endereco, curtos, conexoes, reusar, comando);
+
+    // Criação do socket do cliente, conforme o endereço (transporte.h):
+    // - AF_INET6 + SOCK_STREAM: TCP (padrão, [::1]:8080)
+    // - AF_UNIX + SOCK_STREAM ou SOCK_SEQPACKET: socket local
+    // - protocolo = 0: usa o padrão da família/tipo
+    // Se retornar -1, a criação falhou.
+    // logger(nível, evento, mensagem, bytes, peer) vem de common/log.h.
+    int clientSocket = socket(endereco.familia, endereco.tipo | SOCK_CLOEXEC, 0);
+    if (clientSocket < 0) {
+        std::cerr << "[ERRO] socket: " << strerror(errno) << "\n";
+        logger(NivelLog::Error, "socket", "Socket creation failed", 0, "N/A");
         return 1;
     } else {
-        logger("INFO", "socket", getTimestamp(), "Socket created successfully", 0, "N/A");
+        logger(NivelLog::Info, "socket", "Socket created successfully", 0, "N/A");
     }
 
-    // Monta o endereço do servidor (IPv6):
-    // sockaddr_in6 é a estrutura padrão para endereços IPv6.
-    // - sin6_family = AF_INET6 (família IPv6)
-    // - sin6_port   = htons(8080) → porta 8080 em ordem de rede (big-endian)
-    // - sin6_addr   = in6addr_loopback → ::1 (localhost). Só conecta na própria máquina.
-    sockaddr_in6 serverAddr{};
-    serverAddr.sin6_family = AF_INET6;
-    serverAddr.sin6_port   = htons(8080);
-    serverAddr.sin6_addr   = in6addr_loopback;
-
-    // connect() inicia o 3-way handshake TCP com o servidor (::1:8080).
-    // Sucesso → 0; erro → SOCKET_ERROR. Em erro, fechamos socket e limpamos Winsock.
-    if (connect(clientSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        std::cerr << "[ERRO] connect: " << WSAGetLastError() << "\n";
-        logger("ERROR", "connect", getTimestamp(), "Connect failed", 0, "[::1]:8080");
-        closesocket(clientSocket);
-        WSACleanup();
+    // connect() no endereço resolvido: em TCP inicia o 3-way handshake com o
+    // servidor (padrão ::1:8080, só na própria máquina); em AF_UNIX conecta ao
+    // caminho ou nome abstrato. Sucesso → 0; erro → -1. Em erro, fechamos o socket.
+    if (connect(clientSocket, (const sockaddr*)&endereco.addr, endereco.len) != 0) {
+        std::cerr << "[ERRO] connect: " << strerror(errno) << "\n";
+        logger(NivelLog::Error, "connect", "Connect failed", 0, peerServidor);
+        close(clientSocket);
         return 1;
     } else {
-        logger("INFO", "connect", getTimestamp(), "Connected to server", 0, "[::1]:8080");
+        logger(NivelLog::Info, "connect", "Connected to server", 0, peerServidor);
     }
 
     // Loop principal de interação:
-    // - Lê uma linha do usuário (std::getline)
-    // - Envia ao servidor (send)
-    // - Aguarda resposta (recv)
-    // - Se a resposta for "Fechando socket...", encerra o cliente (break)
-    while (true)
+    // - Lê uma linha do usuário (std::getline); vários comandos podem ser
+    //   separados por ';' (ex.: "ping;ping;oi") e formam um lote
+    // - Codifica cada comando num quadro (protocolo.h) com seu próprio seq
+    // - Envia o lote inteiro num único send
+    // - Aguarda uma resposta por comando, casando-as pelo seq
+    // - Se alguma resposta for "Fechando socket...", encerra o cliente (break)
+    uint32_t proximoSeq = 1;
+    DecodificadorQuadros entrada;
+    std::deque<int> descritores; // recebidos por SCM_RIGHTS, na ordem de chegada
+    bool encerrar = false;
+    while (!encerrar)
     {
-        // Entrada do usuário: a mensagem será enviada exatamente como digitada,
-        // sem '\0' implícito; o tamanho é message.size().
         std::string message;
-        std::cout << "Digite a mensagem para enviar ao servidor: ";
-        std::getline(std::cin, message);
-
-        // send() envia bytes ao servidor pelo socket TCP.
-        // Retorno: n° de bytes enviados (>0) ou SOCKET_ERROR em falha.
-        // Obs.: Em TCP, send pode enviar menos bytes do que o solicitado em casos de buffers/pressão de rede.
-        // Nas mensagens curtas deste trabalho, isso é raro; o log registra o tamanho informado.
-        int sent = send(clientSocket, message.c_str(), static_cast<int>(message.size()), 0);
-        if (sent == SOCKET_ERROR) {
-            std::cerr << "[ERRO] send: " << WSAGetLastError() << "\n";
-            logger("ERROR", "send", getTimestamp(), "Send failed", 0, "[::1]:8080");
+        logTexto("Digite a mensagem para enviar ao servidor: ", false);
+        descarregarLog(); // o prompt aparece antes de bloquear na leitura
+        if (!std::getline(std::cin, message)) break; // fim da entrada padrão
+
+        // Monta o lote: um quadro por comando, todos no mesmo buffer.
+        std::string lote;
+        size_t comandos = 0;
+        uint32_t primeiroSeq = proximoSeq;
+        size_t pos = 0;
+        while (pos <= message.size()) {
+            size_t fim = message.find(';', pos);
+            if (fim == std::string::npos) fim = message.size();
+            const std::string_view comando(message.data() + pos, fim - pos);
+            if (!comando.empty()) {
+                const size_t quadro = abrirQuadro(lote, TipoQuadro::Comando, proximoSeq++);
+                codificarCarga(lote, comando);
+                fecharQuadro(lote, quadro);
+                ++comandos;
+            }
+            pos = fim + 1;
+        }
+        if (comandos == 0) continue;
+
+        // Envia o lote. Em TCP, send pode aceitar menos bytes do que o pedido,
+        // então repetimos até o buffer inteiro ter sido entregue ao kernel.
+        // Em seqpacket cada send é um registro de no máximo MAIOR_REGISTRO.
+        // MSG_NOSIGNAL: se o servidor já fechou, recebemos EPIPE em vez de SIGPIPE.
+        size_t enviados = 0;
+        const int64_t inicioEnvio = monotonicoNs();
+        while (enviados < lote.size()) {
+            ssize_t sent = send(clientSocket, lote.data() + enviados,
+                                std::min(lote.size() - enviados, endereco.maiorEnvio()), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            enviados += (size_t)sent;
+        }
+        if (enviados < lote.size()) {
+            std::cerr << "[ERRO] send: " << strerror(errno) << "\n";
+            logger(NivelLog::Error, "send", "Send failed", 0, peerServidor);
+            contarMetrica(Contador::Erros);
             break; // sai do loop e finaliza cliente
         } else {
-            // Informamos quantos bytes foram "aceitos" para envio pelo stack TCP.
-            logger("INFO", "send", getTimestamp(), "Message sent to server", sent, "[::1]:8080");
+            medirLatencia(Latencia::Envio, monotonicoNs() - inicioEnvio);
+            contarMetrica(Contador::MensagensEnviadas, comandos);
+            contarMetrica(Contador::BytesEnviados, enviados);
+            // Informamos quantos bytes (todos os quadros do lote) foram enviados.
+            logger(NivelLog::Info, "send", "Message sent to server", (int)enviados, peerServidor);
         }
 
-        // Recebe resposta do servidor.
-        // - buffer2 é zerado só para facilitar leitura/depuração (não é obrigatório).
-        // - recv retorna:
+        // Recebe as respostas. Um recv pode trazer várias respostas ou só um
+        // pedaço de uma; o decodificador guarda o que estiver incompleto.
         //   >0: bytes efetivamente recebidos
         //   0: servidor fechou a conexão de forma ordenada
-        //   SOCKET_ERROR: falha
-        char buffer2[5096] = {0};
-        int bytesReceived = recv(clientSocket, buffer2, sizeof(buffer2), 0);
-        if (bytesReceived == SOCKET_ERROR) {
-            std::cerr << "[ERRO] recv: " << WSAGetLastError() << "\n";
-            logger("ERROR", "recv", getTimestamp(), "Recv failed", 0, "[::1]:8080");
-            break;
-        }
-        if (bytesReceived == 0) {
-            // 0 bytes significa que o peer (servidor) fechou a conexão.
-            std::cout << "[INFO] Servidor fechou a conexão.\n";
-            logger("INFO", "server_closed", getTimestamp(), "Server closed connection", 0, "[::1]:8080");
-            break;
-        }
+        //   -1: falha
+        size_t respondidos = 0;
+        while (respondidos < comandos && !encerrar) {
+            Quadro q;
+            auto estado = entrada.proximo(q);
+            if (estado == DecodificadorQuadros::Estado::Quadro) {
+                if (q.tipo != TipoQuadro::Resposta || q.seq < primeiroSeq || q.seq >= proximoSeq) {
+                    logger(NivelLog::Error, "protocol", "Unexpected frame from server", 0, peerServidor);
+                    encerrar = true;
+                    break;
+                }
+                ++respondidos;
+                // Recebimento = ida e volta, do envio do lote até esta resposta
+                medirLatencia(Latencia::Recebimento, monotonicoNs() - inicioEnvio);
+                contarMetrica(Contador::MensagensRecebidas);
+                const std::string_view resposta = textoResposta(q.payload);
+                logTexto("Mensagem recebida do servidor: ", resposta);
 
-        // Imprime a resposta do servidor. Como zeramos o buffer, cout tende a funcionar;
-        // mas o jeito mais seguro é construir a std::string usando (buffer2, bytesReceived),
-        // o que fazemos logo abaixo.
-        std::cout << "Mensagem recebida do servidor: " << buffer2 << std::endl;
-        logger("INFO", "recv", getTimestamp(), "Message received from server",
-               bytesReceived, "[::1]:8080");
-
-        // Converte bytes → string exatamente com o tamanho recebido (não depende de '\0').
-        std::string mensagemServidor(buffer2, bytesReceived);
-
-        // Protocolo simples: se o servidor mandar "Fechando socket...", encerramos.
-        if (mensagemServidor == "Fechando socket...")
-        {
-            logger("INFO", "server_signal", getTimestamp(),
-                   "Server requested client to close", 0, "[::1]:8080");
-            break;
+                // Resposta de "descritor <caminho>": o arquivo aberto veio junto
+                if (q.flags & FLAG_DESCRITOR) {
+                    if (descritores.empty()) {
+                        logger(NivelLog::Error, "protocol", "Descriptor frame without descriptor", 0, peerServidor);
+                        encerrar = true;
+                        break;
+                    }
+                    int fd = descritores.front();
+                    descritores.pop_front();
+                    struct stat st{};
+                    fstat(fd, &st);
+                    logTexto("Descritor recebido: fd " + std::to_string(fd) + " (" +
+                             std::to_string(st.st_size) + " bytes)");
+                    logger(NivelLog::Info, "recv_fd", "File descriptor received", (int)st.st_size, peerServidor);
+                    close(fd);
+                }
+
+                // Protocolo simples: se o servidor mandar "Fechando socket...", encerramos.
+                if (resposta == "Fechando socket...") {
+                    logger(NivelLog::Info, "server_signal", "Server requested client to close", 0, peerServidor);
+                    encerrar = true;
+                }
+                continue;
+            }
+            if (estado == DecodificadorQuadros::Estado::Bloco) {
+                // Resposta de "arquivo <caminho>": o corpo não passa pelo decodificador
+                if (q.tipo != TipoQuadro::Resposta || q.seq < primeiroSeq || q.seq >= proximoSeq ||
+                    !receberBloco(clientSocket, entrada, q.tamanho, destinoBloco)) {
+                    logger(NivelLog::Error, "recv", "Block transfer failed", 0, peerServidor);
+                    contarMetrica(Contador::Erros);
+                    encerrar = true;
+                    break;
+                }
+                contarMetrica(Contador::BytesRecebidos, (int64_t)q.tamanho);
+                ++respondidos;
+                continue;
+            }
+            if (estado == DecodificadorQuadros::Estado::Erro) {
+                logger(NivelLog::Error, "protocol", "Invalid frame from server", 0, peerServidor);
+                encerrar = true;
+                break;
+            }
+
+            // recvmsg (via receberComDescritores) para também receber
+            // descritores; o buffer comporta um registro inteiro de seqpacket
+            char buffer2[MAIOR_REGISTRO];
+            ssize_t bytesReceived = receberComDescritores(clientSocket, buffer2, sizeof(buffer2), descritores);
+            if (bytesReceived < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "[ERRO] recv: " << strerror(errno) << "\n";
+                logger(NivelLog::Error, "recv", "Recv failed", 0, peerServidor);
+                contarMetrica(Contador::Erros);
+                encerrar = true;
+                break;
+            }
+            if (bytesReceived == 0) {
+                // 0 bytes significa que o peer (servidor) fechou a conexão.
+                logTexto("[INFO] Servidor fechou a conexão.");
+                logger(NivelLog::Info, "server_closed", "Server closed connection", 0, peerServidor);
+                encerrar = true;
+                break;
+            }
+            logger(NivelLog::Info, "recv", "Message received from server",
+                   (int)bytesReceived, peerServidor);
+            contarMetrica(Contador::BytesRecebidos, bytesReceived);
+            entrada.alimentar(buffer2, (size_t)bytesReceived);
         }
     }
 
-    // Fecha o socket do cliente (encerra a conexão TCP) e registra resultado.
-    if (closesocket(clientSocket) == SOCKET_ERROR) {
-        std::cerr << "[ERRO] closesocket(client): " << WSAGetLastError() << "\n";
-        logger("ERROR", "closesocket", getTimestamp(), "Client socket close failed", 0, "N/A");
-    } else {
-        logger("INFO", "closesocket", getTimestamp(), "Client socket closed", 0, "N/A");
-    }
+    for (int fd : descritores) close(fd);
 
-    // Libera a DLL do Winsock (final da vida da API para este processo).
-    if (WSACleanup() == SOCKET_ERROR) {
-        std::cerr << "[ERRO] WSACleanup: " << WSAGetLastError() << "\n";
-        logger("ERROR", "WSACleanup", getTimestamp(), "WSACleanup failed", 0, "N/A");
+    // Fecha o socket do cliente (encerra a conexão) e registra resultado.
+    if (close(clientSocket) != 0) {
+        std::cerr << "[ERRO] closesocket(client): " << strerror(errno) << "\n";
+        logger(NivelLog::Error, "closesocket", "Client socket close failed", 0, "N/A");
     } else {
-        logger("INFO", "WSACleanup", getTimestamp(), "WSACleanup successful", 0, "N/A");
+        logger(NivelLog::Info, "closesocket", "Client socket closed", 0, "N/A");
     }
 
     return 0;
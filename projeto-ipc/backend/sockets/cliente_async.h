@@ -0,0 +1,225 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// cliente_async.h — cliente com pipelining: mantém até `janela` pedidos em voo
+// na mesma conexão, sem esperar cada resposta antes de mandar o próximo.
+//
+// Uso típico:
+//   ClientePipeline cli(64);
+//   cli.conectarLoopback(8080);
+//   cli.tentarEnviar("ping", [](bool ok, std::string_view r) { ... });
+//   while (cli.emVoo() > 0) cli.processar(100);
+//
+// tentarEnviar() só enfileira o quadro (protocolo.h); processar() envia tudo
+// o que estiver enfileirado num único send, lê as respostas disponíveis e
+// chama os callbacks, casando cada resposta com seu pedido pelo `seq`.
+// Nenhuma chamada bloqueia além do timeout de processar(); fd() permite
+// integrar o socket num epoll/poll próprio.
+// -----------------------------------------------------------------------------
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "protocolo.h"
+#include "transporte.h"
+#include "../common/metricas.h"
+
+class ClientePipeline {
+public:
+    // ok = false quando a conexão caiu antes da resposta chegar.
+    using Callback = std::function<void(bool ok, std::string_view resposta)>;
+
+    explicit ClientePipeline(size_t janela = 64) : pendentes_(janela), enfileiradoEm_(janela) {}
+    ClientePipeline(const ClientePipeline&) = delete;
+    ClientePipeline& operator=(const ClientePipeline&) = delete;
+    ~ClientePipeline() { fechar(); }
+
+    // Conecta (bloqueante) e passa o socket para o modo não bloqueante.
+    // `tipo` = SOCK_SEQPACKET para seqpacket:// (transporte.h).
+    bool conectar(const sockaddr* addr, socklen_t len, int tipo = SOCK_STREAM) {
+        fechar();
+        fd_ = socket(addr->sa_family, tipo | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) return false;
+        maiorEnvio_ = tipo == SOCK_SEQPACKET ? MAIOR_REGISTRO : SIZE_MAX;
+        if (::connect(fd_, addr, len) != 0 || fcntl(fd_, F_SETFL, O_NONBLOCK) != 0) {
+            int erro = errno;
+            ::close(fd_);
+            fd_ = -1;
+            errno = erro;
+            return false;
+        }
+        return true;
+    }
+
+    bool conectarLoopback(uint16_t porta = 8080) {
+        sockaddr_in6 addr{};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_port = htons(porta);
+        addr.sin6_addr = in6addr_loopback;
+        return conectar((const sockaddr*)&addr, sizeof(addr));
+    }
+
+    // Enfileira um comando. Retorna false se a janela está cheia (chame
+    // processar() para receber respostas) ou se não há conexão.
+    bool tentarEnviar(std::string_view comando, Callback cb) {
+        if (fd_ < 0 || emVoo_ == pendentes_.size()) return false;
+        // Seqs em voo nunca distam mais que `janela` entre si, então o resto
+        // da divisão identifica o slot; ele só fica ocupado se uma resposta
+        // antiga ainda não chegou (respostas fora de ordem).
+        const size_t indice = proximoSeq_ % pendentes_.size();
+        Callback& slot = pendentes_[indice];
+        if (slot) return false;
+        slot = cb ? std::move(cb) : [](bool, std::string_view) {};
+        // Um instante por lote: os quadros enfileirados juntos saem no mesmo send
+        if (saida_.empty()) loteDesde_ = monotonicoNs();
+        enfileiradoEm_[indice] = loteDesde_;
+        const uint32_t seq = proximoSeq_++;
+        ++emVoo_;
+        codificarQuadro(saida_, TipoQuadro::Comando, seq, comando);
+        contarMetrica(Contador::MensagensEnviadas);
+        return true;
+    }
+
+    // Versão com future; o future fica inválido (valid() == false) se a
+    // janela está cheia.
+    std::future<std::string> enviar(std::string_view comando) {
+        auto promessa = std::make_shared<std::promise<std::string>>();
+        auto futuro = promessa->get_future();
+        bool ok = tentarEnviar(comando, [promessa](bool ok, std::string_view r) {
+            if (ok) promessa->set_value(std::string(r));
+            else promessa->set_exception(std::make_exception_ptr(
+                     std::runtime_error("conexão encerrada antes da resposta")));
+        });
+        if (!ok) return {};
+        return futuro;
+    }
+
+    // Envia o que estiver enfileirado, espera até `timeoutMs` por dados e
+    // despacha as respostas que chegaram. Retorna quantos callbacks foram
+    // chamados, ou -1 se a conexão caiu (pendentes recebem ok = false).
+    int processar(int timeoutMs) {
+        if (fd_ < 0) return -1;
+        if (!descarregar()) return falhar();
+
+        pollfd p{fd_, POLLIN, 0};
+        if (enviados_ < saida_.size()) p.events |= POLLOUT;
+        if (emVoo_ == 0 && !(p.events & POLLOUT)) return 0;
+        int r = poll(&p, 1, timeoutMs);
+        if (r < 0) return errno == EINTR ? 0 : falhar();
+        if (r == 0) return 0;
+        if (p.revents & POLLOUT && !descarregar()) return falhar();
+        if (!(p.revents & (POLLIN | POLLHUP | POLLERR))) return 0;
+
+        char buffer[MAIOR_REGISTRO];
+        while (true) {
+            ssize_t n = recv(fd_, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                contarMetrica(Contador::BytesRecebidos, (uint64_t)n);
+                entrada_.alimentar(buffer, (size_t)n);
+                if ((size_t)n < sizeof(buffer)) break;
+                continue;
+            }
+            if (n == 0) { // servidor fechou: entrega o que já chegou e falha o resto
+                despachar();
+                return falhar();
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return falhar();
+        }
+        return despachar();
+    }
+
+    size_t emVoo() const { return emVoo_; }
+    size_t janela() const { return pendentes_.size(); }
+    bool conectado() const { return fd_ >= 0; }
+    bool querEnviar() const { return enviados_ < saida_.size(); } // send parcial pendente
+    int fd() const { return fd_; }
+
+    void fechar() {
+        if (fd_ >= 0) falhar();
+    }
+
+private:
+    bool descarregar() {
+        while (enviados_ < saida_.size()) {
+            ssize_t n = send(fd_, saida_.data() + enviados_,
+                             std::min(saida_.size() - enviados_, maiorEnvio_), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+                if (errno == EINTR) continue;
+                return false;
+            }
+            enviados_ += (size_t)n;
+            contarMetrica(Contador::BytesEnviados, (uint64_t)n);
+        }
+        saida_.clear();
+        enviados_ = 0;
+        return true;
+    }
+
+    int despachar() {
+        int chamados = 0;
+        const int64_t agora = monotonicoNs();
+        Quadro q;
+        while (true) {
+            auto estado = entrada_.proximo(q);
+            if (estado == DecodificadorQuadros::Estado::Incompleto) return chamados;
+            // Blocos (zerocopia.h) não são tratados aqui: corpo sem dono é erro
+            if (estado != DecodificadorQuadros::Estado::Quadro || q.tipo != TipoQuadro::Resposta) {
+                return falhar();
+            }
+            // Seq fora da janela ou já respondido: resposta duplicada ou desconhecida
+            const uint32_t distancia = proximoSeq_ - q.seq;
+            const size_t indice = q.seq % pendentes_.size();
+            Callback& slot = pendentes_[indice];
+            if (distancia == 0 || distancia > pendentes_.size() || !slot) return falhar();
+            Callback cb = std::move(slot);
+            slot = nullptr;
+            --emVoo_;
+            // Ida e volta: de tentarEnviar() até a resposta ser decodificada
+            medirLatencia(Latencia::Recebimento, agora - enfileiradoEm_[indice]);
+            contarMetrica(Contador::MensagensRecebidas);
+            cb(true, q.payload);
+            ++chamados;
+        }
+    }
+
+    // Fecha o socket e avisa todos os pedidos ainda em voo.
+    int falhar() {
+        if (fd_ >= 0) ::close(fd_);
+        // Cada pedido sem resposta conta como um erro
+        if (emVoo_ > 0) contarMetrica(Contador::Erros, emVoo_);
+        fd_ = -1;
+        for (auto& cb : pendentes_) {
+            if (cb) {
+                Callback c = std::move(cb);
+                cb = nullptr;
+                c(false, {});
+            }
+        }
+        emVoo_ = 0;
+        saida_.clear();
+        enviados_ = 0;
+        return -1;
+    }
+
+    int fd_ = -1;
+    uint32_t proximoSeq_ = 1;
+    size_t emVoo_ = 0;
+    std::vector<Callback> pendentes_; // indexado por seq % janela
+    std::vector<int64_t> enfileiradoEm_; // monotonicoNs() de cada pendente
+    int64_t loteDesde_ = 0;               // quando `saida_` deixou de estar vazia
+    std::string saida_;
+    size_t enviados_ = 0;
+    size_t maiorEnvio_ = SIZE_MAX;
+    DecodificadorQuadros entrada_;
+};
@@ -0,0 +1,157 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// comandos.h — tabela de comandos montada em tempo de compilação.
+//
+// Um comando é o verbo (primeira palavra do texto) e a função que o trata; o
+// que vem depois do primeiro espaço é passado como argumento. A tabela usa
+// hash perfeito: o construtor constexpr procura uma semente de FNV-1a com a
+// qual todos os verbos caem em posições distintas, então despachar() calcula
+// um hash sobre o verbo, olha uma única posição e confirma com uma comparação.
+// Nada é alocado: o texto é um string_view sobre o buffer de recepção.
+//
+//   void tratarPing(Pedido& p, std::string_view argumento);
+//   constexpr TabelaComandos<Pedido, 3> COMANDOS({
+//       {"ping", tratarPing},
+//       {"arquivo", tratarArquivo, true}, // exige argumento: "arquivo <caminho>"
+//       {"primos", tratarPrimos, true, Execucao::NoPool},
+//   });
+//   if (!COMANDOS.despachar(pedido, texto)) { /* desconhecido */ }
+//
+// A marca de execução só informa quem despacha: NoLaco (padrão) é trabalho
+// curto, feito no próprio thread de I/O; NoPool é trabalho de CPU que deve
+// sair dele. procurar() devolve o comando sem tratá-lo, para essa decisão.
+//
+// Verbos repetidos (ou, em tese, sem semente que os separe) não compilam.
+//
+// RespostaFixa guarda o quadro inteiro de uma resposta constante (cabeçalho já
+// em ordem de rede + texto), montado pelo compilador; responder é um append e
+// a gravação do seq.
+// -----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "protocolo.h"
+
+// Onde o tratador deve rodar: no laço de I/O ou num thread do pool
+enum class Execucao : uint8_t { NoLaco, NoPool };
+
+// Um comando: verbo, função que o trata, se exige argumento ("verbo <arg>") e
+// onde roda
+template <typename Contexto>
+struct Comando {
+    using Tratador = void (*)(Contexto&, std::string_view argumento);
+
+    std::string_view nome;
+    Tratador tratar = nullptr;
+    bool comArgumento = false;
+    Execucao execucao = Execucao::NoLaco;
+};
+
+constexpr uint32_t hashComando(std::string_view nome, uint32_t semente) {
+    uint32_t h = 2166136261u ^ semente;
+    for (char ch : nome) {
+        h ^= (uint8_t)ch;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Chamada com verbos repetidos (ou sem semente que os separe): não é
+// constexpr, então faz a inicialização da tabela falhar na compilação
+inline void verbosRepetidosNaTabela() {}
+
+template <typename Contexto, size_t N>
+class TabelaComandos {
+public:
+    static constexpr size_t POSICOES = [] {
+        size_t n = 8;
+        while (n < 2 * N) n *= 2;
+        return n;
+    }();
+    static constexpr uint32_t MAX_SEMENTES = 4096;
+
+    constexpr TabelaComandos(const Comando<Contexto> (&comandos)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = i + 1; j < N; ++j) {
+                if (comandos[i].nome == comandos[j].nome) verbosRepetidosNaTabela();
+            }
+        }
+        for (uint32_t semente = 0; semente < MAX_SEMENTES; ++semente) {
+            if (tentarSemente(comandos, semente)) return;
+        }
+        verbosRepetidosNaTabela();
+    }
+
+    // Comando do verbo de `texto` e o seu argumento; nullptr se não há
+    // comando que sirva
+    const Comando<Contexto>* procurar(std::string_view texto, std::string_view& argumento) const {
+        const size_t espaco = texto.find(' ');
+        const std::string_view verbo = texto.substr(0, espaco);
+        if (verbo.size() > maiorVerbo_) return nullptr;
+        const Comando<Contexto>& c = posicoes_[hashComando(verbo, semente_) & (POSICOES - 1)];
+        if (!c.tratar || c.nome != verbo || c.comArgumento != (espaco != std::string_view::npos)) return nullptr;
+        argumento = c.comArgumento ? texto.substr(espaco + 1) : std::string_view{};
+        return &c;
+    }
+
+    // Trata `texto` com o comando do verbo; false se não há comando que sirva
+    bool despachar(Contexto& ctx, std::string_view texto) const {
+        std::string_view argumento;
+        const Comando<Contexto>* c = procurar(texto, argumento);
+        if (!c) return false;
+        c->tratar(ctx, argumento);
+        return true;
+    }
+
+    uint32_t semente() const { return semente_; }
+
+private:
+    constexpr bool tentarSemente(const Comando<Contexto> (&comandos)[N], uint32_t semente) {
+        for (size_t i = 0; i < POSICOES; ++i) posicoes_[i] = Comando<Contexto>{};
+        maiorVerbo_ = 0;
+        for (size_t i = 0; i < N; ++i) {
+            Comando<Contexto>& p = posicoes_[hashComando(comandos[i].nome, semente) & (POSICOES - 1)];
+            if (p.tratar) return false; // colisão: tenta a próxima semente
+            p = comandos[i];
+            if (comandos[i].nome.size() > maiorVerbo_) maiorVerbo_ = comandos[i].nome.size();
+        }
+        semente_ = semente;
+        return true;
+    }
+
+    Comando<Contexto> posicoes_[POSICOES] = {};
+    uint32_t semente_ = 0;
+    size_t maiorVerbo_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Quadro de resposta constante, montado em tempo de compilação.
+//   constexpr RespostaFixa PONG("pong");
+//   PONG.acrescentar(c.saida, seq);
+// -----------------------------------------------------------------------------
+template <size_t N>
+struct RespostaFixa {
+    static constexpr size_t TAMANHO = N - 1; // sem o '\0' do literal
+
+    constexpr RespostaFixa(const char (&texto)[N]) {
+        quadro[0] = (char)((TAMANHO >> 24) & 0xFF);
+        quadro[1] = (char)((TAMANHO >> 16) & 0xFF);
+        quadro[2] = (char)((TAMANHO >> 8) & 0xFF);
+        quadro[3] = (char)(TAMANHO & 0xFF);
+        quadro[4] = (char)TipoQuadro::Resposta;
+        for (size_t i = 0; i < TAMANHO; ++i) quadro[TAM_CABECALHO + i] = texto[i];
+    }
+
+    std::string_view texto() const { return std::string_view(quadro + TAM_CABECALHO, TAMANHO); }
+
+    void acrescentar(std::string& saida, uint32_t seq) const {
+        const size_t inicio = saida.size();
+        saida.append(quadro, sizeof(quadro));
+        const uint32_t seqRede = htonl(seq);
+        std::memcpy(&saida[inicio + 8], &seqRede, 4);
+    }
+
+    char quadro[TAM_CABECALHO + TAMANHO] = {};
+};
@@ -0,0 +1,413 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// pool_conexoes.h — conexões mantidas abertas e reaproveitadas entre pedidos.
+//
+// Uso típico:
+//   OpcoesPool op;
+//   op.minimo = 2;
+//   PoolConexoes pool(op);
+//   std::string r;
+//   pool.pedir("unix://@ipc", "ping", r, 1000);            // síncrono
+//   pool.tentarEnviar("tcp://[::1]:8080", "oi", [](bool ok, std::string_view r) { ... });
+//   while (pool.emVoo() > 0) pool.processar(100);
+//
+// Cada destino (a URI de transporte.h) tem de `minimo` a `maximo` conexões
+// ClientePipeline (cliente_async.h). Um pedido vai para a conexão com menos
+// pedidos em voo; se todas já têm algum e ainda cabe outra, abre mais uma. Uma
+// rajada de pedidos curtos não paga socket + connect (e o handshake, em TCP)
+// a cada pedido, só na primeira vez.
+//
+// manter() (chamado por processar() a cada INTERVALO_MANUTENCAO_NS):
+//   - fecha as conexões paradas há mais de `ociosaMaxNs`, até sobrarem `minimo`
+//   - manda "ping" nas paradas há mais de `verificarAposNs`; quem não responde
+//     "pong" em `timeoutPingMs` é fechada
+//   - reabre conexões até `minimo` em cada destino (com um connect recusado,
+//     tenta de novo só após ESPERA_RECONEXAO_NS)
+// Antes de reaproveitar uma conexão parada, um recv(MSG_PEEK) sem bloquear
+// confere que o servidor não a fechou nesse meio-tempo. Se mesmo assim o
+// pedido falhar numa conexão reaproveitada sem nenhuma resposta, ele é
+// reenviado uma vez numa conexão nova; o chamador só vê ok = false quando a
+// conexão nova também falha.
+//
+// Como ClientePipeline, o pool é de um thread só e nenhuma chamada bloqueia,
+// exceto o connect ao abrir conexão e os timeouts dados.
+// -----------------------------------------------------------------------------
+#include <sys/socket.h>
+#include <poll.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "cliente_async.h"
+#include "transporte.h"
+#include "../common/log.h"
+#include "../common/relogio.h"
+
+struct OpcoesPool {
+    size_t minimo = 1;                          // conexões sempre abertas por destino
+    size_t maximo = 8;                          // teto por destino
+    size_t janela = 64;                         // pedidos em voo por conexão
+    int64_t ociosaMaxNs = 30'000'000'000;       // parada por mais que isso: fecha (acima do mínimo)
+    int64_t verificarAposNs = 5'000'000'000;    // parada por mais que isso: ping de saúde
+    int timeoutPingMs = 1000;
+};
+
+constexpr int64_t INTERVALO_MANUTENCAO_NS = 100'000'000;
+// Depois de um connect recusado, manter() espera isso para repor o mínimo
+constexpr int64_t ESPERA_RECONEXAO_NS = 1'000'000'000;
+
+class PoolConexoes {
+public:
+    using Callback = ClientePipeline::Callback;
+
+    explicit PoolConexoes(OpcoesPool opcoes = {}) : opcoes_(opcoes) {
+        if (opcoes_.maximo == 0) opcoes_.maximo = 1;
+        if (opcoes_.minimo > opcoes_.maximo) opcoes_.minimo = opcoes_.maximo;
+    }
+    PoolConexoes(const PoolConexoes&) = delete;
+    PoolConexoes& operator=(const PoolConexoes&) = delete;
+    ~PoolConexoes() { fechar(); }
+
+    // Abre já as `minimo` conexões do destino. false (errno preenchido) se a
+    // URI é inválida ou nenhuma conexão abriu.
+    bool preparar(const std::string& uri) {
+        Destino* d = destino(uri);
+        if (!d) return false;
+        completarMinimo(*d);
+        return !d->conexoes.empty();
+    }
+
+    // Enfileira um comando para o destino. false com errno = EINVAL (URI
+    // inválida), o erro do connect, ou EAGAIN quando todas as conexões estão
+    // com a janela cheia (chame processar()).
+    bool tentarEnviar(const std::string& uri, std::string_view comando, Callback cb) {
+        Destino* d = destino(uri);
+        if (!d) return false;
+        if (!cb) cb = [](bool, std::string_view) {};
+        return enfileirar(*d, comando, cb, true);
+    }
+
+    // Versão com future; inválido (valid() == false) quando tentarEnviar falharia
+    std::future<std::string> enviar(const std::string& uri, std::string_view comando) {
+        auto promessa = std::make_shared<std::promise<std::string>>();
+        auto futuro = promessa->get_future();
+        bool ok = tentarEnviar(uri, comando, [promessa](bool ok, std::string_view r) {
+            if (ok) promessa->set_value(std::string(r));
+            else promessa->set_exception(std::make_exception_ptr(
+                     std::runtime_error("conexão encerrada antes da resposta")));
+        });
+        if (!ok) return {};
+        return futuro;
+    }
+
+    // Envia e espera a resposta por até `timeoutMs`. false com errno =
+    // ETIMEDOUT (o pedido segue em voo e a resposta é descartada ao chegar),
+    // ECONNRESET (a conexão caiu) ou o erro de tentarEnviar.
+    bool pedir(const std::string& uri, std::string_view comando, std::string& resposta, int timeoutMs) {
+        struct Espera {
+            int estado = 0; // 0: esperando, 1: ok, -1: falhou
+            std::string texto;
+        };
+        auto espera = std::make_shared<Espera>();
+        const int64_t limite = monotonicoNs() + (int64_t)timeoutMs * 1'000'000;
+        Callback cb = [espera](bool ok, std::string_view r) {
+            espera->estado = ok ? 1 : -1;
+            if (ok) espera->texto.assign(r.data(), r.size());
+        };
+        while (!tentarEnviar(uri, comando, cb)) {
+            if (errno != EAGAIN) return false;
+            if (monotonicoNs() >= limite) {
+                errno = ETIMEDOUT;
+                return false;
+            }
+            processar(10);
+        }
+        while (espera->estado == 0) {
+            const int64_t falta = limite - monotonicoNs();
+            if (falta <= 0) {
+                errno = ETIMEDOUT;
+                return false;
+            }
+            processar((int)std::min<int64_t>(falta / 1'000'000 + 1, 100));
+        }
+        if (espera->estado < 0) {
+            errno = ECONNRESET;
+            return false;
+        }
+        resposta = std::move(espera->texto);
+        return true;
+    }
+
+    // Envia o que estiver enfileirado em todas as conexões, espera até
+    // `timeoutMs` por respostas e chama os callbacks; depois faz a manutenção
+    // e reenvia os pedidos de conexões que caíram. Retorna quantos callbacks
+    // foram chamados.
+    int processar(int timeoutMs) {
+        // Os callbacks podem abrir conexões (tentarEnviar): a lista é
+        // copiada antes; nenhuma conexão é destruída até removerCaidas()
+        std::vector<ClientePipeline*> ativas;
+        for (auto& [uri, d] : destinos_) {
+            for (auto& c : d.conexoes) {
+                if (c->cli.conectado() && c->cli.emVoo() > 0) ativas.push_back(&c->cli);
+            }
+        }
+        int chamados = 0;
+        std::vector<pollfd> fds;
+        std::vector<ClientePipeline*> donos;
+        for (ClientePipeline* cli : ativas) {
+            const int r = cli->processar(0); // descarrega e colhe o que já chegou
+            if (r > 0) chamados += r;
+            if (!cli->conectado() || cli->emVoo() == 0) continue;
+            fds.push_back({cli->fd(), (short)(POLLIN | (cli->querEnviar() ? POLLOUT : 0)), 0});
+            donos.push_back(cli);
+        }
+        if (!fds.empty() && chamados == 0 && poll(fds.data(), fds.size(), timeoutMs) > 0) {
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (fds[i].revents == 0) continue;
+                const int r = donos[i]->processar(0);
+                if (r > 0) chamados += r;
+            }
+        }
+        const int64_t agora = monotonicoNs();
+        if (agora - ultimaManutencao_ >= INTERVALO_MANUTENCAO_NS) manter(agora);
+        removerCaidas();
+        reenviar();
+        return chamados;
+    }
+
+    // Fecha ociosas, verifica a saúde das paradas e repõe o mínimo
+    void manter(int64_t agora = monotonicoNs()) {
+        ultimaManutencao_ = agora;
+        for (auto& [uri, d] : destinos_) {
+            size_t abertas = d.conexoes.size();
+            for (auto& c : d.conexoes) {
+                if (!c->cli.conectado() || c->descartar) continue;
+                if (c->verificando) {
+                    if (agora - c->verificadaEm > (int64_t)opcoes_.timeoutPingMs * 1'000'000) {
+                        logger(NivelLog::Warn, "pool", "Health check timed out", 0, d.endereco.descricao);
+                        c->descartar = true;
+                    }
+                    continue;
+                }
+                if (c->cli.emVoo() > 0) continue;
+                if (agora - c->usadaEm > opcoes_.ociosaMaxNs && abertas > opcoes_.minimo) {
+                    logger(NivelLog::Info, "pool", "Idle connection closed", 0, d.endereco.descricao);
+                    c->descartar = true;
+                    --abertas;
+                } else if (agora - std::max(c->usadaEm, c->verificadaEm) > opcoes_.verificarAposNs) {
+                    verificar(d, *c, agora);
+                }
+            }
+        }
+        removerCaidas();
+        for (auto& [uri, d] : destinos_) {
+            if (agora >= d.reconectarApos) completarMinimo(d);
+        }
+    }
+
+    size_t emVoo() const {
+        size_t n = reenvios_.size();
+        for (auto& [uri, d] : destinos_) {
+            for (auto& c : d.conexoes) n += c->cli.emVoo();
+        }
+        return n;
+    }
+
+    // Conexões abertas para o destino
+    size_t conexoes(const std::string& uri) const {
+        auto it = destinos_.find(uri);
+        return it == destinos_.end() ? 0 : it->second.conexoes.size();
+    }
+
+    // Quantas vezes o pool abriu conexão (para comparar com o número de pedidos)
+    uint64_t aberturas() const { return aberturas_; }
+
+    // Fecha tudo; os pedidos em voo recebem ok = false
+    void fechar() {
+        fechando_ = true;
+        // Fecha antes de destruir: os callbacks em voo rodam com as conexões
+        // ainda inteiras
+        auto destinos = std::move(destinos_);
+        destinos_.clear();
+        for (auto& [uri, d] : destinos) {
+            for (auto& c : d.conexoes) c->cli.fechar();
+        }
+        destinos.clear();
+        std::deque<Reenvio> pendentes;
+        pendentes.swap(reenvios_);
+        for (auto& r : pendentes) r.cb(false, {});
+        fechando_ = false;
+    }
+
+private:
+    struct ConexaoPool {
+        explicit ConexaoPool(size_t janela) : cli(janela) {}
+        ClientePipeline cli;
+        uint64_t pedidos = 0;      // enviados por esta conexão
+        int64_t usadaEm = 0;       // último pedido enviado ou resposta recebida
+        int64_t verificadaEm = 0;  // último ping de saúde enviado
+        bool verificando = false;  // ping de saúde em voo
+        bool descartar = false;    // sai da lista em removerCaidas()
+    };
+
+    struct Destino {
+        std::string uri;
+        Endereco endereco;
+        std::vector<std::unique_ptr<ConexaoPool>> conexoes;
+        int64_t reconectarApos = 0; // espera depois de um connect recusado
+    };
+
+    // Pedido a reenviar numa conexão nova (a reaproveitada caiu sem responder)
+    struct Reenvio {
+        std::string uri;
+        std::string comando;
+        Callback cb;
+    };
+
+    Destino* destino(const std::string& uri) {
+        auto it = destinos_.find(uri);
+        if (it != destinos_.end()) return &it->second;
+        Endereco e;
+        if (!resolverEndereco(uri, e)) return nullptr;
+        Destino& d = destinos_[uri];
+        d.uri = uri;
+        d.endereco = std::move(e);
+        return &d;
+    }
+
+    ConexaoPool* abrir(Destino& d) {
+        auto c = std::make_unique<ConexaoPool>(opcoes_.janela);
+        if (!c->cli.conectar((const sockaddr*)&d.endereco.addr, d.endereco.len, d.endereco.tipo)) {
+            const int erro = errno;
+            logger(NivelLog::Error, "connect", std::string("Pool connect failed: ") + strerror(erro), 0,
+                   d.endereco.descricao);
+            errno = erro;
+            return nullptr;
+        }
+        ++aberturas_;
+        logger(NivelLog::Info, "connect", "Pool connection opened", 0, d.endereco.descricao);
+        c->usadaEm = monotonicoNs();
+        d.conexoes.push_back(std::move(c));
+        return d.conexoes.back().get();
+    }
+
+    void completarMinimo(Destino& d) {
+        while (d.conexoes.size() < opcoes_.minimo) {
+            if (!abrir(d)) {
+                d.reconectarApos = monotonicoNs() + ESPERA_RECONEXAO_NS;
+                return;
+            }
+        }
+    }
+
+    // O servidor fechou a conexão enquanto ela estava parada? Um FIN (ou
+    // RST) pendente aparece como recv = 0 (ou erro) sem consumir nada.
+    static bool vivo(ClientePipeline& cli) {
+        char c;
+        const ssize_t n = recv(cli.fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+
+    void verificar(Destino& d, ConexaoPool& c, int64_t agora) {
+        ConexaoPool* pc = &c;
+        c.verificando = true;
+        c.verificadaEm = agora;
+        const bool ok = c.cli.tentarEnviar("ping", [pc, descricao = d.endereco.descricao](bool ok, std::string_view r) {
+            pc->verificando = false;
+            if (ok && r == "pong") return;
+            if (ok) logger(NivelLog::Warn, "pool", "Health check failed", 0, descricao);
+            pc->descartar = true;
+        });
+        if (!ok) c.descartar = true;
+    }
+
+    bool enfileirar(Destino& d, std::string_view comando, const Callback& cb, bool podeReenviar) {
+        const int64_t agora = monotonicoNs();
+        // A de menos pedidos em voo; uma parada há muito tempo é conferida antes
+        ConexaoPool* escolhida = nullptr;
+        size_t abertas = 0;
+        for (auto& c : d.conexoes) {
+            if (!c->cli.conectado() || c->descartar) continue;
+            if (c->cli.emVoo() == 0 && agora - c->usadaEm > opcoes_.verificarAposNs && !vivo(c->cli)) {
+                c->descartar = true;
+                continue;
+            }
+            ++abertas;
+            if (c->verificando || c->cli.emVoo() == c->cli.janela()) continue;
+            if (!escolhida || c->cli.emVoo() < escolhida->cli.emVoo()) escolhida = c.get();
+        }
+        // Todas ocupadas: abre mais uma enquanto couber
+        if ((!escolhida || escolhida->cli.emVoo() > 0) && abertas < opcoes_.maximo) {
+            if (ConexaoPool* nova = abrir(d)) escolhida = nova;
+            else if (!escolhida) return false;
+        }
+        if (!escolhida) {
+            errno = EAGAIN;
+            return false;
+        }
+
+        // Numa conexão que já atendeu pedidos, guarda o comando: se ela cair
+        // sem responder (o servidor pode tê-la fechado), vai de novo numa nova
+        ConexaoPool* pc = escolhida;
+        const bool reaproveitada = podeReenviar && escolhida->pedidos > 0;
+        Callback resposta = [this, pc, uri = d.uri, reenvio = reaproveitada ? std::string(comando) : std::string(),
+                             cb, reaproveitada](bool ok, std::string_view r) mutable {
+            if (ok) {
+                pc->usadaEm = monotonicoNs();
+                cb(true, r);
+            } else if (reaproveitada && !fechando_) {
+                reenvios_.push_back({std::move(uri), std::move(reenvio), std::move(cb)});
+            } else {
+                cb(false, {});
+            }
+        };
+        if (!escolhida->cli.tentarEnviar(comando, std::move(resposta))) {
+            errno = EAGAIN;
+            return false;
+        }
+        ++escolhida->pedidos;
+        escolhida->usadaEm = agora;
+        return true;
+    }
+
+    // Destrói as conexões fechadas ou marcadas; nunca chamada de um callback.
+    // As marcadas saem da lista e são fechadas antes da destruição: a falha
+    // dos pedidos em voo chama os callbacks, e o do ping de saúde escreve na
+    // própria ConexaoPool
+    void removerCaidas() {
+        std::vector<std::unique_ptr<ConexaoPool>> caidas;
+        for (auto& [uri, d] : destinos_) {
+            auto& v = d.conexoes;
+            auto fim = std::stable_partition(v.begin(), v.end(),
+                                             [](auto& c) { return c->cli.conectado() && !c->descartar; });
+            caidas.insert(caidas.end(), std::make_move_iterator(fim), std::make_move_iterator(v.end()));
+            v.erase(fim, v.end());
+        }
+        for (auto& c : caidas) c->cli.fechar();
+    }
+
+    void reenviar() {
+        std::deque<Reenvio> pendentes;
+        pendentes.swap(reenvios_);
+        for (auto& r : pendentes) {
+            Destino* d = destino(r.uri);
+            if (!d || !enfileirar(*d, r.comando, r.cb, false)) r.cb(false, {});
+        }
+    }
+
+    OpcoesPool opcoes_;
+    std::unordered_map<std::string, Destino> destinos_;
+    std::deque<Reenvio> reenvios_;
+    int64_t ultimaManutencao_ = 0;
+    uint64_t aberturas_ = 0;
+    bool fechando_ = false;
+};
@@ -0,0 +1,174 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// pool_tarefas.h — pool de threads com roubo de tarefas + fila MPSC sem travas.
+//
+// Uso típico (servidor: comandos pesados saem do thread de I/O):
+//   PoolTarefas pool(4);
+//   pool.enviar([...] { ...; retorno.empilhar(resultado); });
+//
+// Cada thread do pool tem a sua fila (deque com trava própria: as travas são
+// por fila, nunca uma global). enviar() de fora do pool distribui as tarefas
+// em rodízio; uma tarefa criada dentro do pool vai para a fila do próprio
+// thread. O dono tira do fim da sua fila (a tarefa mais recente, ainda quente
+// no cache) e um thread sem trabalho rouba do início da fila de outro (a mais
+// antiga). Quem não acha nada dorme numa variável de condição; enviar() só
+// paga o notify quando há alguém dormindo.
+//
+// FilaMPSC<T>: fila de Vyukov para muitos produtores e um consumidor, sem
+// travas. empilhar() é um exchange e um store; tirar() não usa nenhuma
+// operação atômica de leitura-modificação-escrita. Um produtor interrompido
+// entre os dois passos esconde temporariamente os itens que vieram depois
+// dele: tirar() devolve false até ele terminar.
+// -----------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class FilaMPSC {
+public:
+    FilaMPSC() : cabeca_(new No), cauda_(cabeca_.load(std::memory_order_relaxed)) {}
+    FilaMPSC(const FilaMPSC&) = delete;
+    FilaMPSC& operator=(const FilaMPSC&) = delete;
+    ~FilaMPSC() {
+        T descartado;
+        while (tirar(descartado)) {}
+        delete cauda_;
+    }
+
+    // Qualquer thread
+    void empilhar(T valor) {
+        No* no = new No;
+        no->valor = std::move(valor);
+        No* anterior = cabeca_.exchange(no, std::memory_order_acq_rel);
+        anterior->proximo.store(no, std::memory_order_release);
+    }
+
+    // Só o consumidor; false se vazia (ou com um produtor no meio do empilhar)
+    bool tirar(T& valor) {
+        No* proximo = cauda_->proximo.load(std::memory_order_acquire);
+        if (!proximo) return false;
+        valor = std::move(proximo->valor);
+        delete cauda_; // o nó seguinte vira a nova sentinela
+        cauda_ = proximo;
+        return true;
+    }
+
+private:
+    struct No {
+        std::atomic<No*> proximo{nullptr};
+        T valor{};
+    };
+
+    alignas(64) std::atomic<No*> cabeca_; // produtores
+    alignas(64) No* cauda_;               // consumidor (sentinela)
+};
+
+class PoolTarefas {
+public:
+    using Tarefa = std::function<void()>;
+
+    explicit PoolTarefas(unsigned threads) : filas_(threads ? threads : 1) {
+        for (unsigned i = 0; i < filas_.size(); ++i) threads_.emplace_back(&PoolTarefas::executar, this, i);
+    }
+    PoolTarefas(const PoolTarefas&) = delete;
+    PoolTarefas& operator=(const PoolTarefas&) = delete;
+
+    // Termina as tarefas já enfileiradas e junta os threads
+    ~PoolTarefas() {
+        {
+            std::lock_guard<std::mutex> trava(travaSono_);
+            encerrar_ = true;
+        }
+        acordar_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    void enviar(Tarefa tarefa) {
+        const size_t i = atual_ == this ? indiceAtual_
+                                        : proxima_.fetch_add(1, std::memory_order_relaxed) % filas_.size();
+        {
+            std::lock_guard<std::mutex> trava(filas_[i].trava);
+            filas_[i].tarefas.push_back(std::move(tarefa));
+        }
+        // seq_cst com o par de executar(): ou o thread que vai dormir vê a
+        // tarefa, ou nós o vemos dormindo e o acordamos
+        pendentes_.fetch_add(1);
+        if (dormindo_.load() > 0) {
+            std::lock_guard<std::mutex> trava(travaSono_);
+            acordar_.notify_one();
+        }
+    }
+
+    size_t threads() const { return threads_.size(); }
+    uint64_t roubadas() const { return roubadas_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Fila {
+        std::mutex trava;
+        std::deque<Tarefa> tarefas;
+    };
+
+    bool pegar(size_t i, Tarefa& tarefa) {
+        {
+            Fila& f = filas_[i];
+            std::lock_guard<std::mutex> trava(f.trava);
+            if (!f.tarefas.empty()) {
+                tarefa = std::move(f.tarefas.back());
+                f.tarefas.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < filas_.size(); ++k) {
+            Fila& f = filas_[(i + k) % filas_.size()];
+            std::unique_lock<std::mutex> trava(f.trava, std::try_to_lock);
+            if (!trava.owns_lock() || f.tarefas.empty()) continue;
+            tarefa = std::move(f.tarefas.front());
+            f.tarefas.pop_front();
+            roubadas_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void executar(size_t i) {
+        atual_ = this;
+        indiceAtual_ = i;
+        Tarefa tarefa;
+        while (true) {
+            if (pendentes_.load() > 0 && pegar(i, tarefa)) {
+                pendentes_.fetch_sub(1);
+                tarefa();
+                tarefa = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> trava(travaSono_);
+            dormindo_.fetch_add(1);
+            // pendentes_ > 0 sem nada achado: um try_lock falhou; tenta de novo
+            acordar_.wait(trava, [&] { return encerrar_ || pendentes_.load() > 0; });
+            dormindo_.fetch_sub(1);
+            if (encerrar_ && pendentes_.load() == 0) return;
+        }
+    }
+
+    static inline thread_local PoolTarefas* atual_ = nullptr;
+    static inline thread_local size_t indiceAtual_ = 0;
+
+    std::vector<Fila> filas_;
+    std::vector<std::thread> threads_;
+    alignas(64) std::atomic<size_t> pendentes_{0};
+    std::atomic<int> dormindo_{0};
+    std::atomic<size_t> proxima_{0};
+    std::atomic<uint64_t> roubadas_{0};
+    std::mutex travaSono_;
+    std::condition_variable acordar_;
+    bool encerrar_ = false;
+};
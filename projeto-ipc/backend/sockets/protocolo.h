@@ -0,0 +1,146 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// protocolo.h — enquadramento (framing) das mensagens do par server/client.
+//
+// TCP é um fluxo de bytes sem fronteiras: um recv pode trazer meio comando ou
+// vários comandos grudados. Cada mensagem passa a ser um quadro:
+//
+//   +------------+---------+---------+------------+-----------------+
+//   | tamanho u32| tipo u8 | flags u8| reserv. u16| seq u32 | payload |
+//   +------------+---------+---------+------------+-----------------+
+//     12 bytes de cabeçalho, inteiros em ordem de rede (big-endian);
+//     `tamanho` conta apenas o payload.
+//
+// `seq` é escolhido pelo cliente e devolvido na resposta, o que permite casar
+// respostas com pedidos. Vários quadros podem ir no mesmo send (lote); o
+// servidor responde a todos e devolve as respostas também num único send.
+//
+// Quadros com FLAG_BLOCO (transferência em bloco, ver zerocopia.h) não passam
+// pelo limite de MAIOR_PAYLOAD nem pelo buffer do decodificador: proximo()
+// entrega só o cabeçalho (Estado::Bloco) e quem chama copia o corpo direto
+// para o próprio buffer (tirar() + recv).
+// -----------------------------------------------------------------------------
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+constexpr size_t TAM_CABECALHO = 12;
+constexpr uint32_t MAIOR_PAYLOAD = 16u << 20; // 16 MiB: acima disso é erro de protocolo
+
+enum class TipoQuadro : uint8_t {
+    Comando  = 1, // cliente → servidor
+    Resposta = 2, // servidor → cliente
+};
+
+constexpr uint8_t FLAG_BLOCO = 0x01;     // corpo grande, lido direto no buffer do destino
+constexpr uint8_t FLAG_DESCRITOR = 0x02; // um descritor (SCM_RIGHTS) acompanha o quadro
+
+struct Quadro {
+    TipoQuadro tipo;
+    uint8_t flags;
+    uint32_t seq;
+    std::string_view payload; // aponta para dentro do buffer do decodificador
+    uint32_t tamanho;         // tamanho do corpo (igual a payload.size() fora de blocos)
+};
+
+// Acrescenta só o cabeçalho de um quadro cujo corpo tem `tamanho` bytes.
+inline void codificarCabecalho(std::string& saida, TipoQuadro tipo, uint32_t seq,
+                               uint32_t tamanho, uint8_t flags = 0) {
+    char cab[TAM_CABECALHO];
+    const uint32_t tam = htonl(tamanho);
+    const uint32_t seqRede = htonl(seq);
+    std::memcpy(cab, &tam, 4);
+    cab[4] = (char)tipo;
+    cab[5] = (char)flags;
+    cab[6] = cab[7] = 0;
+    std::memcpy(cab + 8, &seqRede, 4);
+    saida.append(cab, TAM_CABECALHO);
+}
+
+// Acrescenta um quadro completo em `saida` (sem alocar se já houver capacidade).
+inline void codificarQuadro(std::string& saida, TipoQuadro tipo, uint32_t seq,
+                            std::string_view payload, uint8_t flags = 0) {
+    codificarCabecalho(saida, tipo, seq, (uint32_t)payload.size(), flags);
+    saida.append(payload.data(), payload.size());
+}
+
+// Quadro cujo payload é escrito direto em `saida` (ex.: EscritorMensagem, de
+// common/mensagem.h): abrirQuadro() acrescenta o cabeçalho com tamanho 0 e
+// devolve onde ele começa; fecharQuadro() grava o tamanho do que veio depois.
+inline size_t abrirQuadro(std::string& saida, TipoQuadro tipo, uint32_t seq, uint8_t flags = 0) {
+    const size_t inicio = saida.size();
+    codificarCabecalho(saida, tipo, seq, 0, flags);
+    return inicio;
+}
+
+inline void fecharQuadro(std::string& saida, size_t inicio) {
+    const uint32_t tam = htonl((uint32_t)(saida.size() - inicio - TAM_CABECALHO));
+    std::memcpy(&saida[inicio], &tam, 4);
+}
+
+// -----------------------------------------------------------------------------
+// Decodificador incremental: recebe bytes na ordem em que chegam (alimentar)
+// e entrega quadros completos (proximo). Um quadro parcial fica guardado até
+// o restante chegar. As string_view devolvidas valem até a próxima chamada
+// de alimentar().
+// -----------------------------------------------------------------------------
+class DecodificadorQuadros {
+public:
+    enum class Estado { Quadro, Bloco, Incompleto, Erro };
+
+    void alimentar(const char* dados, size_t n) {
+        // Descarta o que já foi consumido antes de crescer o buffer
+        if (inicio_ > 0 && (inicio_ == buffer_.size() || inicio_ >= buffer_.size() / 2)) {
+            buffer_.erase(0, inicio_);
+            inicio_ = 0;
+        }
+        buffer_.append(dados, n);
+    }
+
+    // Extrai o próximo quadro completo, se houver.
+    Estado proximo(Quadro& q) {
+        const size_t disponivel = buffer_.size() - inicio_;
+        if (disponivel < TAM_CABECALHO) return Estado::Incompleto;
+
+        const char* p = buffer_.data() + inicio_;
+        uint32_t tam, seq;
+        std::memcpy(&tam, p, 4);
+        std::memcpy(&seq, p + 8, 4);
+        tam = ntohl(tam);
+        q.tipo = (TipoQuadro)(uint8_t)p[4];
+        q.flags = (uint8_t)p[5];
+        q.seq = ntohl(seq);
+        q.tamanho = tam;
+        if (q.flags & FLAG_BLOCO) {
+            // O corpo fica para quem chamou: tirar() e depois recv direto
+            q.payload = {};
+            inicio_ += TAM_CABECALHO;
+            return Estado::Bloco;
+        }
+        if (tam > MAIOR_PAYLOAD) return Estado::Erro;
+        if (disponivel < TAM_CABECALHO + tam) return Estado::Incompleto;
+
+        q.payload = std::string_view(p + TAM_CABECALHO, tam);
+        inicio_ += TAM_CABECALHO + tam;
+        return Estado::Quadro;
+    }
+
+    // Copia até `max` bytes já recebidos (o começo do corpo de um bloco) para
+    // `destino` e os descarta. Retorna quantos bytes copiou.
+    size_t tirar(char* destino, size_t max) {
+        const size_t n = std::min(max, buffer_.size() - inicio_);
+        std::memcpy(destino, buffer_.data() + inicio_, n);
+        inicio_ += n;
+        return n;
+    }
+
+    // Bytes recebidos que ainda não formam um quadro completo.
+    size_t pendentes() const { return buffer_.size() - inicio_; }
+
+private:
+    std::string buffer_;
+    size_t inicio_ = 0;
+};
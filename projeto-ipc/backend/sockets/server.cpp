@@ -1,254 +1,1144 @@
-#include <winsock2.h>     // API de sockets do Windows (Winsock)
-#include <ws2tcpip.h>     // Extensões (IPv6, funções utilitárias)
+#include <sys/socket.h>   // API de sockets POSIX
+#include <sys/epoll.h>    // epoll: notificação de prontidão para milhares de fds
+#include <sys/resource.h> // getrlimit/setrlimit (limite de descritores abertos)
+#include <sys/eventfd.h>  // eventfd: avisa todos os workers do encerramento
+#include <poll.h>         // POLLIN para o poll do eventfd via io_uring
+#include <pthread.h>      // afinidade de CPU e máscara de sinais por thread
+#include <netinet/in.h>   // sockaddr_in6, in6addr_loopback
+#include <arpa/inet.h>    // inet_ntop
+#include <unistd.h>       // close
+#include <fcntl.h>        // open da raiz de "arquivo" e "descritor" (--raiz)
+#include <csignal>        // SIGINT/SIGTERM para encerramento ordenado
+#include <cerrno>         // errno
+#include <cstring>        // strerror
 #include <iostream>       // I/O em C++
-#include <chrono>         // (não usado diretamente aqui) utilidades de tempo modernas
-#include <iomanip>        // (não usado diretamente aqui) formatação de I/O
-#include <sstream>        // (não usado diretamente aqui) string streams
-#include <ctime>          // time_t, time(), ctime()
-#pragma comment(lib, "Ws2_32.lib") // Linka a biblioteca Ws2_32.lib (necessária no Windows)
-
-// -----------------------------------------------------------------------------
-// Utilitário: devolve um timestamp simples (string) usando ctime()
-// Observação: ctime() retorna uma string com newline no final; aqui apenas
-// embrulhamos em std::string sem remover o '\n'.
-// -----------------------------------------------------------------------------
-std::string getTimestamp() {
-    // Pega o tempo atual (epoch time)
-    time_t currentTime = time(NULL);
-
-    // Converte para string legível (horário local); retorna ponteiro char*
-    // Ex.: "Wed Sep  4 12:34:56 2025\n"
-    char* dateTimeString = ctime(&currentTime);
-
-    // Constrói std::string a partir do char* retornado
-    return std::string(dateTimeString);
-}
-
-// -----------------------------------------------------------------------------
-// logger(): função de logging no formato JSON-like para stdout.
-// Parâmetros:
-//  - level: nível do log (INFO/ERROR/etc.)
-//  - event: nome curto do evento (ex.: "accept", "recv", "send")
-//  - ts: timestamp (string) — aqui usamos getTimestamp()
-//  - msg: mensagem descritiva
-//  - bytes: quantidade de bytes (quando fizer sentido; 0 caso não se aplique)
-//  - peer: identificação do peer (ex.: "::1:8080" ou placeholder se desconhecido)
-// -----------------------------------------------------------------------------
-void logger(const std::string& level, const std::string& event, const std::string& ts,
-            const std::string& msg, int bytes, const std::string& peer) {
-    std::cout << "{\n"
-              << "  \"module\": \"sockets\",\n"
-              << "  \"role\": \"server\",\n"
-              << "  \"level\": \"" << level << "\",\n"
-              << "  \"event\": \"" << event << "\",\n"
-              << "  \"ts\": \"" << ts << "\",\n"
-              << "  \"details\": {\n"
-              << "    \"msg\": \"" << msg << "\",\n"
-              << "    \"bytes\": " << bytes << ",\n"
-              << "    \"peer\": \"" << peer << "\"\n"
-              << "  }\n"
-              << "}" << std::endl;
-}
-
-int main() {
-    WSADATA wsa;
+#include <string>
+#include <string_view>
+#include <unordered_map>  // conexões ativas indexadas pelo fd
+#include <deque>          // respostas em ordem (vagas)
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>         // um thread por worker
+#include <functional>     // std::cref
+#include <algorithm>
+#include <cstdlib>
+#include <climits>        // PATH_MAX (realpath da raiz)
+#include "protocolo.h"    // quadros com tamanho + tipo + seq
+#include "comandos.h"     // tabela de comandos com hash perfeito (constexpr)
+#include "../common/log.h" // logging assíncrono (JSON por linha)
+#include "../common/metricas.h" // contadores e histogramas (IPC_METRICAS_MS)
+#include "../common/mensagem.h" // mensagens binárias tipadas, lidas no lugar
+#include "uring.h"        // motor alternativo: io_uring (--io=uring)
+#include "zerocopia.h"    // transferência em bloco: MSG_ZEROCOPY / sendfile
+#include "transporte.h"   // tcp://, unix://, seqpacket:// e passagem de descritores
+#include "pool_tarefas.h" // comandos pesados fora do thread de I/O (--tarefas=N)
 
-    // -----------------------------------------------------------------------------
-    // WSAStartup: inicializa a DLL do Winsock (obrigatório no Windows).
-    // Sucesso → 0; erro → != 0. Em caso de erro, WSAGetLastError traz o código.
-    // -----------------------------------------------------------------------------
-    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-        std::cerr << "[ERRO] WSAStartup: " << WSAGetLastError() << "\n";
-        return 1;
+// -----------------------------------------------------------------------------
+// Estado de cada cliente conectado. Como os sockets são não bloqueantes, uma
+// leitura pode trazer só parte do que o cliente enviou e um envio pode aceitar
+// só parte da resposta; por isso cada conexão tem seus próprios buffers.
+//  - entrada: decodificador com os bytes recebidos (guarda quadros parciais)
+//  - saida:   respostas ainda não aceitas pelo kernel (a partir de `enviados`)
+//  - fechar:  encerrar assim que `saida` for esvaziada (comando "sair")
+//  - bloco:   corpo de uma transferência em bloco ("arquivo"), enviado direto
+//             do arquivo logo depois de `saida`; enquanto existir, novos
+//             comandos esperam no decodificador para não se intercalarem nele
+//  - vagas:   respostas na ordem dos pedidos quando algum comando foi para o
+//             pool: ele e os que chegam depois dele ocupam uma vaga cada, e as
+//             vagas prontas do início passam para `saida`
+// No motor io_uring o kernel lê direto de `emEnvio` enquanto respostas novas
+// se acumulam em `saida`; `enviados` passa a contar bytes de `emEnvio`.
+// -----------------------------------------------------------------------------
+struct RetornoPool;
 
-    } else {
-        // Log de sucesso (útil para auditoria/diagnóstico)
-        logger("INFO", "WSAStartup", getTimestamp(), "WSAStartup successful", 0, "N/A");
+struct Vaga {
+    std::string quadros;
+    bool pronta = false;
+};
+
+struct Conexao {
+    int fd = -1;
+    uint64_t id = 0; // único no worker: distingue conexões que reusaram o fd
+    std::string peer;
+    DecodificadorQuadros entrada;
+    std::string saida;
+    size_t enviados = 0;
+    bool querEscrita = false; // EPOLLOUT registrado no epoll
+    bool fechar = false;
+    bool fimLeitura = false;  // o cliente fechou o envio (EOF): nada mais chega
+
+    std::unique_ptr<ArquivoMapeado> bloco;
+    size_t blocoEnviado = 0;
+    EnviosZeroCopia zc;
+    // Blocos já enviados com MSG_ZEROCOPY cujas páginas o kernel ainda lê
+    std::vector<std::unique_ptr<ArquivoMapeado>> retidos;
+    bool aceitaBloco = true;  // false no motor io_uring: o corpo vai copiado em `saida`
+
+    bool local = false;             // AF_UNIX: aceita passar descritores
+    size_t maiorEnvio = SIZE_MAX;   // MAIOR_REGISTRO em seqpacket
+    std::vector<int> descritores;   // vão anexados (SCM_RIGHTS) ao próximo envio
+    int64_t esperaDesde = 0;        // monotonicoNs() em que `saida` deixou de estar vazia
+
+    RetornoPool* retorno = nullptr; // nullptr: sem pool, tudo é tratado no laço
+    std::deque<Vaga> vagas;
+    uint64_t primeiraVaga = 0;      // número de vagas.front(), contado desde o início
+    bool tocada = false;            // já está na lista de conexões a descarregar
+
+    // Só no motor io_uring
+    std::string emEnvio;      // buffer do send em voo (no máximo um por conexão)
+    bool enviando = false;
+    int64_t esperaEmEnvio = 0; // esperaDesde das respostas que estão em emEnvio
+    int64_t envioDesde = 0;    // quando o SEND em voo foi preparado
+    bool desligado = false;   // shutdown() já feito; falta só as operações terminarem
+    int operacoes = 0;        // SQEs em voo que referenciam esta conexão
+};
+
+// "::1:54321" a partir do endereço devolvido por accept4. Clientes AF_UNIX
+// não têm endereço; usamos o pid do processo do outro lado (SO_PEERCRED).
+std::string descreverPeer(const sockaddr_storage& addr, int fd) {
+    if (addr.ss_family == AF_UNIX) {
+        ucred cred{};
+        socklen_t len = sizeof(cred);
+        getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len);
+        return "unix:pid=" + std::to_string(cred.pid);
     }
+    const sockaddr_in6& in6 = (const sockaddr_in6&)addr;
+    char ip[INET6_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET6, &in6.sin6_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(in6.sin6_port));
+}
 
-    // -----------------------------------------------------------------------------
-    // Criação do socket do servidor:
-    // - AF_INET6: família IPv6
-    // - SOCK_STREAM: TCP (fluxo confiável, ordenado; sem fronteiras de "mensagem")
-    // - protocolo = 0: escolhe o padrão para STREAM/IPv6 → TCP
-    // Retorno: SOCKET válido ou INVALID_SOCKET em erro.
-    // -----------------------------------------------------------------------------
-    SOCKET serverSocket = socket(AF_INET6, SOCK_STREAM, 0);
+// -----------------------------------------------------------------------------
+// Protocolo simples por comandos de texto:
+//  - "oi"   → responde "hello"
+//  - "ping" → responde "pong"
+//  - "sair" → responde "Fechando socket..." e encerra a sessão deste cliente
+//  - "arquivo <caminho>" → devolve o conteúdo do arquivo num quadro FLAG_BLOCO
+//    (zerocopia.h); só o cabeçalho passa por c.saida
+//  - "descritor <caminho>" → só em AF_UNIX: abre o arquivo e passa o próprio
+//    descritor ao cliente (SCM_RIGHTS) junto de um quadro FLAG_DESCRITOR
+//    Os dois só servem arquivos regulares dentro de --raiz (sem ela, recusam)
+//  - "primos <n>" → quantos primos há até n (crivo); roda no pool de tarefas
+//  - default → "Comando Desconhecido"
+// Cada comando chega num quadro (protocolo.h) e a resposta volta num quadro
+// do tipo Resposta com o mesmo `seq`. A resposta é apenas enfileirada em
+// c.saida; o envio acontece no loop, então todas as respostas de um lote
+// saem juntas num único send.
+//
+// Os comandos ficam em COMANDOS (comandos.h): o verbo é achado por hash
+// perfeito calculado na compilação, sem cadeia de comparações. Para criar um
+// comando basta escrever o tratador e acrescentar uma linha na tabela; as
+// respostas constantes usam responderFixo<>, com o quadro já montado.
+// Comandos marcados Execucao::NoPool não rodam no thread de I/O (ver
+// enviarAoPool); os tratadores deles só podem usar p.saida, nunca p.c.
+//
+// O comando pode vir como texto puro ou como mensagem binária (mensagem.h):
+// nesse caso o texto é lido no lugar, direto do buffer de recepção, e a
+// resposta volta também binária, ecoando o instante de envio do cliente.
+// -----------------------------------------------------------------------------
+void responderMensagem(std::string& saida, uint32_t seq, std::string_view resposta,
+                       const VisaoMensagem& pedido) {
+    const size_t quadro = abrirQuadro(saida, TipoQuadro::Resposta, seq);
+    EscritorMensagem m(saida, TipoMensagem::Resposta);
+    m.texto(Campo::Texto, resposta);
+    if (pedido.tem(Campo::EnviadoEm)) m.i64(Campo::EnviadoEm, pedido.i64(Campo::EnviadoEm));
+    m.fechar();
+    fecharQuadro(saida, quadro);
+}
 
-    if (serverSocket == INVALID_SOCKET) {
-        std::cerr << "[ERRO] socket: " << WSAGetLastError() << "\n";
-        WSACleanup();
-        return 1;
+// Comando em tratamento
+struct Pedido {
+    Conexao* c;                   // nullptr no pool
+    std::string& saida;           // onde a resposta é montada
+    uint32_t seq;
+    const VisaoMensagem* binario; // nullptr: pedido em texto puro
+};
+
+// Resposta de texto montada na hora, no formato do pedido
+void responder(Pedido& p, std::string_view resposta) {
+    if (p.binario) responderMensagem(p.saida, p.seq, resposta, *p.binario);
+    else codificarQuadro(p.saida, TipoQuadro::Resposta, p.seq, resposta);
+}
 
+constexpr RespostaFixa HELLO("hello");
+constexpr RespostaFixa PONG("pong");
+constexpr RespostaFixa FECHANDO("Fechando socket...");
+constexpr RespostaFixa DESCONHECIDO("Comando Desconhecido");
+
+template <const auto& Resposta>
+void responderFixo(Pedido& p, std::string_view) {
+    if (p.binario) responderMensagem(p.saida, p.seq, Resposta.texto(), *p.binario);
+    else Resposta.acrescentar(p.saida, p.seq);
+}
+
+void comandoSair(Pedido& p, std::string_view) {
+    logTexto("Fechando socket...");
+    p.c->fechar = true;
+    responderFixo<FECHANDO>(p, {});
+}
+
+// Diretório servido por "arquivo" e "descritor" (--raiz=DIR, aberto com
+// O_PATH em main); -1: os dois comandos ficam desligados
+int raizArquivos = -1;
+std::string raizCanonica; // realpath da raiz: caminhos absolutos dentro dela valem
+
+// Caminho do pedido relativo à raiz. false (já respondido) sem raiz ou com um
+// caminho absoluto fora dela; ".." e links para fora, quem recusa é openat2
+bool caminhoNaRaiz(Pedido& p, std::string_view caminho, std::string& relativo) {
+    if (raizArquivos < 0) {
+        responder(p, "Arquivos desabilitados (inicie o servidor com --raiz=DIR)");
+        return false;
+    }
+    relativo.assign(caminho);
+    if (relativo.empty() || relativo[0] != '/') return true;
+    const std::string prefixo = raizCanonica == "/" ? raizCanonica : raizCanonica + "/";
+    if (relativo == raizCanonica || relativo.rfind(prefixo, 0) == 0) {
+        relativo.erase(0, std::min(prefixo.size(), relativo.size()));
+        if (relativo.empty()) relativo = ".";
+        return true;
+    }
+    responder(p, "Erro ao abrir arquivo: caminho fora da raiz");
+    return false;
+}
+
+void responderErroAbertura(Pedido& p) {
+    responder(p, std::string("Erro ao abrir arquivo: ") +
+                 (errno == EXDEV ? "caminho fora da raiz" : strerror(errno)));
+}
+
+void comandoArquivo(Pedido& p, std::string_view caminho) {
+    std::string relativo;
+    if (!caminhoNaRaiz(p, caminho, relativo)) return;
+    auto arquivo = std::make_unique<ArquivoMapeado>();
+    if (!arquivo->abrir(raizArquivos, relativo)) {
+        responderErroAbertura(p);
+        return;
+    }
+    Conexao& c = *p.c;
+    codificarCabecalho(p.saida, TipoQuadro::Resposta, p.seq, (uint32_t)arquivo->tamanho(), FLAG_BLOCO);
+    if (c.aceitaBloco) {
+        c.bloco = std::move(arquivo);
+        c.blocoEnviado = 0;
     } else {
-        logger("INFO", "socket", getTimestamp(), "Socket created successfully", 0, "N/A");
+        p.saida.append(arquivo->dados(), arquivo->tamanho());
     }
+}
 
-    // -----------------------------------------------------------------------------
-    // Montagem do endereço local (onde o servidor escuta):
-    // sockaddr_in6 descreve um endpoint IPv6:
-    //  - sin6_family = AF_INET6 (IPv6)
-    //  - sin6_port   = htons(8080) → porta 8080 em ordem de rede (big-endian)
-    //  - sin6_addr   = in6addr_loopback (= ::1), logo só aceita conexões locais.
-    // Obs.: "{}" zera a struct (boa prática para evitar lixo de memória).
-    // -----------------------------------------------------------------------------
-    sockaddr_in6 serverAddr{};
-    serverAddr.sin6_family = AF_INET6;          // IPv6
-    serverAddr.sin6_port   = htons(8080);       // porta 8080
-    serverAddr.sin6_addr   = in6addr_loopback;  // ::1
+void comandoDescritor(Pedido& p, std::string_view caminho) {
+    if (!p.c->local) {
+        responder(p, "Descritores indisponiveis nesta conexao (use unix:// ou seqpacket:// com --io=epoll)");
+        return;
+    }
+    std::string relativo;
+    if (!caminhoNaRaiz(p, caminho, relativo)) return;
+    const int fd = abrirSobRaiz(raizArquivos, relativo);
+    if (fd < 0) {
+        responderErroAbertura(p);
+        return;
+    }
+    p.c->descritores.push_back(fd);
+    codificarQuadro(p.saida, TipoQuadro::Resposta, p.seq, caminho, FLAG_DESCRITOR);
+}
 
-    // -----------------------------------------------------------------------------
-    // bind: associa o socket ao endereço/porta configurados acima.
-    // Sucesso → 0; erro → SOCKET_ERROR.
-    // Sem bind, o SO não saberia em qual IP/porta seu servidor atende.
-    // -----------------------------------------------------------------------------
-    if (bind(serverSocket, (sockaddr*)&serverAddr, sizeof(serverAddr)) == SOCKET_ERROR) {
-        std::cerr << "[ERRO] bind: " << WSAGetLastError() << "\n";
-        closesocket(serverSocket);
-        WSACleanup();
-        return 1;
+// Maior n aceito por "primos" (o crivo usa n bits)
+constexpr size_t MAX_PRIMOS = 100000000;
+
+void comandoPrimos(Pedido& p, std::string_view argumento) {
+    const size_t n = std::strtoull(std::string(argumento).c_str(), nullptr, 10);
+    if (n > MAX_PRIMOS) {
+        responder(p, "Limite de primos: " + std::to_string(MAX_PRIMOS));
+        return;
+    }
+    size_t primos = 0;
+    if (n >= 2) {
+        std::vector<bool> composto(n + 1, false);
+        for (size_t i = 2; i <= n; ++i) {
+            if (composto[i]) continue;
+            ++primos;
+            for (size_t j = i * i; j <= n; j += i) composto[j] = true;
+        }
+    }
+    responder(p, "primos até " + std::to_string(n) + ": " + std::to_string(primos));
+}
+
+constexpr TabelaComandos<Pedido, 6> COMANDOS({
+    {"oi", responderFixo<HELLO>},
+    {"ping", responderFixo<PONG>},
+    {"sair", comandoSair},
+    {"arquivo", comandoArquivo, true},
+    {"descritor", comandoDescritor, true},
+    {"primos", comandoPrimos, true, Execucao::NoPool},
+});
+
+// -----------------------------------------------------------------------------
+// Pool de tarefas (--tarefas=N). Os comandos NoPool saem do thread de I/O:
+// vão para o PoolTarefas, comum a todos os workers, com uma cópia do pedido,
+// e a resposta volta pela FilaMPSC do worker dono da conexão. O eventfd do
+// worker (no epoll, ou num POLL do io_uring) o acorda; só o primeiro
+// resultado de cada leva escreve nele. Assim um comando pesado não atrasa os
+// "ping" das outras conexões, e a conexão dele continua recebendo as
+// respostas na ordem dos pedidos (vagas).
+// -----------------------------------------------------------------------------
+struct Concluido {
+    int fd = -1;
+    uint64_t conexao = 0; // Conexao::id
+    uint64_t vaga = 0;
+    std::string quadros;
+};
+
+struct RetornoPool {
+    PoolTarefas* pool = nullptr;
+    FilaMPSC<Concluido> fila;
+    std::atomic<bool> avisado{false};
+    int evento = -1; // eventfd não bloqueante
+
+    ~RetornoPool() {
+        if (evento >= 0) close(evento);
+    }
 
+    // Threads do pool
+    void entregar(Concluido r) {
+        fila.empilhar(std::move(r));
+        uint64_t um = 1;
+        if (!avisado.exchange(true) && write(evento, &um, sizeof(um)) < 0) contarMetrica(Contador::Erros);
+    }
+
+    // Thread de I/O, com o eventfd legível: f(Concluido&) para cada resultado
+    template <typename F>
+    void colher(F&& f) {
+        uint64_t valor;
+        if (read(evento, &valor, sizeof(valor)) < 0 && errno != EAGAIN) contarMetrica(Contador::Erros);
+        // Depois de zerar a marca, quem entregar de novo volta a avisar; o
+        // exchange também torna visíveis os resultados de quem não avisou
+        avisado.exchange(false);
+        Concluido r;
+        while (fila.tirar(r)) f(r);
+    }
+};
+
+std::atomic<uint64_t> proximaConexao{1};
+
+// Nova vaga na conexão; devolve o número dela
+uint64_t abrirVaga(Conexao& c, bool pronta) {
+    c.vagas.emplace_back();
+    c.vagas.back().pronta = pronta;
+    return c.primeiraVaga + c.vagas.size() - 1;
+}
+
+void enviarAoPool(Conexao& c, const Comando<Pedido>& comando, std::string_view payload,
+                  std::string_view argumento, uint32_t seq, bool binario) {
+    Concluido r;
+    r.fd = c.fd;
+    r.conexao = c.id;
+    r.vaga = abrirVaga(c, false);
+    // O argumento é relido da cópia: a visão dele aponta para o buffer de recepção
+    const size_t desvio = argumento.empty() ? 0 : (size_t)(argumento.data() - payload.data());
+    c.retorno->pool->enviar([retorno = c.retorno, tratar = comando.tratar, r = std::move(r),
+                             copia = std::string(payload), desvio, tam = argumento.size(), seq,
+                             binario]() mutable {
+        VisaoMensagem pedido;
+        if (binario) pedido.abrir(copia.data(), copia.size());
+        Pedido p{nullptr, r.quadros, seq, binario ? &pedido : nullptr};
+        tratar(p, std::string_view(copia).substr(desvio, tam));
+        retorno->entregar(std::move(r));
+    });
+}
+
+// Resposta do pool chegou: ocupa a sua vaga e passa para `saida` as vagas
+// prontas do início
+void receberConcluido(Conexao& c, Concluido& r) {
+    Vaga& v = c.vagas[r.vaga - c.primeiraVaga];
+    v.quadros = std::move(r.quadros);
+    v.pronta = true;
+    while (!c.vagas.empty() && c.vagas.front().pronta) {
+        if (c.saida.empty()) c.esperaDesde = monotonicoNs();
+        c.saida += c.vagas.front().quadros;
+        c.vagas.pop_front();
+        ++c.primeiraVaga;
+    }
+}
+
+void processarComando(Conexao& c, std::string_view payload, uint32_t seq) {
+    std::string_view mensagemCliente = payload;
+    VisaoMensagem pedido;
+    const bool binario = pareceMensagem(mensagemCliente) &&
+                         pedido.abrir(mensagemCliente.data(), mensagemCliente.size());
+    if (binario) mensagemCliente = pedido.texto(Campo::Texto);
+    logTexto("Mensagem recebida do cliente: ", mensagemCliente);
+    contarMetrica(Contador::MensagensRecebidas);
+    contarMetrica(Contador::MensagensEnviadas); // toda mensagem tem uma resposta
+
+    std::string_view argumento;
+    const Comando<Pedido>* comando = COMANDOS.procurar(mensagemCliente, argumento);
+    if (comando && comando->execucao == Execucao::NoPool && c.retorno) {
+        enviarAoPool(c, *comando, payload, argumento, seq, binario);
+        return;
+    }
+
+    if (c.vagas.empty()) {
+        if (c.saida.empty()) c.esperaDesde = monotonicoNs();
+        Pedido p{&c, c.saida, seq, binario ? &pedido : nullptr};
+        if (comando) comando->tratar(p, argumento);
+        else responderFixo<DESCONHECIDO>(p, {});
+        return;
+    }
+    // Atrás de uma resposta do pool: esta já nasce pronta, na própria vaga. O
+    // corpo de "arquivo" vai copiado, já que um bloco sairia logo após `saida`
+    Vaga& v = c.vagas[abrirVaga(c, true) - c.primeiraVaga];
+    const bool aceitaBloco = c.aceitaBloco;
+    c.aceitaBloco = false;
+    Pedido p{&c, v.quadros, seq, binario ? &pedido : nullptr};
+    if (comando) comando->tratar(p, argumento);
+    else responderFixo<DESCONHECIDO>(p, {});
+    c.aceitaBloco = aceitaBloco;
+}
+
+// -----------------------------------------------------------------------------
+// Envia o que estiver pendente em c.saida até o kernel recusar (EAGAIN).
+// Retorna false em erro fatal de send (conexão deve ser fechada).
+// MSG_NOSIGNAL evita SIGPIPE quando o cliente já fechou.
+// -----------------------------------------------------------------------------
+bool enviarPendentes(Conexao& c) {
+    // MSG_MORE: com um bloco na sequência, o cabeçalho não sai sozinho num
+    // segmento (nem fica preso pelo Nagle esperando o ACK)
+    const int flags = MSG_NOSIGNAL | (c.bloco ? MSG_MORE : 0);
+    while (c.enviados < c.saida.size()) {
+        const size_t parte = std::min(c.saida.size() - c.enviados, c.maiorEnvio);
+        const int64_t inicio = monotonicoNs();
+        ssize_t sent;
+        if (c.descritores.empty()) {
+            sent = send(c.fd, c.saida.data() + c.enviados, parte, flags);
+        } else {
+            // Os descritores seguem com o primeiro envio que sair; como esse
+            // envio começa antes (ou no) quadro que os anuncia, eles nunca
+            // chegam depois do quadro
+            sent = enviarComDescritores(c.fd, c.saida.data() + c.enviados, parte, c.descritores, flags);
+            if (sent >= 0) {
+                const size_t qtd = std::min(c.descritores.size(), MAX_DESCRITORES_ENVIO);
+                for (size_t i = 0; i < qtd; ++i) close(c.descritores[i]);
+                c.descritores.erase(c.descritores.begin(), c.descritores.begin() + qtd);
+            }
+        }
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true; // buffer do kernel cheio
+            if (errno == EINTR) continue;
+            std::cerr << "[ERRO] send: " << strerror(errno) << "\n";
+            contarMetrica(Contador::Erros);
+            return false;
+        }
+        const int64_t fim = monotonicoNs();
+        medirLatencia(Latencia::Envio, fim - inicio);
+        contarMetrica(Contador::BytesEnviados, (uint64_t)sent);
+        logger(NivelLog::Info, "send", "Message sent to client", (int)sent, c.peer);
+        c.enviados += (size_t)sent;
+        // Tudo aceito pelo kernel: quanto as respostas esperaram em `saida`
+        if (c.enviados == c.saida.size()) medirLatencia(Latencia::Espera, fim - c.esperaDesde);
+    }
+    c.saida.clear();
+    c.enviados = 0;
+
+    // Corpo do bloco, logo depois do cabeçalho que estava em c.saida
+    if (c.bloco) {
+        if (!enviarCorpo(c.fd, *c.bloco, c.blocoEnviado, c.zc, c.maiorEnvio)) {
+            std::cerr << "[ERRO] send(bloco): " << strerror(errno) << "\n";
+            contarMetrica(Contador::Erros);
+            return false;
+        }
+        if (c.blocoEnviado < c.bloco->tamanho()) return true; // resto no próximo EPOLLOUT
+        contarMetrica(Contador::BytesEnviados, c.blocoEnviado);
+        logger(NivelLog::Info, "send", "Block sent to client", (int)c.blocoEnviado, c.peer);
+        if (c.zc.pendente()) c.retidos.push_back(std::move(c.bloco));
+        c.bloco.reset();
+    }
+    return true;
+}
+
+// Liga/desliga EPOLLOUT conforme haja resposta pendente (evita acordar à toa).
+void atualizarInteresse(int epfd, Conexao& c) {
+    bool quer = c.enviados < c.saida.size() || c.bloco;
+    if (quer == c.querEscrita) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (quer ? (uint32_t)EPOLLOUT : 0u);
+    ev.data.fd = c.fd;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.querEscrita = quer;
+}
+
+void fecharConexao(std::unordered_map<int, Conexao>& conexoes, int fd) {
+    auto it = conexoes.find(fd);
+    if (it == conexoes.end()) return;
+    for (int d : it->second.descritores) close(d);
+    // close() também remove o fd do epoll
+    if (close(fd) != 0) {
+        std::cerr << "[ERRO] close(client): " << strerror(errno) << "\n";
     } else {
-        logger("INFO", "bind", getTimestamp(), "Bind successful on [::1]:8080", 0, "::1:8080");
+        logger(NivelLog::Info, "closesocket", "Client socket closed", 0, it->second.peer);
     }
+    conexoes.erase(it);
+}
 
-    // -----------------------------------------------------------------------------
-    // listen: coloca o socket em modo passivo (servidor), criando a fila de espera.
-    // backlog = 5 → até 5 conexões podem ficar pendentes aguardando accept().
-    // Sucesso → 0; erro → SOCKET_ERROR.
-    // -----------------------------------------------------------------------------
-    if (listen(serverSocket, 5) == SOCKET_ERROR) {
-        std::cerr << "[ERRO] listen: " << WSAGetLastError() << "\n";
-        closesocket(serverSocket);
-        WSACleanup();
-        return 1;
+// -----------------------------------------------------------------------------
+// Aceita todas as conexões pendentes (o listen socket é edge-triggered, então
+// é preciso esvaziar a fila até EAGAIN) e registra cada uma no epoll.
+// -----------------------------------------------------------------------------
+void aceitarConexoes(int serverSocket, int epfd, std::unordered_map<int, Conexao>& conexoes,
+                     RetornoPool* retorno) {
+    while (true) {
+        sockaddr_storage clientAddr{};
+        socklen_t len = sizeof(clientAddr);
+        int fd = accept4(serverSocket, (sockaddr*)&clientAddr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // EMFILE/ENFILE: sem descritores; as pendentes esperam a próxima volta
+            std::cerr << "[ERRO] accept: " << strerror(errno) << "\n";
+            return;
+        }
+
+        Conexao& c = conexoes[fd];
+        c.fd = fd;
+        c.id = proximaConexao.fetch_add(1, std::memory_order_relaxed);
+        c.retorno = retorno;
+        c.peer = descreverPeer(clientAddr, fd);
+        c.local = clientAddr.ss_family == AF_UNIX;
+        c.maiorEnvio = maiorEnvioDoSocket(fd);
+        c.zc.habilitar(fd); // sem suporte (ex.: AF_UNIX), blocos vão por sendfile()
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            std::cerr << "[ERRO] epoll_ctl(ADD): " << strerror(errno) << "\n";
+            fecharConexao(conexoes, fd);
+            continue;
+        }
+        logger(NivelLog::Info, "accept", "Client connected", 0, c.peer);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Processa todos os quadros completos que chegaram (um recv pode trazer
+// vários comandos ou só parte de um). Depois de "sair" ignoramos o resto;
+// depois do EOF do cliente, um quadro incompleto nunca se completa e a
+// conexão fecha assim que as respostas saírem. Com MAX_VAGAS respostas
+// presas atrás do pool, os próximos comandos esperam no decodificador até
+// alguma delas sair.
+// Retorna false em erro de protocolo (conexão deve ser fechada).
+// -----------------------------------------------------------------------------
+constexpr size_t MAX_VAGAS = 1024;
+
+bool processarQuadros(Conexao& c) {
+    Quadro q;
+    while (!c.fechar && !c.bloco && c.vagas.size() < MAX_VAGAS) {
+        auto estado = c.entrada.proximo(q);
+        if (estado == DecodificadorQuadros::Estado::Incompleto) {
+            if (c.fimLeitura) c.fechar = true;
+            break;
+        }
+        if (estado != DecodificadorQuadros::Estado::Quadro || q.tipo != TipoQuadro::Comando) {
+            logger(NivelLog::Error, "protocol", "Invalid frame from client", 0, c.peer);
+            return false;
+        }
+        processarComando(c, q.payload, q.seq);
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Processa os quadros que esperam no decodificador e envia as respostas.
+// Retorna false em erro ou quando "sair" (ou o EOF do cliente) já foi
+// totalmente respondido.
+// -----------------------------------------------------------------------------
+bool avancarConexao(int epfd, Conexao& c) {
+    // Quando um bloco termina de sair, os comandos que esperavam por ele
+    // são processados na mesma volta.
+    while (true) {
+        if (!processarQuadros(c)) return false;
+        const bool esperavaBloco = c.bloco != nullptr;
+        if (!enviarPendentes(c)) return false;
+        if (!esperavaBloco || c.bloco) break;
+    }
+    atualizarInteresse(epfd, c);
+    return !(c.fechar && c.saida.empty() && c.vagas.empty());
+}
+
+// -----------------------------------------------------------------------------
+// Trata um evento de uma conexão. Retorna false se ela deve ser fechada.
+// -----------------------------------------------------------------------------
+bool tratarConexao(int epfd, Conexao& c, uint32_t eventos) {
+    if (eventos & EPOLLERR) {
+        // As notificações de MSG_ZEROCOPY também chegam como EPOLLERR
+        int erro = 0;
+        socklen_t len = sizeof(erro);
+        getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &erro, &len);
+        if (erro != 0 || !c.zc.habilitado() || !c.zc.colher(c.fd)) return false;
+        if (!c.zc.pendente()) c.retidos.clear();
+    }
+
+    if (!c.fimLeitura && (eventos & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+        // Edge-triggered: lê até esvaziar o socket (EAGAIN). O buffer comporta
+        // um registro inteiro de seqpacket (transporte.h).
+        char buffer2[MAIOR_REGISTRO];
+        while (true) {
+            const int64_t inicio = monotonicoNs();
+            ssize_t bytesReceived = recv(c.fd, buffer2, sizeof(buffer2), 0);
+            if (bytesReceived > 0) {
+                medirLatencia(Latencia::Recebimento, monotonicoNs() - inicio);
+                contarMetrica(Contador::BytesRecebidos, (uint64_t)bytesReceived);
+                logger(NivelLog::Info, "recv", "Message received from client", (int)bytesReceived, c.peer);
+                c.entrada.alimentar(buffer2, (size_t)bytesReceived);
+                continue;
+            }
+            if (bytesReceived == 0) {
+                // 0 = peer fechou a conexão (fim ordenado). Pode ter sido só
+                // o envio (shutdown): as respostas que estão no pool ainda saem
+                logTexto("[INFO] Cliente fechou a conexão.");
+                c.fimLeitura = true;
+                break;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            std::cerr << "[ERRO] recv: " << strerror(errno) << "\n";
+            contarMetrica(Contador::Erros);
+            return false;
+        }
+    }
+
+    // Fecha quando o cliente saiu e tudo o que ele pediu foi respondido
+    return avancarConexao(epfd, c);
+}
+
+// Sobe o limite de descritores até o máximo permitido (milhares de conexões).
+void aumentarLimiteDescritores() {
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Cria o socket de escuta no endereço escolhido (padrão [::1]:8080, ver
+// transporte.h). Com reusePort (só TCP), cada worker chama esta função e
+// recebe o seu próprio socket na mesma porta (SO_REUSEPORT); o kernel
+// distribui as conexões novas entre eles por hash do par de endereços.
+// Retorno: fd válido ou -1 em erro (já registrado).
+// -----------------------------------------------------------------------------
+int criarSocketEscuta(const Endereco& endereco, bool reusePort) {
+    // - familia: AF_INET6 (TCP) ou AF_UNIX
+    // - tipo: SOCK_STREAM (fluxo, sem fronteiras de "mensagem") ou
+    //   SOCK_SEQPACKET (AF_UNIX com fronteiras de registro)
+    // - SOCK_NONBLOCK: accept nunca bloqueia; quem espera é o epoll_wait
+    int serverSocket = socket(endereco.familia, endereco.tipo | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (serverSocket < 0) {
+        std::cerr << "[ERRO] socket: " << strerror(errno) << "\n";
+        return -1;
 
     } else {
-        logger("INFO", "listen", getTimestamp(), "Listening for connections", 0, "::1:8080");
+        logger(NivelLog::Info, "socket", "Socket created successfully", 0, "N/A");
     }
 
-    std::cout << "Servidor aguardando conexões em [::1]:8080...\n";
+    int opt = 1;
+    if (endereco.local()) {
+        // Um arquivo de socket que sobrou de uma execução anterior impede o bind
+        std::string caminho = endereco.caminho();
+        if (!caminho.empty()) unlink(caminho.c_str());
+    } else {
+        // SO_REUSEADDR: permite reiniciar o servidor sem esperar o TIME_WAIT da porta
+        setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (reusePort && setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) != 0) {
+            std::cerr << "[ERRO] setsockopt(SO_REUSEPORT): " << strerror(errno) << "\n";
+            close(serverSocket);
+            return -1;
+        }
+    }
 
-    // -----------------------------------------------------------------------------
-    // accept: bloqueia até chegar uma conexão pendente, então retorna um NOVO socket
-    // exclusivo para falar com aquele cliente. O serverSocket continua aberto
-    // para aceitar outros (não fazemos isso aqui, mas é o comportamento).
-    // Sucesso → SOCKET válido; erro → INVALID_SOCKET.
-    // Como passamos nullptr para addr e addrlen, não coletamos IP/porta do cliente.
-    // -----------------------------------------------------------------------------
-    SOCKET clientSocket = accept(serverSocket, nullptr, nullptr);
+    if (bind(serverSocket, (const sockaddr*)&endereco.addr, endereco.len) != 0) {
+        std::cerr << "[ERRO] bind: " << strerror(errno) << "\n";
+        close(serverSocket);
+        return -1;
 
-    if (clientSocket == INVALID_SOCKET) {
-        std::cerr << "[ERRO] accept: " << WSAGetLastError() << "\n";
-        closesocket(serverSocket);
-        WSACleanup();
-        return 1;
+    } else {
+        logger(NivelLog::Info, "bind", "Bind successful on " + endereco.descricao, 0, endereco.descricao);
+    }
+
+    // listen: backlog = SOMAXCONN → a fila de conexões pendentes usa o máximo do
+    // kernel, já que aceitamos continuamente (e não apenas um cliente).
+    if (listen(serverSocket, SOMAXCONN) != 0) {
+        std::cerr << "[ERRO] listen: " << strerror(errno) << "\n";
+        close(serverSocket);
+        return -1;
 
     } else {
-        // Como não coletamos o endpoint real do cliente (nullptr), usamos um placeholder.
-        logger("INFO", "accept", getTimestamp(), "Client connected", 0, "::1:random_port");
+        logger(NivelLog::Info, "listen", "Listening for connections", 0, endereco.descricao);
+    }
+    return serverSocket;
+}
+
+// -----------------------------------------------------------------------------
+// Motor epoll: um único thread acompanha o socket de escuta e todas as conexões
+// deste worker. Todos os fds são edge-triggered (EPOLLET): cada evento é
+// tratado lendo / escrevendo até EAGAIN. O eventfd de encerramento é
+// level-triggered, então acorda todos os workers. Com pool, o eventfd do
+// retorno traz as respostas dos comandos que rodaram nele.
+// -----------------------------------------------------------------------------
+void loopEpoll(int serverSocket, int eventoEncerrar, RetornoPool* retorno) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        std::cerr << "[ERRO] epoll_create1: " << strerror(errno) << "\n";
+        return;
     }
+    epoll_event evServidor{};
+    evServidor.events = EPOLLIN | EPOLLET;
+    evServidor.data.fd = serverSocket;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, serverSocket, &evServidor);
+    epoll_event evEncerrar{};
+    evEncerrar.events = EPOLLIN;
+    evEncerrar.data.fd = eventoEncerrar;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, eventoEncerrar, &evEncerrar);
+    if (retorno) {
+        epoll_event evRetorno{};
+        evRetorno.events = EPOLLIN;
+        evRetorno.data.fd = retorno->evento;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, retorno->evento, &evRetorno);
+    }
+
+    std::unordered_map<int, Conexao> conexoes;
+    std::vector<int> tocadas; // conexões que receberam respostas do pool
+    epoll_event eventos[256];
+    bool encerrar = false;
 
     // -----------------------------------------------------------------------------
-    // Loop principal do servidor: recebe comandos do cliente e responde.
-    // Observações de TCP:
-    //  - recv() lê "até N bytes" do fluxo (pode vir menos; stream não tem fronteiras).
-    //  - bytesReceived == 0 → cliente fechou a conexão ordenadamente.
-    //  - bytesReceived == SOCKET_ERROR → houve falha; use WSAGetLastError().
+    // Loop principal: espera prontidão e atende cada fd sem nunca bloquear nele.
     // -----------------------------------------------------------------------------
-    while (true) {
-        char buffer2[5096] = {0}; // Zeramos para facilitar prints; não é obrigatório.
+    while (!encerrar) {
+        int n = epoll_wait(epfd, eventos, 256, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[ERRO] epoll_wait: " << strerror(errno) << "\n";
+            break;
+        }
 
-        // recv: lê até sizeof(buffer2) bytes.
-        int bytesReceived = recv(clientSocket, buffer2, sizeof(buffer2), 0);
+        for (int i = 0; i < n; ++i) {
+            int fd = eventos[i].data.fd;
+            if (fd == eventoEncerrar) {
+                encerrar = true;
+                continue;
+            }
+            if (fd == serverSocket) {
+                aceitarConexoes(serverSocket, epfd, conexoes, retorno);
+                continue;
+            }
+            if (retorno && fd == retorno->evento) {
+                retorno->colher([&](Concluido& r) {
+                    auto it = conexoes.find(r.fd);
+                    if (it == conexoes.end() || it->second.id != r.conexao) return; // já fechada
+                    receberConcluido(it->second, r);
+                    if (!it->second.tocada) {
+                        it->second.tocada = true;
+                        tocadas.push_back(r.fd);
+                    }
+                });
+                // Um envio por conexão para todas as respostas da leva
+                for (int t : tocadas) {
+                    Conexao& c = conexoes[t];
+                    c.tocada = false;
+                    if (!avancarConexao(epfd, c)) fecharConexao(conexoes, t);
+                }
+                tocadas.clear();
+                continue;
+            }
+            auto it = conexoes.find(fd);
+            if (it == conexoes.end()) continue;
+            if (!tratarConexao(epfd, it->second, eventos[i].events)) {
+                fecharConexao(conexoes, fd);
+            }
+        }
+    }
 
-        if (bytesReceived == SOCKET_ERROR) {
-            std::cerr << "[ERRO] recv: " << WSAGetLastError() << "\n";
-            break; // encerra a sessão com este cliente
+    // Encerramento (ordem: clientes → epoll; o socket de escuta fica com o worker).
+    while (!conexoes.empty()) {
+        fecharConexao(conexoes, conexoes.begin()->first);
+    }
+    close(epfd);
+}
+
+// -----------------------------------------------------------------------------
+// Motor io_uring: em vez de esperar prontidão e fazer uma syscall por
+// accept/recv/send, o worker deixa operações registradas no anel e só colhe
+// conclusões:
+//  - um accept multishot no socket de escuta entrega todas as conexões;
+//  - cada conexão tem um recv multishot que tira buffers de um grupo
+//    fornecido (GRUPO_BUFFERS); o buffer volta ao anel assim que os bytes
+//    passam para o decodificador;
+//  - as respostas de uma rodada inteira de conclusões viram SENDs que saem
+//    juntos na mesma io_uring_enter, que também espera as próximas conclusões.
+// O user_data de cada SQE carrega a operação (32 bits altos) e o fd.
+// Retorna false se o io_uring não pôde ser usado antes de atender alguém; o
+// worker então cai de volta no epoll.
+// -----------------------------------------------------------------------------
+enum OperacaoUring : uint64_t { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_ENCERRAR = 4, OP_POOL = 5 };
+
+constexpr uint16_t GRUPO_BUFFERS = 0;
+constexpr unsigned QTD_BUFFERS_URING = 1024;  // potência de 2
+constexpr unsigned TAM_BUFFER_URING = 4096;
 
+inline uint64_t dadosUring(OperacaoUring op, int fd) {
+    return ((uint64_t)op << 32) | (uint32_t)fd;
+}
+
+bool loopUring(int serverSocket, int eventoEncerrar, RetornoPool* retorno) {
+    AnelUring anel;
+    if (!anel.iniciar(4096) ||
+        !anel.registrarBuffers(GRUPO_BUFFERS, QTD_BUFFERS_URING, TAM_BUFFER_URING)) {
+        logger(NivelLog::Warn, "io_uring",
+               std::string("io_uring unavailable, falling back to epoll: ") + strerror(errno), 0, "N/A");
+        return false;
+    }
+    anel.prepararAcceptMultishot(serverSocket, dadosUring(OP_ACCEPT, serverSocket));
+    anel.prepararPoll(eventoEncerrar, POLLIN, dadosUring(OP_ENCERRAR, eventoEncerrar));
+    if (retorno) anel.prepararPoll(retorno->evento, POLLIN, dadosUring(OP_POOL, retorno->evento));
+
+    std::unordered_map<int, Conexao> conexoes;
+    std::vector<Conexao*> tocadas; // conexões com algo a fazer no fim da rodada
+    bool aceitouAlguma = false;
+    bool suportado = true;
+    bool encerrar = false;
+
+    auto tocar = [&](Conexao& c) {
+        if (!c.tocada) {
+            c.tocada = true;
+            tocadas.push_back(&c);
+        }
+    };
+    auto armarRecv = [&](Conexao& c) {
+        if (anel.prepararRecvMultishot(c.fd, GRUPO_BUFFERS, dadosUring(OP_RECV, c.fd))) {
+            ++c.operacoes;
         } else {
-            // Loga o total de bytes lidos nesta chamada (pode variar)
-            logger("INFO", "recv", getTimestamp(), "Message received from client", bytesReceived, "::1:random_port");
+            c.fechar = true; // fila de submissão cheia mesmo após submeter
         }
+    };
 
-        if (bytesReceived == 0) {
-            // 0 = peer fechou a conexão (fim ordenado)
-            std::cout << "[INFO] Cliente fechou a conexão.\n";
+    while (!encerrar && suportado) {
+        if (anel.submeter(1) < 0) {
+            std::cerr << "[ERRO] io_uring_enter: " << strerror(errno) << "\n";
             break;
         }
 
-        // Constrói uma std::string exata a partir dos bytes recebidos.
-        // Importante: não dependemos de '\0' — usamos (buffer2, bytesReceived).
-        std::string mensagemCliente(buffer2, bytesReceived);
-        std::cout << "Mensagem recebida do cliente: " << mensagemCliente << std::endl;
-
-        int sent = 0;
-
-        // -------------------------------------------------------------------------
-        // Protocolo simples por comandos de texto:
-        //  - "oi"   → responde "hello"
-        //  - "ping" → responde "pong"
-        //  - "sair" → responde "Fechando socket..." e encerra a sessão
-        //  - default → "Comando Desconhecido"
-        // Obs.: TCP é stream — aqui assumimos que cada recv traz "uma" mensagem,
-        // o que funciona em prática para comandos curtos neste trabalho.
-        // -------------------------------------------------------------------------
-        if (mensagemCliente == "oi") {
-            sent = send(clientSocket, "hello", 5, 0);
-
-        } else if (mensagemCliente == "sair") {
-            std::cout << "Fechando socket..." << std::endl;
-            sent = send(clientSocket, "Fechando socket...", 18, 0);
-
-            if (sent == SOCKET_ERROR) {
-                std::cerr << "[ERRO] send('Fechando socket...'): " << WSAGetLastError() << "\n";
-            } else {
-                logger("INFO", "send", getTimestamp(), "Sent closing message to client", sent, "::1:random_port");
+        anel.consumirCqes([&](const io_uring_cqe& cqe) {
+            const auto op = (OperacaoUring)(cqe.user_data >> 32);
+            const int fd = (int)(uint32_t)cqe.user_data;
+            const bool continua = cqe.flags & IORING_CQE_F_MORE;
+
+            if (op == OP_ENCERRAR) {
+                encerrar = true;
+                return;
             }
 
-            // Após avisar o cliente, saímos do loop (encerrando a sessão)
-            break;
+            if (op == OP_POOL) {
+                retorno->colher([&](Concluido& r) {
+                    auto it = conexoes.find(r.fd);
+                    if (it == conexoes.end() || it->second.id != r.conexao || it->second.desligado) return;
+                    Conexao& c = it->second;
+                    receberConcluido(c, r);
+                    // Comandos que esperavam por vaga livre
+                    if (!processarQuadros(c)) c.desligado = c.fechar = true;
+                    tocar(c);
+                });
+                // O POLL_ADD vale para um único disparo: registra de novo
+                anel.prepararPoll(retorno->evento, POLLIN, dadosUring(OP_POOL, retorno->evento));
+                return;
+            }
 
-        } else if (mensagemCliente == "ping") {
-            sent = send(clientSocket, "pong", 4, 0);
+            if (op == OP_ACCEPT) {
+                if (cqe.res >= 0) {
+                    aceitouAlguma = true;
+                    Conexao& c = conexoes[cqe.res];
+                    c.fd = cqe.res;
+                    c.id = proximaConexao.fetch_add(1, std::memory_order_relaxed);
+                    c.retorno = retorno;
+                    c.aceitaBloco = false; // e c.local = false: sends do anel não levam descritores
+                    sockaddr_storage clientAddr{};
+                    socklen_t len = sizeof(clientAddr);
+                    getpeername(c.fd, (sockaddr*)&clientAddr, &len);
+                    c.peer = descreverPeer(clientAddr, c.fd);
+                    logger(NivelLog::Info, "accept", "Client connected", 0, c.peer);
+                    armarRecv(c);
+                    tocar(c);
+                } else if (cqe.res == -EINVAL && !aceitouAlguma) {
+                    suportado = false; // kernel sem accept multishot
+                    return;
+                } else if (cqe.res != -ECONNABORTED) {
+                    std::cerr << "[ERRO] accept: " << strerror(-cqe.res) << "\n";
+                }
+                // O multishot termina sozinho (ex.: EMFILE); registra de novo
+                if (!continua) anel.prepararAcceptMultishot(serverSocket, dadosUring(OP_ACCEPT, serverSocket));
+                return;
+            }
 
-        } else {
-            // Comando não reconhecido
-            sent = send(clientSocket, "Comando Desconhecido", 20, 0);
-        }
+            auto it = conexoes.find(fd);
+            if (it == conexoes.end()) return;
+            Conexao& c = it->second;
+            tocar(c);
 
-        // send: retorna bytes enviados (>0) ou SOCKET_ERROR em falha.
-        // Em TCP, "envio parcial" pode ocorrer (retorno < tamanho do pedido), mas
-        // como as mensagens aqui são curtas, normalmente isso não acontece.
-        if (sent == SOCKET_ERROR) {
-            std::cerr << "[ERRO] send: " << WSAGetLastError() << "\n";
-            break;
+            if (op == OP_RECV) {
+                if (!continua) --c.operacoes;
+                if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                    const uint16_t id = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    contarMetrica(Contador::BytesRecebidos, (uint64_t)cqe.res);
+                    logger(NivelLog::Info, "recv", "Message received from client", cqe.res, c.peer);
+                    c.entrada.alimentar(anel.buffer(GRUPO_BUFFERS, id), (size_t)cqe.res);
+                    anel.devolverBuffer(GRUPO_BUFFERS, id);
+                    if (!processarQuadros(c)) c.desligado = c.fechar = true;
+                    // Multishot encerrado sem erro (ex.: CQ cheia): rearma
+                    if (!continua && !c.desligado) armarRecv(c);
+                } else if (cqe.res == -ENOBUFS && !c.desligado) {
+                    armarRecv(c); // grupo sem buffers livres: já devolvemos, tenta de novo
+                } else if (cqe.res == 0 && !c.desligado) {
+                    // Fim do envio do cliente: o recv multishot acabou, mas as
+                    // respostas que estão no pool ainda saem antes do fechamento
+                    logTexto("[INFO] Cliente fechou a conexão.");
+                    c.fimLeitura = true;
+                    if (!processarQuadros(c)) c.desligado = c.fechar = true;
+                } else if (!c.desligado) {
+                    std::cerr << "[ERRO] recv: " << strerror(-cqe.res) << "\n";
+                    contarMetrica(Contador::Erros);
+                    c.desligado = c.fechar = true;
+                }
+                return;
+            }
 
-        } else {
-            logger("INFO", "send", getTimestamp(), "Message sent to client" , sent, "::1:random_port");
+            if (op == OP_SEND) {
+                --c.operacoes;
+                c.enviando = false;
+                if (cqe.res < 0) {
+                    std::cerr << "[ERRO] send: " << strerror(-cqe.res) << "\n";
+                    contarMetrica(Contador::Erros);
+                    c.desligado = c.fechar = true;
+                    return;
+                }
+                // Envio = da preparação do SEND até a conclusão
+                const int64_t agora = monotonicoNs();
+                medirLatencia(Latencia::Envio, agora - c.envioDesde);
+                contarMetrica(Contador::BytesEnviados, (uint64_t)cqe.res);
+                logger(NivelLog::Info, "send", "Message sent to client", cqe.res, c.peer);
+                c.enviados += (size_t)cqe.res;
+                if (c.enviados < c.emEnvio.size()) { // envio parcial: manda o resto
+                    if (anel.prepararSend(c.fd, c.emEnvio.data() + c.enviados,
+                                          c.emEnvio.size() - c.enviados, dadosUring(OP_SEND, c.fd))) {
+                        ++c.operacoes;
+                        c.enviando = true;
+                        c.envioDesde = agora;
+                    } else {
+                        c.desligado = c.fechar = true;
+                    }
+                } else {
+                    medirLatencia(Latencia::Espera, agora - c.esperaEmEnvio);
+                    c.emEnvio.clear();
+                    c.enviados = 0;
+                }
+            }
+        });
+
+        // Fim da rodada: prepara um SEND por conexão com respostas novas (saem
+        // todos na próxima io_uring_enter) e encerra quem terminou.
+        for (Conexao* pc : tocadas) {
+            Conexao& c = *pc;
+            c.tocada = false;
+            if (!c.enviando && !c.saida.empty() && !c.desligado) {
+                c.emEnvio.swap(c.saida);
+                c.saida.clear();
+                c.enviados = 0;
+                c.esperaEmEnvio = c.esperaDesde;
+                if (anel.prepararSend(c.fd, c.emEnvio.data(), c.emEnvio.size(), dadosUring(OP_SEND, c.fd))) {
+                    ++c.operacoes;
+                    c.enviando = true;
+                    c.envioDesde = monotonicoNs();
+                } else {
+                    c.desligado = true;
+                }
+            }
+            // "sair" respondido por completo (ou erro): shutdown encerra o recv
+            // multishot; o close só acontece quando nada mais referencia o fd.
+            if (c.fechar && !c.enviando && c.saida.empty() && c.vagas.empty()) c.desligado = true;
+            if (c.desligado && c.operacoes > 0) shutdown(c.fd, SHUT_RDWR);
+        }
+        for (Conexao* pc : tocadas) {
+            if (pc->desligado && pc->operacoes == 0) fecharConexao(conexoes, pc->fd);
         }
+        tocadas.clear();
+    }
 
-    } // fim do while de atendimento ao cliente
+    if (!suportado) {
+        logger(NivelLog::Warn, "io_uring",
+               "io_uring multishot accept unsupported, falling back to epoll", 0, "N/A");
+        return false;
+    }
 
-    // -----------------------------------------------------------------------------
-    // Encerramento e limpeza de recursos (ordem: client → server → Winsock).
-    // closesocket retorna 0 em sucesso; SOCKET_ERROR em falha.
-    // -----------------------------------------------------------------------------
-    if (closesocket(clientSocket) == SOCKET_ERROR) {
-            std::cerr << "[ERRO] closesocket(client): " << WSAGetLastError() << "\n";
-        } else {
-            logger("INFO", "closesocket", getTimestamp(), "Client socket closed", 0, "::1:random_port");
+    // Encerramento: fecha os clientes; o destrutor do anel cancela o que
+    // ainda estiver em voo.
+    while (!conexoes.empty()) {
+        fecharConexao(conexoes, conexoes.begin()->first);
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Um worker: socket de escuta próprio + motor de I/O próprio (epoll ou
+// io_uring) + mapa de conexões próprio. Nada é compartilhado entre workers no
+// caminho das requisições (nem locks, nem estado de conexão); cada conexão
+// vive e morre no worker que a aceitou. `eventoEncerrar` é um eventfd comum a
+// todos, que fica legível quando o processo recebe SIGINT/SIGTERM. O pool de
+// tarefas é a exceção: comum a todos, mas cada worker recebe as respostas dos
+// seus comandos pela própria fila (`retorno`).
+// -----------------------------------------------------------------------------
+void executarWorker(int id, int serverSocket, int eventoEncerrar, RetornoPool* retorno, int cpu,
+                    bool usarUring, const std::string& descricao) {
+    if (cpu >= 0) {
+        // Fixa o worker num núcleo: conexões, buffers e caches ficam quentes ali
+        cpu_set_t conjunto;
+        CPU_ZERO(&conjunto);
+        CPU_SET(cpu, &conjunto);
+        pthread_setaffinity_np(pthread_self(), sizeof(conjunto), &conjunto);
+    }
+
+    if (!usarUring || !loopUring(serverSocket, eventoEncerrar, retorno)) {
+        loopEpoll(serverSocket, eventoEncerrar, retorno);
+    }
+
+    if (close(serverSocket) != 0) {
+        std::cerr << "[ERRO] close(server): " << strerror(errno) << "\n";
+    } else {
+        logger(NivelLog::Info, "closesocket",
+               "Server socket closed (worker " + std::to_string(id) + ")", 0, descricao);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    /* Opções:
+    --workers=N  N threads, cada um com seu socket de escuta (SO_REUSEPORT) e
+                 seu loop epoll; 0 = um por núcleo. Padrão: 1 (como antes).
+    --pin        fixa o worker i no núcleo i % núcleos
+    --io=uring   usa o motor io_uring (accept/recv multishot); sem suporte no
+                 kernel, cai de volta no epoll. --io=epoll é o padrão.
+    --endereco=URI  tcp://[::1]:8080 (padrão), unix:///caminho, unix://@nome,
+                    seqpacket:///caminho ou seqpacket://@nome (transporte.h)
+    --tarefas=N  threads do pool que roda os comandos pesados ("primos");
+                 padrão: um por núcleo. 0 = sem pool: tudo no thread de I/O
+    --raiz=DIR   diretório servido por "arquivo" e "descritor"; sem ela os
+                 dois comandos são recusados */
+    iniciarLog("sockets", "server");
+    iniciarMetricas("sockets", "server");
+    unsigned workers = 1;
+    bool fixar = false;
+    bool usarUring = false;
+    int tarefas = -1; // -1: um por núcleo
+    Endereco endereco = enderecoPadrao();
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--workers=", 0) == 0) workers = (unsigned)std::strtoul(arg.c_str() + 10, nullptr, 10);
+        else if (arg == "--pin") fixar = true;
+        else if (arg == "--io=uring") usarUring = true;
+        else if (arg == "--io=epoll") usarUring = false;
+        else if (arg.rfind("--tarefas=", 0) == 0) tarefas = (int)std::strtoul(arg.c_str() + 10, nullptr, 10);
+        else if (arg.rfind("--endereco=", 0) == 0 && !resolverEndereco(arg.substr(11), endereco)) {
+            std::cerr << "[ERRO] endereço inválido: " << arg.substr(11) << "\n";
+            return 1;
+        } else if (arg.rfind("--raiz=", 0) == 0) {
+            char canonico[PATH_MAX];
+            raizArquivos = open(arg.c_str() + 7, O_PATH | O_DIRECTORY | O_CLOEXEC);
+            if (raizArquivos < 0 || !realpath(arg.c_str() + 7, canonico)) {
+                std::cerr << "[ERRO] raiz inválida: " << arg.substr(7) << ": " << strerror(errno) << "\n";
+                return 1;
+            }
+            raizCanonica = canonico;
         }
+    }
+    const unsigned nucleos = std::max(1u, std::thread::hardware_concurrency());
+    if (workers == 0) workers = nucleos;
+    if (tarefas < 0) tarefas = (int)nucleos;
+    if (usarUring && endereco.tipo == SOCK_SEQPACKET) {
+        // Os buffers fornecidos do io_uring (4 KiB) truncariam registros maiores
+        logger(NivelLog::Warn, "io_uring", "seqpacket uses the epoll engine", 0, endereco.descricao);
+        usarUring = false;
+    }
 
-        if (closesocket(serverSocket) == SOCKET_ERROR) {
-            std::cerr << "[ERRO] closesocket(server): " << WSAGetLastError() << "\n";
-        } else {
-            logger("INFO", "closesocket", getTimestamp(), "Server socket closed", 0, "::1:8080");
+    // SIGPIPE ignorado (tratamos EPIPE). SIGINT/SIGTERM ficam bloqueados em
+    // todos os threads (a máscara é herdada) e são consumidos por sigwait no
+    // thread principal, que então avisa os workers pelo eventfd.
+    signal(SIGPIPE, SIG_IGN);
+    sigset_t sinais;
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGINT);
+    sigaddset(&sinais, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sinais, nullptr);
+    aumentarLimiteDescritores();
+
+    int eventoEncerrar = eventfd(0, EFD_CLOEXEC);
+    if (eventoEncerrar < 0) {
+        std::cerr << "[ERRO] eventfd: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    // Pool de tarefas, criado depois da máscara de sinais (os threads dele a
+    // herdam). Os retornos são declarados antes do pool: ao sair, o pool
+    // termina as tarefas que restam enquanto eles ainda existem.
+    std::vector<std::unique_ptr<RetornoPool>> retornos(workers);
+    std::unique_ptr<PoolTarefas> pool;
+    if (tarefas > 0) {
+        pool = std::make_unique<PoolTarefas>((unsigned)tarefas);
+        for (auto& r : retornos) {
+            r = std::make_unique<RetornoPool>();
+            r->pool = pool.get();
+            r->evento = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (r->evento < 0) {
+                std::cerr << "[ERRO] eventfd: " << strerror(errno) << "\n";
+                close(eventoEncerrar);
+                return 1;
+            }
         }
+    }
 
-        if (WSACleanup() == SOCKET_ERROR) {
-            std::cerr << "[ERRO] WSACleanup: " << WSAGetLastError() << "\n";
-        } else {
-            logger("INFO", "WSACleanup", getTimestamp(), "WSACleanup successful", 0, "N/A");
+    // Os sockets de escuta são criados aqui, em sequência, para que uma porta
+    // ocupada seja detectada antes de qualquer worker começar. AF_UNIX não tem
+    // SO_REUSEPORT: os workers dividem um único socket de escuta (cada um com
+    // sua cópia do descritor) e disputam o accept.
+    std::vector<int> sockets;
+    for (unsigned i = 0; i < workers; ++i) {
+        int fd = (endereco.local() && i > 0) ? dup(sockets[0]) : criarSocketEscuta(endereco, workers > 1);
+        if (fd < 0) {
+            for (int s : sockets) close(s);
+            close(eventoEncerrar);
+            return 1;
         }
+        sockets.push_back(fd);
+    }
+
+    logTexto("Servidor aguardando conexões em " + endereco.descricao + " (" + std::to_string(workers) +
+             " workers, " + std::to_string(tarefas) + " threads no pool)...");
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < workers; ++i) {
+        threads.emplace_back(executarWorker, (int)i, sockets[i], eventoEncerrar, retornos[i].get(),
+                             fixar ? (int)(i % nucleos) : -1, usarUring, std::cref(endereco.descricao));
+    }
+
+    // Espera Ctrl+C / kill e acorda todos os workers
+    int sinal = 0;
+    sigwait(&sinais, &sinal);
+    uint64_t um = 1;
+    if (write(eventoEncerrar, &um, sizeof(um)) < 0) {
+        std::cerr << "[ERRO] write(eventfd): " << strerror(errno) << "\n";
+    }
+    for (auto& t : threads) t.join();
+    if (pool) {
+        logger(NivelLog::Info, "pool", std::to_string(pool->roubadas()) + " tasks stolen between pool threads",
+               0, endereco.descricao);
+    }
+    close(eventoEncerrar);
+    std::string caminho = endereco.caminho();
+    if (!caminho.empty()) unlink(caminho.c_str());
+    return 0;
 }
@@ -0,0 +1,179 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// transporte.h — endereço do par server/client, escolhido na linha de comando
+// (--endereco=URI):
+//
+//   tcp://[::1]:8080        TCP sobre IPv6 (padrão)
+//   unix:///tmp/ipc.sock    AF_UNIX stream com caminho no sistema de arquivos
+//   unix://@ipc             AF_UNIX stream no namespace abstrato (sem arquivo;
+//                           some junto com o último socket)
+//   seqpacket:///tmp/ipc    AF_UNIX seqpacket (cada send vira um registro)
+//   seqpacket://@ipc
+//
+// Na mesma máquina, AF_UNIX evita toda a pilha TCP (checksums, ACKs, janela)
+// e reduz a latência de ida e volta. Os quadros de protocolo.h funcionam igual
+// em todos; com seqpacket, cada envio é limitado a MAIOR_REGISTRO e quem lê usa
+// buffers desse tamanho para nenhum registro ser truncado.
+//
+// Só em AF_UNIX: enviarComDescritores()/receberComDescritores() passam
+// descritores abertos (SCM_RIGHTS), p.ex. pipes ou memória compartilhada.
+// -----------------------------------------------------------------------------
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+constexpr size_t MAIOR_REGISTRO = 64 * 1024;   // maior envio em seqpacket
+constexpr size_t MAX_DESCRITORES_ENVIO = 16;   // por sendmsg
+
+struct Endereco {
+    int familia = AF_INET6;
+    int tipo = SOCK_STREAM;
+    sockaddr_storage addr{};
+    socklen_t len = 0;
+    std::string descricao; // para os logs: "[::1]:8080", "unix://@ipc", ...
+
+    bool local() const { return familia == AF_UNIX; }
+
+    // Caminho no sistema de arquivos (vazio para TCP e namespace abstrato)
+    std::string caminho() const {
+        if (familia != AF_UNIX) return {};
+        const sockaddr_un& un = (const sockaddr_un&)addr;
+        if (un.sun_path[0] == '\0') return {};
+        return un.sun_path;
+    }
+
+    size_t maiorEnvio() const { return tipo == SOCK_SEQPACKET ? MAIOR_REGISTRO : SIZE_MAX; }
+};
+
+// Interpreta a URI; false (errno = EINVAL) se o formato não é reconhecido.
+inline bool resolverEndereco(std::string_view uri, Endereco& e) {
+    e = Endereco{};
+    e.descricao = std::string(uri);
+
+    if (uri.substr(0, 6) == "tcp://") {
+        // tcp://[ipv6]:porta
+        std::string_view resto = uri.substr(6);
+        size_t fecha = resto.find("]:");
+        if (resto.empty() || resto[0] != '[' || fecha == std::string_view::npos) {
+            errno = EINVAL;
+            return false;
+        }
+        std::string ip(resto.substr(1, fecha - 1));
+        std::string porta(resto.substr(fecha + 2));
+        char* fim = nullptr;
+        unsigned long p = std::strtoul(porta.c_str(), &fim, 10);
+        sockaddr_in6& in6 = (sockaddr_in6&)e.addr;
+        if (porta.empty() || *fim != '\0' || p > 65535 ||
+            inet_pton(AF_INET6, ip.c_str(), &in6.sin6_addr) != 1) {
+            errno = EINVAL;
+            return false;
+        }
+        in6.sin6_family = AF_INET6;
+        in6.sin6_port = htons((uint16_t)p);
+        e.len = sizeof(sockaddr_in6);
+        e.descricao = "[" + ip + "]:" + porta;
+        return true;
+    }
+
+    std::string_view caminho;
+    if (uri.substr(0, 7) == "unix://") {
+        caminho = uri.substr(7);
+    } else if (uri.substr(0, 12) == "seqpacket://") {
+        caminho = uri.substr(12);
+        e.tipo = SOCK_SEQPACKET;
+    } else {
+        errno = EINVAL;
+        return false;
+    }
+    sockaddr_un& un = (sockaddr_un&)e.addr;
+    if (caminho.empty() || caminho.size() >= sizeof(un.sun_path)) {
+        errno = EINVAL;
+        return false;
+    }
+    e.familia = AF_UNIX;
+    un.sun_family = AF_UNIX;
+    // '@' indica o namespace abstrato: sun_path começa com '\0' e o tamanho
+    // do endereço delimita o nome (não há terminador)
+    std::memcpy(un.sun_path, caminho.data(), caminho.size());
+    if (caminho[0] == '@') un.sun_path[0] = '\0';
+    e.len = (socklen_t)(offsetof(sockaddr_un, sun_path) + caminho.size() + (caminho[0] == '@' ? 0 : 1));
+    return true;
+}
+
+inline Endereco enderecoPadrao() {
+    Endereco e;
+    resolverEndereco("tcp://[::1]:8080", e);
+    return e;
+}
+
+// Limite de envio de um socket já aberto (ex.: um aceito pelo servidor).
+inline size_t maiorEnvioDoSocket(int fd) {
+    int tipo = SOCK_STREAM;
+    socklen_t len = sizeof(tipo);
+    getsockopt(fd, SOL_SOCKET, SO_TYPE, &tipo, &len);
+    return tipo == SOCK_SEQPACKET ? MAIOR_REGISTRO : SIZE_MAX;
+}
+
+// -----------------------------------------------------------------------------
+// Passagem de descritores (SCM_RIGHTS). Os descritores viajam junto com os
+// bytes de um envio e chegam ao outro lado como descritores novos para os
+// mesmos arquivos abertos; quem envia pode fechar os seus logo depois.
+// -----------------------------------------------------------------------------
+
+// Como send(), mas anexa `fds` (até MAX_DESCRITORES_ENVIO) aos bytes enviados.
+inline ssize_t enviarComDescritores(int sock, const void* dados, size_t n,
+                                    const std::vector<int>& fds, int flags) {
+    iovec iov{const_cast<void*>(dados), n};
+    alignas(cmsghdr) char controle[CMSG_SPACE(sizeof(int) * MAX_DESCRITORES_ENVIO)];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    const size_t qtd = std::min(fds.size(), MAX_DESCRITORES_ENVIO);
+    if (qtd > 0) {
+        msg.msg_control = controle;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * qtd);
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * qtd);
+        std::memcpy(CMSG_DATA(cm), fds.data(), sizeof(int) * qtd);
+    }
+    return sendmsg(sock, &msg, flags);
+}
+
+// Como recv(); descritores recebidos entram no fim de `fds`, na ordem em que
+// chegaram (já com FD_CLOEXEC).
+inline ssize_t receberComDescritores(int sock, void* buffer, size_t n, std::deque<int>& fds,
+                                     int flags = 0) {
+    iovec iov{buffer, n};
+    alignas(cmsghdr) char controle[CMSG_SPACE(sizeof(int) * MAX_DESCRITORES_ENVIO)];
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = controle;
+    msg.msg_controllen = sizeof(controle);
+    ssize_t r = recvmsg(sock, &msg, flags | MSG_CMSG_CLOEXEC);
+    if (r < 0) return r;
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) continue;
+        const size_t qtd = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < qtd; ++i) {
+            int fd;
+            std::memcpy(&fd, CMSG_DATA(cm) + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+    return r;
+}
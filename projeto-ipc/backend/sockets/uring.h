@@ -0,0 +1,273 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// uring.h — invólucro mínimo de io_uring sobre as syscalls (sem liburing).
+//
+// Só o que o servidor usa:
+//  - accept multishot: um único SQE entrega todas as conexões novas;
+//  - recv multishot com anel de buffers fornecidos (provided buffer ring): o
+//    kernel escolhe um buffer do grupo a cada chegada de dados e informa o id
+//    no CQE; devolvemos o buffer ao anel depois de consumir os bytes;
+//  - send e poll simples.
+// Os SQEs preparados ficam acumulados até submeter(), então todos os sends de
+// uma rodada do loop saem numa única io_uring_enter.
+//
+// iniciar()/registrarBuffers() devolvem false (com errno) quando o kernel não
+// suporta io_uring ou algum recurso; quem chama cai de volta no epoll.
+// -----------------------------------------------------------------------------
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class AnelUring {
+public:
+    AnelUring() = default;
+    AnelUring(const AnelUring&) = delete;
+    AnelUring& operator=(const AnelUring&) = delete;
+    ~AnelUring() { fechar(); }
+
+    bool iniciar(unsigned entradas) {
+        io_uring_params p{};
+        // Um único thread submete e colhe: o kernel pode adiar o trabalho de
+        // conclusão até a próxima io_uring_enter (menos interrupções).
+        p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        fd_ = (int)syscall(__NR_io_uring_setup, entradas, &p);
+        if (fd_ < 0 && errno == EINVAL) {
+            p = io_uring_params{};
+            fd_ = (int)syscall(__NR_io_uring_setup, entradas, &p);
+        }
+        if (fd_ < 0) return false;
+        if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+            fechar();
+            errno = ENOSYS;
+            return false;
+        }
+
+        tamAneis_ = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                             p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+        aneis_ = mmap(nullptr, tamAneis_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd_, IORING_OFF_SQ_RING);
+        if (aneis_ == MAP_FAILED) {
+            aneis_ = nullptr;
+            fechar();
+            return false;
+        }
+        tamSqes_ = p.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = (io_uring_sqe*)mmap(nullptr, tamSqes_, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes_ == MAP_FAILED) {
+            sqes_ = nullptr;
+            fechar();
+            return false;
+        }
+
+        char* base = (char*)aneis_;
+        sqHead_ = (unsigned*)(base + p.sq_off.head);
+        sqTail_ = (unsigned*)(base + p.sq_off.tail);
+        sqMascara_ = *(unsigned*)(base + p.sq_off.ring_mask);
+        sqEntradas_ = p.sq_entries;
+        unsigned* array = (unsigned*)(base + p.sq_off.array);
+        for (unsigned i = 0; i < sqEntradas_; ++i) array[i] = i; // SQE i ↔ posição i
+        cqHead_ = (unsigned*)(base + p.cq_off.head);
+        cqTail_ = (unsigned*)(base + p.cq_off.tail);
+        cqMascara_ = *(unsigned*)(base + p.cq_off.ring_mask);
+        cqes_ = (io_uring_cqe*)(base + p.cq_off.cqes);
+        tailLocal_ = *sqTail_;
+        return true;
+    }
+
+    void fechar() {
+        for (auto& g : grupos_) {
+            munmap(g.anel, g.tamAnel);
+            delete[] g.memoria;
+        }
+        grupos_.clear();
+        if (sqes_) munmap(sqes_, tamSqes_);
+        if (aneis_) munmap(aneis_, tamAneis_);
+        sqes_ = nullptr;
+        aneis_ = nullptr;
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+    }
+
+    // ------------------------------------------------------------- submissão
+
+    // Próximo SQE livre (zerado). Se a fila de submissão encheu, submete o que
+    // já está preparado para abrir espaço.
+    io_uring_sqe* obterSqe() {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (tailLocal_ - head >= sqEntradas_) {
+            submeter(0);
+            head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            if (tailLocal_ - head >= sqEntradas_) return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes_[tailLocal_ & sqMascara_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++tailLocal_;
+        return sqe;
+    }
+
+    // Publica os SQEs preparados e espera até `esperar` conclusões.
+    int submeter(unsigned esperar) {
+        const unsigned pendentes = tailLocal_ - *sqTail_;
+        __atomic_store_n(sqTail_, tailLocal_, __ATOMIC_RELEASE);
+        while (true) {
+            int r = (int)syscall(__NR_io_uring_enter, fd_, pendentes, esperar,
+                                 esperar ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (r < 0 && errno == EINTR) continue;
+            return r;
+        }
+    }
+
+    bool prepararAcceptMultishot(int fd, uint64_t dados) {
+        io_uring_sqe* sqe = obterSqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = dados;
+        return true;
+    }
+
+    bool prepararRecvMultishot(int fd, uint16_t grupo, uint64_t dados) {
+        io_uring_sqe* sqe = obterSqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = grupo;
+        sqe->user_data = dados;
+        return true;
+    }
+
+    bool prepararSend(int fd, const void* dados, size_t n, uint64_t id) {
+        io_uring_sqe* sqe = obterSqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)dados;
+        sqe->len = (uint32_t)n;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = id;
+        return true;
+    }
+
+    bool prepararPoll(int fd, uint32_t eventos, uint64_t dados) {
+        io_uring_sqe* sqe = obterSqe();
+        if (!sqe) return false;
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = eventos;
+        sqe->user_data = dados;
+        return true;
+    }
+
+    // -------------------------------------------------------------- conclusão
+
+    // Chama f(cqe) para cada conclusão disponível; devolve quantas foram.
+    template <typename F>
+    unsigned consumirCqes(F&& f) {
+        unsigned head = *cqHead_;
+        const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        for (; head != tail; ++head, ++n) {
+            f(cqes_[head & cqMascara_]);
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    // --------------------------------------------------- buffers fornecidos
+
+    // Registra um grupo com `quantidade` buffers (potência de 2) de `tamanho`
+    // bytes cada, já todos disponíveis para o kernel.
+    bool registrarBuffers(uint16_t grupo, unsigned quantidade, unsigned tamanho) {
+        Grupo g;
+        g.id = grupo;
+        g.quantidade = quantidade;
+        g.tamanho = tamanho;
+        g.tamAnel = quantidade * sizeof(io_uring_buf);
+        void* anel = mmap(nullptr, g.tamAnel, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (anel == MAP_FAILED) return false;
+        g.anel = (io_uring_buf_ring*)anel;
+        g.anel->tail = 0;
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = (uint64_t)(uintptr_t)g.anel;
+        reg.ring_entries = quantidade;
+        reg.bgid = grupo;
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+            int erro = errno;
+            munmap(anel, g.tamAnel);
+            errno = erro;
+            return false;
+        }
+        g.memoria = new char[(size_t)quantidade * tamanho];
+        grupos_.push_back(g);
+        for (unsigned i = 0; i < quantidade; ++i) devolverBuffer(grupo, (uint16_t)i);
+        return true;
+    }
+
+    char* buffer(uint16_t grupo, uint16_t id) {
+        Grupo& g = grupoDe(grupo);
+        return g.memoria + (size_t)id * g.tamanho;
+    }
+
+    // Devolve o buffer `id` ao anel para o kernel reutilizar.
+    void devolverBuffer(uint16_t grupo, uint16_t id) {
+        Grupo& g = grupoDe(grupo);
+        const uint16_t tail = g.anel->tail;
+        // Não usar g.anel->bufs: em C++ o struct vazio do __DECLARE_FLEX_ARRAY
+        // ocupa 1 byte e desloca o vetor; as entradas começam na base do anel.
+        io_uring_buf& b = ((io_uring_buf*)g.anel)[tail & (g.quantidade - 1)];
+        b.addr = (uint64_t)(uintptr_t)(g.memoria + (size_t)id * g.tamanho);
+        b.len = g.tamanho;
+        b.bid = id;
+        __atomic_store_n(&g.anel->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+    }
+
+    int fd() const { return fd_; }
+
+private:
+    struct Grupo {
+        uint16_t id = 0;
+        unsigned quantidade = 0;
+        unsigned tamanho = 0;
+        size_t tamAnel = 0;
+        io_uring_buf_ring* anel = nullptr;
+        char* memoria = nullptr;
+    };
+
+    Grupo& grupoDe(uint16_t id) {
+        for (auto& g : grupos_) if (g.id == id) return g;
+        return grupos_.front();
+    }
+
+    int fd_ = -1;
+    void* aneis_ = nullptr;
+    size_t tamAneis_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t tamSqes_ = 0;
+
+    unsigned* sqHead_ = nullptr;
+    unsigned* sqTail_ = nullptr;
+    unsigned sqMascara_ = 0;
+    unsigned sqEntradas_ = 0;
+    unsigned tailLocal_ = 0;
+
+    unsigned* cqHead_ = nullptr;
+    unsigned* cqTail_ = nullptr;
+    unsigned cqMascara_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::vector<Grupo> grupos_;
+};
@@ -0,0 +1,238 @@
+#pragma once
+// -----------------------------------------------------------------------------
+// zerocopia.h — transferência em bloco (arquivos de vários MB) sem copiar o
+// corpo entre espaço de usuário e kernel.
+//
+// Servidor:
+//  - abrirSobRaiz(): abre o caminho pedido pelo par só dentro do diretório
+//    servido e só se for arquivo regular, sem nunca bloquear no open();
+//  - ArquivoMapeado: abre assim e mapeia (mmap) o arquivo pedido;
+//  - EnviosZeroCopia: envia o mapeamento com MSG_ZEROCOPY. O kernel passa a
+//    referenciar as páginas em vez de copiá-las e avisa pela fila de erros do
+//    socket (MSG_ERRQUEUE) quando terminou de usá-las; só então o mapeamento
+//    pode ser liberado ou reutilizado. Sem SO_ZEROCOPY, o corpo vai com
+//    sendfile() a partir do descritor do arquivo (cópia só dentro do kernel).
+//
+// Cliente:
+//  - receberCorpo(): depois que o decodificador entrega o cabeçalho de um
+//    bloco (Estado::Bloco), copia os bytes que vieram junto e recebe o resto
+//    direto no buffer de quem chamou (ex.: um arquivo de destino mapeado).
+// -----------------------------------------------------------------------------
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/errqueue.h>
+#include <linux/openat2.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include "protocolo.h"
+
+// Blocos menores que isto vão pelo caminho normal: registrar e colher as
+// notificações custa mais do que copiar poucos KB.
+constexpr size_t MENOR_BLOCO_ZEROCOPIA = 64 * 1024;
+
+// -----------------------------------------------------------------------------
+// Abre `caminho`, relativo a `raiz` (diretório aberto com O_PATH), para
+// leitura. O caminho vem do par: RESOLVE_BENEATH recusa "..", caminhos
+// absolutos e links que levem para fora da raiz (EXDEV). O_NONBLOCK faz o
+// open() de um FIFO ou dispositivo voltar na hora em vez de prender o thread
+// de I/O; o que não for arquivo regular é recusado (EINVAL). Retorna o fd,
+// já bloqueante, ou -1 com errno.
+// -----------------------------------------------------------------------------
+inline int abrirSobRaiz(int raiz, const std::string& caminho) {
+    open_how como{};
+    como.flags = O_RDONLY | O_CLOEXEC | O_NONBLOCK | O_NOCTTY;
+    como.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    const int fd = (int)syscall(SYS_openat2, raiz, caminho.c_str(), &como, sizeof(como));
+    if (fd < 0) return -1;
+    struct stat st{};
+    int erro = 0;
+    if (fstat(fd, &st) != 0) erro = errno;
+    else if (!S_ISREG(st.st_mode)) erro = EINVAL;
+    else if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) != 0) erro = errno;
+    if (erro != 0) {
+        close(fd);
+        errno = erro;
+        return -1;
+    }
+    return fd;
+}
+
+// -----------------------------------------------------------------------------
+// Arquivo somente leitura mapeado em memória. Mantém o fd aberto para o
+// caminho com sendfile().
+// -----------------------------------------------------------------------------
+class ArquivoMapeado {
+public:
+    ArquivoMapeado() = default;
+    ArquivoMapeado(const ArquivoMapeado&) = delete;
+    ArquivoMapeado& operator=(const ArquivoMapeado&) = delete;
+    ~ArquivoMapeado() { fechar(); }
+
+    // Abre com abrirSobRaiz(). false (com errno) se não abriu, se não é
+    // arquivo regular dentro de `raiz` ou se passa do que cabe no campo de
+    // tamanho do quadro (u32).
+    bool abrir(int raiz, const std::string& caminho) {
+        fechar();
+        fd_ = abrirSobRaiz(raiz, caminho);
+        if (fd_ < 0) return false;
+        struct stat st{};
+        if (fstat(fd_, &st) != 0) {
+            int erro = errno;
+            fechar();
+            errno = erro;
+            return false;
+        }
+        if ((uint64_t)st.st_size > UINT32_MAX) {
+            fechar();
+            errno = EINVAL;
+            return false;
+        }
+        tamanho_ = (size_t)st.st_size;
+        if (tamanho_ > 0) {
+            void* p = mmap(nullptr, tamanho_, PROT_READ, MAP_SHARED, fd_, 0);
+            if (p == MAP_FAILED) {
+                int erro = errno;
+                fechar();
+                errno = erro;
+                return false;
+            }
+            dados_ = (const char*)p;
+        }
+        return true;
+    }
+
+    void fechar() {
+        if (dados_) munmap((void*)dados_, tamanho_);
+        if (fd_ >= 0) close(fd_);
+        dados_ = nullptr;
+        tamanho_ = 0;
+        fd_ = -1;
+    }
+
+    const char* dados() const { return dados_; }
+    size_t tamanho() const { return tamanho_; }
+    int fd() const { return fd_; }
+
+private:
+    int fd_ = -1;
+    const char* dados_ = nullptr;
+    size_t tamanho_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Contabilidade de MSG_ZEROCOPY de um socket. O kernel numera cada send
+// bem-sucedido com MSG_ZEROCOPY (0, 1, 2, ...) e devolve intervalos de
+// números concluídos na fila de erros; enquanto pendente() for true algum
+// buffer enviado ainda pode estar sendo lido pelo kernel.
+// -----------------------------------------------------------------------------
+class EnviosZeroCopia {
+public:
+    // Liga SO_ZEROCOPY no socket; false se o kernel/família não suporta.
+    bool habilitar(int fd) {
+        int um = 1;
+        habilitado_ = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &um, sizeof(um)) == 0;
+        return habilitado_;
+    }
+
+    // Como send(): bytes aceitos ou -1 com errno. ENOBUFS (limite de páginas
+    // presas atingido) vira um send comum, que copia.
+    ssize_t enviar(int fd, const char* dados, size_t n) {
+        ssize_t r = send(fd, dados, n, MSG_NOSIGNAL | MSG_ZEROCOPY);
+        if (r >= 0) {
+            ++enviados_;
+            return r;
+        }
+        if (errno == ENOBUFS) return send(fd, dados, n, MSG_NOSIGNAL);
+        return -1;
+    }
+
+    // Lê as notificações disponíveis (não bloqueia). Retorna false se a fila
+    // de erros trouxe um erro de verdade do socket.
+    bool colher(int fd) {
+        while (true) {
+            char controle[128];
+            msghdr msg{};
+            msg.msg_control = controle;
+            msg.msg_controllen = sizeof(controle);
+            if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+                auto* ee = (const sock_extended_err*)CMSG_DATA(cm);
+                if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                    if (ee->ee_errno != 0) return false;
+                    continue;
+                }
+                // Intervalo [ee_info, ee_data] de envios concluídos
+                concluidos_ += ee->ee_data - ee->ee_info + 1;
+                // O kernel copiou mesmo assim (ex.: loopback): MSG_ZEROCOPY
+                // neste socket só acrescenta as notificações
+                if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) copiados_ = true;
+            }
+        }
+    }
+
+    bool habilitado() const { return habilitado_; }
+    bool pendente() const { return concluidos_ != enviados_; }
+    // Algum envio foi copiado pelo kernel; enviarCorpo() passa a usar sendfile()
+    bool kernelCopiou() const { return copiados_; }
+
+private:
+    bool habilitado_ = false;
+    bool copiados_ = false;
+    uint32_t enviados_ = 0;   // próximo número que o kernel vai atribuir
+    uint32_t concluidos_ = 0;
+};
+
+// -----------------------------------------------------------------------------
+// Envia o que falta do corpo de `arquivo` (a partir de `enviados`) num socket
+// não bloqueante: MSG_ZEROCOPY se habilitado e o bloco for grande, senão
+// sendfile(). Depois que o kernel avisa que copiou um envio (loopback, placa
+// sem scatter-gather), o socket vai de sendfile() de vez. Cada chamada envia
+// no máximo `maiorEnvio` bytes (registros de seqpacket, ver transporte.h).
+// Retorna false em erro fatal; EAGAIN apenas interrompe.
+// -----------------------------------------------------------------------------
+inline bool enviarCorpo(int fd, const ArquivoMapeado& arquivo, size_t& enviados,
+                        EnviosZeroCopia& zc, size_t maiorEnvio = SIZE_MAX) {
+    const bool semCopia = zc.habilitado() && !zc.kernelCopiou() && arquivo.tamanho() >= MENOR_BLOCO_ZEROCOPIA;
+    while (enviados < arquivo.tamanho()) {
+        const size_t parte = std::min(arquivo.tamanho() - enviados, maiorEnvio);
+        ssize_t n;
+        if (semCopia) {
+            n = zc.enviar(fd, arquivo.dados() + enviados, parte);
+        } else {
+            off_t pos = (off_t)enviados;
+            n = sendfile(fd, arquivo.fd(), &pos, parte);
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        enviados += (size_t)n;
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Lado cliente (socket bloqueante): recebe os `n` bytes do corpo de um bloco
+// em `destino`. O começo pode já estar no decodificador; o resto vem com
+// recv direto no buffer final, sem buffer intermediário.
+// -----------------------------------------------------------------------------
+inline bool receberCorpo(int fd, DecodificadorQuadros& entrada, char* destino, size_t n) {
+    size_t recebidos = entrada.tirar(destino, n);
+    while (recebidos < n) {
+        ssize_t r = recv(fd, destino + recebidos, n - recebidos, MSG_WAITALL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        recebidos += (size_t)r;
+    }
+    return true;
+}
@@ -1,10 +1,18 @@
 import subprocess   # Permite executar programas externos (ex.: writer.exe, reader.exe)
 import threading    # Cria threads para ler a saída dos processos sem travar a interface gráfica
-import json         # Tenta decodificar a saída dos processos como JSON (para exibição formatada)
+import json         # Decodifica os registros NDJSON que os backends escrevem em stdout
+import os           # Ambiente dos processos (formato e lote dos logs)
+import queue        # Fila entre as threads de leitura e a interface
 import tkinter as tk
 from tkinter import ttk, scrolledtext  # Widgets modernos (ttk) e caixa de texto com rolagem
 import time         # Usado para adicionar pequenos delays entre inicializações de processos
 
+# Os backends escrevem um registro JSON por linha (backend/common/log.h), em
+# lotes; "seq" numera os registros de cada processo e um salto indica perda.
+AMBIENTE_BACKEND = dict(os.environ, IPC_LOG_FORMATO="ndjson")
+INTERVALO_UI_MS = 50        # a interface recolhe a fila a cada 50 ms
+MAIOR_LOTE_UI = 2000        # registros inseridos por rodada, no máximo
+
 class FrontEndIPCApp:
     def __init__(self, root):
         self.root = root
@@ -72,6 +80,11 @@ class FrontEndIPCApp:
         self.writer_exec = None
         self.reader_exec = None
 
+        # Linhas prontas para exibir, produzidas pelas threads de leitura. Só a
+        # thread da interface mexe nos widgets (Tkinter não é thread-safe).
+        self.fila = queue.Queue()
+        self.root.after(INTERVALO_UI_MS, self.descarregar_fila)
+
     def parar_processos(self):
         """Força a parada dos processos caso estejam em execução"""
         if self.writer_proc:
@@ -114,7 +127,8 @@ class FrontEndIPCApp:
                     stdout=subprocess.PIPE,
                     stderr=subprocess.STDOUT,
                     stdin=subprocess.PIPE,
-                    text=True
+                    text=True,
+                    env=AMBIENTE_BACKEND
                 )
                 # Thread que fica lendo tudo que o pipes.exe imprimir
                 threading.Thread(target=self.ler_saida, args=(self.writer_proc, "Pipe"), daemon=True).start()
@@ -142,7 +156,8 @@ class FrontEndIPCApp:
                 stdout=subprocess.PIPE,
                 stderr=subprocess.STDOUT,
                 stdin=subprocess.PIPE,
-                text=True
+                text=True,
+                env=AMBIENTE_BACKEND
             )
             # Thread que lê a saída do writer continuamente
             threading.Thread(target=self.ler_saida, args=(self.writer_proc, "Writer"), daemon=True).start()
@@ -157,7 +172,8 @@ class FrontEndIPCApp:
                 [self.reader_exec],
                 stdout=subprocess.PIPE,
                 stderr=subprocess.STDOUT,
-                text=True
+                text=True,
+                env=AMBIENTE_BACKEND
             )
             # Thread que lê a saída do reader continuamente
             threading.Thread(target=self.ler_saida, args=(self.reader_proc, "Reader"), daemon=True).start()
@@ -168,29 +184,58 @@ class FrontEndIPCApp:
             self.writer_text.see(tk.END)
 
     def ler_saida(self, proc, nome):
-        """Thread que fica lendo a saída (stdout) do processo"""
+        """Thread que lê a saída (stdout) do processo e põe as linhas na fila"""
+        ultimo_seq = {}  # pid -> último "seq" visto (pai e filho dividem o stdout)
         for line in proc.stdout:
             line = line.strip()
             if not line:
                 continue
             try:
-                # Se a saída for JSON, formata para ficar legível
                 data = json.loads(line)
-                msg = json.dumps(data, indent=2, ensure_ascii=False)
-                display = f"[{nome}] {msg}\n"
             except json.JSONDecodeError:
-                # Caso não seja JSON, apenas exibe a linha
-                display = f"[{nome}] {line}\n"
+                # Linha que não é registro (ex.: erro do sistema): exibe como está
+                self.fila.put((nome, f"[{nome}] {line}\n"))
+                continue
 
-            # Decide onde exibir a mensagem (esquerda ou direita)
-            if nome in ("Pipe", "Writer"):
-                self.writer_text.insert(tk.END, display)
-                self.writer_text.see(tk.END)
-            elif nome == "Reader":
-                self.reader_text.config(state='normal')
-                self.reader_text.insert(tk.END, display)
-                self.reader_text.see(tk.END)
-                self.reader_text.config(state='disabled')
+            # Salto na sequência: o backend descartou registros (anel de log cheio)
+            pid, seq = data.get("pid"), data.get("seq")
+            if seq is not None:
+                anterior = ultimo_seq.get(pid)
+                if anterior is not None and seq > anterior + 1:
+                    self.fila.put((nome, f"[{nome}] {seq - anterior - 1} registros perdidos (pid {pid})\n"))
+                ultimo_seq[pid] = seq
+
+            if "text" in data:
+                display = f"[{nome}] {data['text']}\n"
+            else:
+                detalhes = data.get("details", {})
+                display = f"[{nome}] {data.get('level', '')} {data.get('event', '')}: {detalhes.get('msg', '')}"
+                if detalhes.get("bytes"):
+                    display += f" ({detalhes['bytes']} bytes)"
+                if detalhes.get("peer"):
+                    display += f" [{detalhes['peer']}]"
+                display += "\n"
+            self.fila.put((nome, display))
+
+    def descarregar_fila(self):
+        """Na thread da interface: insere de uma vez o que chegou desde a última rodada"""
+        writer, reader = [], []
+        try:
+            for _ in range(MAIOR_LOTE_UI):
+                nome, display = self.fila.get_nowait()
+                # Decide onde exibir a mensagem (esquerda ou direita)
+                (reader if nome == "Reader" else writer).append(display)
+        except queue.Empty:
+            pass
+        if writer:
+            self.writer_text.insert(tk.END, "".join(writer))
+            self.writer_text.see(tk.END)
+        if reader:
+            self.reader_text.config(state='normal')
+            self.reader_text.insert(tk.END, "".join(reader))
+            self.reader_text.see(tk.END)
+            self.reader_text.config(state='disabled')
+        self.root.after(INTERVALO_UI_MS, self.descarregar_fila)
 
     def enviar_mensagem(self):
         """Envia o conteúdo do campo de entrada para o stdin do writer"""
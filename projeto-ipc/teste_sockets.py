@@ -1,8 +1,8 @@
 import subprocess
 import time
 
-SERVER = r"projeto-ipc\backend\sockets\server.exe"
-CLIENT = r"projeto-ipc\backend\sockets\client.exe"
+SERVER = "projeto-ipc/backend/sockets/server"
+CLIENT = "projeto-ipc/backend/sockets/client"
 
 def run_test(comandos):
     # inicia servidor